@@ -8,56 +8,31 @@
  */
 
 
+#include "Sieve.h"
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
-#include <string>
 #include <vector>
 #include <stdint.h>
 
 
-bool is_prime(uint64_t n, const std::vector<uint64_t> & preceding)
+// The nth prime is below n (ln n + ln ln n) for n >= 6.
+uint64_t nth_prime(uint64_t n)
 {
-    // precondition: "preceding" contains all primes < n
+    double log_n = std::log(double(n));
+    uint64_t limit = n < 6 ? 14 : static_cast<uint64_t>(n * (log_n + std::log(log_n))) + 1;
 
-    for (auto p : preceding)
-    {
-        if (n % p == 0)
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-uint64_t next_prime(const std::vector<uint64_t> & preceding)
-{
-    if (preceding.empty())
-    {
-        return 2;
-    }
-
-    if (preceding.back() == 2)
-    {
-        return 3;
-    }
-
-    for (uint64_t n = preceding.back() + 2; ; n += 2)
+    std::vector<uint64_t> primes;
+    Primes::Sieve(limit).get(0, limit, primes);
+    if (n == 0 || primes.size() < n)
     {
-        if (is_prime(n, preceding))
-        {
-            return n;
-        }
+        throw std::logic_error("nth_prime: bad bound");
     }
+    return primes[n - 1];
 }
 
 
 int main()
 {
-    std::vector<uint64_t> primes;
-    while (primes.size() < 10001)
-    {
-        primes.push_back(next_prime(primes));
-    }
-    std::cout << primes.back() << std::endl;
+    std::cout << nth_prime(10001) << std::endl;
 }
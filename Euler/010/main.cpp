@@ -6,72 +6,15 @@
  */
 
 
-#include <algorithm>
+#include "Sieve.h"
 #include <iostream>
-#include <vector>
 #include <stdint.h>
 
 
-bool is_prime(uint64_t n, const std::vector<uint64_t> & preceding)
-{
-    // precondition: "preceding" contains all primes < sqrt(n)
-
-    for (auto p : preceding)
-    {
-        if ((p * p) > n)
-        {
-            return true;
-        }
-
-        if (n % p == 0)
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-uint64_t next_prime(const std::vector<uint64_t> & preceding)
-{
-    if (preceding.empty())
-    {
-        return 2;
-    }
-
-    if (preceding.back() == 2)
-    {
-        return 3;
-    }
-
-    for (uint64_t n = preceding.back() + 2; ; n += 2)
-    {
-        if (is_prime(n, preceding))
-        {
-            return n;
-        }
-    }
-}
-
-
-std::vector<uint64_t> get_primes_below(uint64_t limit)
-{
-    std::vector<uint64_t> result;
-    result.reserve(limit / 2); // no reallocs
-    for (;;)
-    {
-        uint64_t next = next_prime(result);
-        if (next >= limit)
-        {
-            return result;
-        }
-        result.push_back(next);
-    }
-}
-
-
 int main()
 {
-    auto primes = get_primes_below(2 * 1000 * 1000);
-    std::cout << std::accumulate(primes.begin(), primes.end(), uint64_t()) << std::endl;
+    const uint64_t limit = 2 * 1000 * 1000;
+    uint64_t sum = 0;
+    Primes::Sieve(limit).for_each(0, limit, [&](uint64_t p) { sum += p; });
+    std::cout << sum << std::endl;
 }
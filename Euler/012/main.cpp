@@ -22,182 +22,51 @@
  */
 
 
-#include <algorithm>
+#include "NumberTheory.h"
 #include <chrono>
-#include <cmath>
 #include <iostream>
-#include <map>
 #include <vector>
 #include <stdint.h>
 
 
 
-typedef std::map<uint64_t, uint64_t> Map;
-Map get_prime_factors(uint64_t n);
-
-
-template<typename T>
-std::ostream& operator<<(std::ostream & os, const std::vector<T> & vec)
-{
-    os << "{ ";
-    for (const auto & v : vec)
-    {
-        os << v << " ";
-    }
-    return os << "}";
-}
-
-template<typename T>
-std::ostream& operator<<(std::ostream & os, const std::map<T, T> & vec)
-{
-    uint64_t c = 0;
-    for (const auto & p : vec)
-    {
-        if (c++)
-        {
-            os << '*';
-        }
-        for (uint64_t i = 0; i < p.second; ++i)
-        {
-            if (i != 0)
-            {
-                os << '*';
-            }
-            os << p.first;
-        }
-    }
-    return os;
-}
-
-
-bool is_prime(uint64_t n, const std::vector<uint64_t> & preceding)
-{
-    // precondition: "preceding" contains all primes < sqrt(n)
-
-    for (auto p : preceding)
-    {
-        if ((p * p) > n)
-        {
-            return true;
-        }
-
-        if (n % p == 0)
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-uint64_t next_prime(std::vector<uint64_t> & preceding)
-{
-    if (preceding.empty())
-    {
-        preceding.push_back(2);
-        return preceding.back();
-    }
-
-    if (preceding.back() == 2)
-    {
-        preceding.push_back(3);
-        return preceding.back();
-    }
-
-    for (uint64_t n = preceding.back() + 2; ; n += 2)
-    {
-        if (is_prime(n, preceding))
-        {
-            preceding.push_back(n);
-            return preceding.back();
-        }
-    }
-}
-
-
-uint64_t num_divisors(uint64_t n)
-{
-    uint64_t result = 1;
-    for (auto pair : get_prime_factors(n))
-    {
-        result *= (pair.second + 1);
-    }
-    return result;
-}
-
-
 uint64_t triangle(uint64_t n)
 {
     return n % 2 == 0 ? (n/2) * (n+1) : ((n+1)/2) * n;
 }
 
 
-
-Map operator+(Map lhs, const Map & rhs)
+// n and n + 1 have no common factor, so neither have the two halves of
+// triangle(n), and its divisor count is the product of theirs.
+uint64_t get_divisors_count_of_tr(const std::vector<uint32_t> & divisor_counts, uint64_t n)
 {
-    for (auto p : rhs)
+    if (n % 2 == 0)
     {
-        lhs[p.first] += p.second;
-    }
-    return lhs;
-}
-
-
-Map get_prime_factors(uint64_t n)
-{
-    std::map<uint64_t, uint64_t> result;
-    static std::vector<uint64_t> pre = []{
-        std::vector<uint64_t> result;
-        for (int i = 0; i < 1000; ++i)
-        {
-            next_prime(result);
-        }
-        return result;
-    }();
-
-    while (n > pre.size())
-    {
-        next_prime(pre);
-    }
-
-    for (uint64_t i = 0; i < pre.size(); ++i)
-    {
-        auto p = pre[i];
-        while (n % p == 0)
-        {
-            result[p]++;
-            n /= p;
-        }
-        if (p > n)
-        {
-            return result;
-        }
-    }
-    return result;
-}
-
-
-Map get_prime_factors_of_tr(uint64_t n)
-{
-    if (n%2 ==0)
-    {
-        return get_prime_factors(n/2) + get_prime_factors(n + 1);
+        return uint64_t(divisor_counts[n/2]) * divisor_counts[n + 1];
     }
     else
     {
-        return get_prime_factors(n) + get_prime_factors((n + 1)/2);
+        return uint64_t(divisor_counts[n]) * divisor_counts[(n + 1)/2];
     }
 }
 
 
-uint64_t get_divisors_count_of_tr(uint64_t n)
+uint64_t find_triangle_with_more_divisors_than(uint64_t count)
 {
-    uint64_t result = 1;
-    for (auto pair : get_prime_factors_of_tr(n))
+    // The divisor counts come from a sieve, which needs a limit: double it until the answer is below.
+    uint32_t begin = 1;
+    for (uint32_t limit = 1 << 14; ; limit *= 2)
     {
-        result *= pair.second + 1;
+        auto divisor_counts = NumberTheory::divisor_count_sieve(limit + 1);
+        for (uint64_t i = begin; i != limit; ++i)
+        {
+            if (get_divisors_count_of_tr(divisor_counts, i) > count)
+            {
+                return triangle(i);
+            }
+        }
+        begin = limit;
     }
-    return result;
 }
 
 
@@ -224,14 +93,6 @@ public:
 int main()
 {
     Stopwatch sw;
-    for (uint64_t i = 2; ; ++i)
-    {
-        auto div = get_divisors_count_of_tr(i);
-        if (div > 500)
-        {
-            std::cout << triangle(i) << std::endl;
-            break;
-        }
-    }
+    std::cout << find_triangle_with_more_divisors_than(500) << std::endl;
     std::cout << sw.ms() << "ms\n";
 }
@@ -0,0 +1,501 @@
+#ifndef NUMBERTHEORY_H_INCLUDED
+#define NUMBERTHEORY_H_INCLUDED
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Factorization and divisor functions for the Euler solvers.
+ *
+ * - SmallestPrimeFactors: table for factorizing every number of a range.
+ * - factorize(), is_prime(): any 64-bit number, with Miller-Rabin and
+ *   Pollard-Brent rho on top of Montgomery multiplication.
+ * - divisor_count_sieve(), divisor_sum_sieve(): d(n) and sigma(n) for a
+ *   whole range, in flat arrays.
+ *
+ * Needs unsigned __int128 (gcc, clang).
+ */
+namespace NumberTheory {
+
+
+struct PrimePower
+{
+    uint64_t prime;
+    unsigned exponent;
+};
+
+
+//! Prime powers in increasing order of the primes.
+typedef std::vector<PrimePower> Factorization;
+
+
+//! Number of divisors of the number with this factorization.
+inline uint64_t divisor_count(const Factorization & factors)
+{
+    uint64_t result = 1;
+    for (const auto & f : factors)
+    {
+        result *= f.exponent + 1;
+    }
+    return result;
+}
+
+
+/**
+ * Smallest prime factor of every number below a limit, from a linear sieve.
+ * Factorizing a number is then one table lookup per prime factor.
+ * Takes 4 bytes per number.
+ */
+class SmallestPrimeFactors
+{
+public:
+    explicit SmallestPrimeFactors(uint32_t limit) :
+        mFactors(std::max<uint32_t>(limit, 2), 0)
+    {
+        for (uint32_t i = 2; i < limit; ++i)
+        {
+            if (mFactors[i] == 0)
+            {
+                mFactors[i] = i;
+                mPrimes.push_back(i);
+            }
+            // Every composite is crossed off exactly once, by its smallest prime factor.
+            for (uint32_t p : mPrimes)
+            {
+                if (p > mFactors[i] || uint64_t(p) * i >= limit)
+                {
+                    break;
+                }
+                mFactors[p * i] = p;
+            }
+        }
+    }
+
+    uint32_t limit() const { return static_cast<uint32_t>(mFactors.size()); }
+
+    //! The primes below the limit.
+    const std::vector<uint32_t> & primes() const { return mPrimes; }
+
+    //! Smallest prime factor of n, for 2 <= n < limit.
+    uint32_t operator[](uint32_t n) const { return mFactors[n]; }
+
+    //! Appends the factorization of n, for 1 <= n < limit.
+    void factorize(uint32_t n, Factorization & factors) const
+    {
+        if (n == 0 || n >= limit())
+        {
+            throw std::out_of_range("SmallestPrimeFactors::factorize: " + std::to_string(n));
+        }
+        while (n > 1)
+        {
+            uint32_t p = mFactors[n];
+            PrimePower f = { p, 0 };
+            do
+            {
+                n /= p;
+                f.exponent++;
+            }
+            while (n % p == 0);
+            factors.push_back(f);
+        }
+    }
+
+    Factorization factorize(uint32_t n) const
+    {
+        Factorization result;
+        factorize(n, result);
+        return result;
+    }
+
+private:
+    std::vector<uint32_t> mFactors;
+    std::vector<uint32_t> mPrimes;
+};
+
+
+/**
+ * Arithmetic modulo an odd n in Montgomery form: x is stored as x * 2^64 mod n,
+ * which turns the division of a modular multiplication into two multiplications.
+ */
+class Montgomery
+{
+public:
+    __extension__ typedef unsigned __int128 uint128_t;
+
+    explicit Montgomery(uint64_t n) :
+        mModulus(n),
+        mInverse(n)
+    {
+        if (n % 2 == 0)
+        {
+            throw std::invalid_argument("Montgomery: even modulus " + std::to_string(n));
+        }
+        // Newton's iteration doubles the number of correct low bits: 3, 6, ..., 96.
+        for (int i = 0; i != 5; ++i)
+        {
+            mInverse *= 2 - n * mInverse;
+        }
+        uint64_t r = (0 - n) % n; // 2^64 mod n
+        mR2 = static_cast<uint64_t>(uint128_t(r) * r % n);
+    }
+
+    uint64_t modulus() const { return mModulus; }
+
+    uint64_t to(uint64_t x) const { return multiply(x % mModulus, mR2); }
+
+    uint64_t from(uint64_t x) const { return reduce(x); }
+
+    uint64_t one() const { return to(1); }
+
+    uint64_t multiply(uint64_t a, uint64_t b) const
+    {
+        return reduce(uint128_t(a) * b);
+    }
+
+    uint64_t add(uint64_t a, uint64_t b) const
+    {
+        uint64_t sum = a + b;
+        return (sum >= mModulus || sum < a) ? sum - mModulus : sum;
+    }
+
+    uint64_t power(uint64_t base, uint64_t exponent) const
+    {
+        uint64_t result = one();
+        for (; exponent; exponent >>= 1)
+        {
+            if (exponent & 1)
+            {
+                result = multiply(result, base);
+            }
+            base = multiply(base, base);
+        }
+        return result;
+    }
+
+private:
+    // t * 2^-64 mod n, for t < n * 2^64.
+    uint64_t reduce(uint128_t t) const
+    {
+        uint64_t q = static_cast<uint64_t>(t) * mInverse;
+        uint64_t high = static_cast<uint64_t>(t >> 64);
+        uint64_t qn = static_cast<uint64_t>((uint128_t(q) * mModulus) >> 64);
+        return high >= qn ? high - qn : high - qn + mModulus;
+    }
+
+    uint64_t mModulus;
+    uint64_t mInverse; // n * mInverse == 1 mod 2^64
+    uint64_t mR2;      // 2^128 mod n
+};
+
+
+inline uint64_t gcd(uint64_t a, uint64_t b)
+{
+    if (a == 0 || b == 0)
+    {
+        return a | b;
+    }
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    do
+    {
+        b >>= __builtin_ctzll(b);
+        if (a > b)
+        {
+            std::swap(a, b);
+        }
+        b -= a;
+    }
+    while (b);
+    return a << shift;
+}
+
+
+namespace Detail {
+
+
+const unsigned cSmallPrimes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97 };
+const uint64_t cSmallPrimeLimit = 101 * 101; // no prime factor up to 97 and below this: prime
+
+
+inline bool is_strong_probable_prime(const Montgomery & mont, uint64_t base)
+{
+    const uint64_t n = mont.modulus();
+    base %= n;
+    if (base == 0)
+    {
+        return true;
+    }
+
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+
+    const uint64_t one = mont.one();
+    const uint64_t minus_one = mont.to(n - 1);
+    uint64_t x = mont.power(mont.to(base), d);
+    if (x == one || x == minus_one)
+    {
+        return true;
+    }
+    for (int i = 1; i < s; ++i)
+    {
+        x = mont.multiply(x, x);
+        if (x == minus_one)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+} // namespace Detail
+
+
+//! Deterministic for all 64-bit numbers.
+inline bool is_prime(uint64_t n)
+{
+    for (unsigned p : Detail::cSmallPrimes)
+    {
+        if (n % p == 0)
+        {
+            return n == p;
+        }
+    }
+    if (n < Detail::cSmallPrimeLimit)
+    {
+        return n > 1;
+    }
+
+    // No composite below 2^32 passes bases 2, 7 and 61 (Jaeschke), and none
+    // below 2^64 passes the seven bases of Jim Sinclair.
+    static const uint64_t small_bases[] = { 2, 7, 61 };
+    static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    const Montgomery mont(n);
+    const bool small = n < (uint64_t(1) << 32);
+    for (unsigned i = 0; i != (small ? 3u : 7u); ++i)
+    {
+        if (!Detail::is_strong_probable_prime(mont, small ? small_bases[i] : bases[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * A non-trivial factor of the odd composite n: Pollard's rho with Brent's
+ * cycle detection. The differences are multiplied together and only every
+ * cBatch steps go through a gcd.
+ */
+inline uint64_t pollard_brent(uint64_t n)
+{
+    if (n % 2 == 0)
+    {
+        return 2;
+    }
+
+    enum { cBatch = 128 };
+    const Montgomery mont(n);
+    auto distance = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+
+    for (uint64_t increment = 1; ; ++increment)
+    {
+        const uint64_t c = mont.to(increment);
+        auto f = [&](uint64_t x) { return mont.add(mont.multiply(x, x), c); };
+
+        uint64_t x = 0, y = mont.to(2), saved = y, product = mont.one(), g = 1;
+        for (uint64_t r = 1; g == 1; r *= 2)
+        {
+            x = y;
+            for (uint64_t i = 0; i != r; ++i)
+            {
+                y = f(y);
+            }
+            for (uint64_t k = 0; k < r && g == 1; k += cBatch)
+            {
+                saved = y;
+                for (uint64_t i = 0; i != std::min<uint64_t>(cBatch, r - k); ++i)
+                {
+                    y = f(y);
+                    product = mont.multiply(product, distance(x, y));
+                }
+                g = gcd(product, n);
+            }
+        }
+
+        if (g == n)
+        {
+            // The batch overshot: step through it again one gcd at a time.
+            do
+            {
+                saved = f(saved);
+                g = gcd(distance(x, saved), n);
+            }
+            while (g == 1);
+        }
+        if (g != n)
+        {
+            return g;
+        }
+        // Try another polynomial.
+    }
+}
+
+
+namespace Detail {
+
+
+inline void factorize_large(uint64_t n, std::vector<uint64_t> & primes)
+{
+    if (n == 1)
+    {
+        return;
+    }
+    if (is_prime(n))
+    {
+        primes.push_back(n);
+        return;
+    }
+    uint64_t d = pollard_brent(n);
+    factorize_large(d, primes);
+    factorize_large(n / d, primes);
+}
+
+
+} // namespace Detail
+
+
+//! Factorization of any 1 <= n < 2^64.
+inline Factorization factorize(uint64_t n)
+{
+    if (n == 0)
+    {
+        throw std::invalid_argument("factorize: 0");
+    }
+
+    Factorization result;
+    for (unsigned p : Detail::cSmallPrimes)
+    {
+        if (n % p == 0)
+        {
+            PrimePower f = { p, 0 };
+            do
+            {
+                n /= p;
+                f.exponent++;
+            }
+            while (n % p == 0);
+            result.push_back(f);
+        }
+    }
+
+    std::vector<uint64_t> primes;
+    Detail::factorize_large(n, primes);
+    std::sort(primes.begin(), primes.end());
+    for (uint64_t p : primes)
+    {
+        if (!result.empty() && result.back().prime == p)
+        {
+            result.back().exponent++;
+        }
+        else
+        {
+            PrimePower f = { p, 1 };
+            result.push_back(f);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * d(n) for 0 <= n < limit (d(0) is left 0), with a linear sieve: every n is
+ * reached once, from n / p for its smallest prime factor p.
+ */
+inline std::vector<uint32_t> divisor_count_sieve(uint32_t limit)
+{
+    std::vector<uint32_t> result(limit, 0);
+    std::vector<uint8_t> exponent(limit, 0); // of the smallest prime factor
+    std::vector<uint32_t> primes;
+    if (limit > 1)
+    {
+        result[1] = 1;
+    }
+    for (uint32_t i = 2; i < limit; ++i)
+    {
+        if (result[i] == 0)
+        {
+            result[i] = 2;
+            exponent[i] = 1;
+            primes.push_back(i);
+        }
+        for (uint32_t p : primes)
+        {
+            uint64_t m = uint64_t(p) * i;
+            if (m >= limit)
+            {
+                break;
+            }
+            if (i % p == 0)
+            {
+                exponent[m] = exponent[i] + 1;
+                result[m] = result[i] / (exponent[i] + 1) * (exponent[i] + 2);
+                break;
+            }
+            exponent[m] = 1;
+            result[m] = result[i] * 2;
+        }
+    }
+    return result;
+}
+
+
+//! sigma(n), the sum of the divisors, for 0 <= n < limit (sigma(0) is left 0).
+inline std::vector<uint64_t> divisor_sum_sieve(uint32_t limit)
+{
+    std::vector<uint64_t> result(limit, 0);
+    std::vector<uint64_t> power_sum(limit, 0); // 1 + p + ... + p^e for the smallest prime factor
+    std::vector<uint32_t> primes;
+    if (limit > 1)
+    {
+        result[1] = 1;
+    }
+    for (uint32_t i = 2; i < limit; ++i)
+    {
+        if (result[i] == 0)
+        {
+            result[i] = power_sum[i] = uint64_t(i) + 1;
+            primes.push_back(i);
+        }
+        for (uint32_t p : primes)
+        {
+            uint64_t m = uint64_t(p) * i;
+            if (m >= limit)
+            {
+                break;
+            }
+            if (i % p == 0)
+            {
+                power_sum[m] = power_sum[i] * p + 1;
+                result[m] = result[i] / power_sum[i] * power_sum[m];
+                break;
+            }
+            power_sum[m] = uint64_t(p) + 1;
+            result[m] = result[i] * (uint64_t(p) + 1);
+        }
+    }
+    return result;
+}
+
+
+} // namespace NumberTheory
+
+
+#endif // NUMBERTHEORY_H_INCLUDED
@@ -0,0 +1,362 @@
+/**
+ * NumberTheory.h against the trial division that Euler 003, 005 and 012 used
+ * before, plus the building blocks on their own.
+ *
+ * The "original" functions are the old solvers, minus their printing.
+ */
+
+
+#include "Benchmark.h"
+#include "NumberTheory.h"
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+namespace Original {
+
+
+// Euler 003 and 005: trial division by all preceding primes.
+bool is_prime(uint64_t n, const std::vector<uint64_t> & preceding)
+{
+    for (const auto & p : preceding)
+    {
+        if (n % p == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+uint64_t next_prime(std::vector<uint64_t> & preceding)
+{
+    if (preceding.empty())
+    {
+        preceding.push_back(2);
+        return preceding.back();
+    }
+    if (preceding.back() == 2)
+    {
+        preceding.push_back(3);
+        return preceding.back();
+    }
+    for (uint64_t n = preceding.back() + 2; ; n += 2)
+    {
+        if (is_prime(n, preceding))
+        {
+            preceding.push_back(n);
+            return preceding.back();
+        }
+    }
+}
+
+
+uint64_t find_largest_prime_factor_of(uint64_t x)
+{
+    std::vector<uint64_t> primes = {2};
+    for (;;)
+    {
+        auto prime = primes.back();
+        if (prime >= x)
+        {
+            return prime;
+        }
+        while (x % prime == 0 && x != 0)
+        {
+            x /= prime;
+        }
+        if (x < 2)
+        {
+            return prime;
+        }
+        next_prime(primes);
+    }
+}
+
+
+std::map<unsigned, unsigned> get_prime_factors(unsigned n)
+{
+    std::map<unsigned, unsigned> result;
+    std::vector<uint64_t> pre = {2};
+    for (unsigned i = 2; i <= n; i = next_prime(pre))
+    {
+        auto copy = n;
+        while (copy % i == 0)
+        {
+            result[i]++;
+            copy /= i;
+        }
+    }
+    return result;
+}
+
+
+uint64_t get_smallest_evenly_divisible(unsigned n)
+{
+    std::map<unsigned, unsigned> result;
+    for (unsigned i = 2; i <= n; ++i)
+    {
+        for (const auto & value_and_count : get_prime_factors(i))
+        {
+            result[value_and_count.first] = std::max(result[value_and_count.first], value_and_count.second);
+        }
+    }
+    uint64_t product = 1;
+    for (const auto & p : result)
+    {
+        for (auto i = 0u; i < p.second; ++i)
+        {
+            product *= p.first;
+        }
+    }
+    return product;
+}
+
+
+// Euler 012: prime factors in a map, with a prime list that grows with n.
+typedef std::map<uint64_t, uint64_t> Map;
+
+
+bool is_prime_below_root(uint64_t n, const std::vector<uint64_t> & preceding)
+{
+    for (auto p : preceding)
+    {
+        if ((p * p) > n)
+        {
+            return true;
+        }
+        if (n % p == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void next_prime_below_root(std::vector<uint64_t> & preceding)
+{
+    if (preceding.size() < 2)
+    {
+        preceding.push_back(preceding.empty() ? 2 : 3);
+        return;
+    }
+    for (uint64_t n = preceding.back() + 2; ; n += 2)
+    {
+        if (is_prime_below_root(n, preceding))
+        {
+            preceding.push_back(n);
+            return;
+        }
+    }
+}
+
+
+Map get_prime_factors(uint64_t n, std::vector<uint64_t> & pre)
+{
+    Map result;
+    while (n > pre.size())
+    {
+        next_prime_below_root(pre);
+    }
+    for (uint64_t i = 0; i < pre.size(); ++i)
+    {
+        auto p = pre[i];
+        while (n % p == 0)
+        {
+            result[p]++;
+            n /= p;
+        }
+        if (p > n)
+        {
+            return result;
+        }
+    }
+    return result;
+}
+
+
+uint64_t find_triangle_with_more_divisors_than(uint64_t count)
+{
+    std::vector<uint64_t> pre;
+    for (uint64_t i = 2; ; ++i)
+    {
+        Map factors = i % 2 == 0 ? get_prime_factors(i / 2, pre) : get_prime_factors(i, pre);
+        for (auto p : (i % 2 == 0 ? get_prime_factors(i + 1, pre) : get_prime_factors((i + 1) / 2, pre)))
+        {
+            factors[p.first] += p.second;
+        }
+        uint64_t divisors = 1;
+        for (auto p : factors)
+        {
+            divisors *= p.second + 1;
+        }
+        if (divisors > count)
+        {
+            return i % 2 == 0 ? (i / 2) * (i + 1) : ((i + 1) / 2) * i;
+        }
+    }
+}
+
+
+// Trial division by 2 and the odd numbers, as a baseline for factorize().
+uint64_t count_prime_factors_by_trial_division(uint64_t n)
+{
+    uint64_t count = 0;
+    for (uint64_t p = 2; p * p <= n; p += (p == 2 ? 1 : 2))
+    {
+        while (n % p == 0)
+        {
+            n /= p;
+            count++;
+        }
+    }
+    return count + (n > 1);
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+uint64_t largest_prime_factor(uint64_t x)
+{
+    return NumberTheory::factorize(x).back().prime;
+}
+
+
+uint64_t smallest_evenly_divisible(unsigned n)
+{
+    const NumberTheory::SmallestPrimeFactors factors(n + 1);
+    std::vector<unsigned> result(n + 1, 0);
+    NumberTheory::Factorization prime_factors;
+    for (unsigned i = 2; i <= n; ++i)
+    {
+        prime_factors.clear();
+        factors.factorize(i, prime_factors);
+        for (const auto & f : prime_factors)
+        {
+            result[f.prime] = std::max(result[f.prime], f.exponent);
+        }
+    }
+    uint64_t product = 1;
+    for (uint32_t p : factors.primes())
+    {
+        for (auto i = 0u; i < result[p]; ++i)
+        {
+            product *= p;
+        }
+    }
+    return product;
+}
+
+
+uint64_t triangle_with_more_divisors_than(uint64_t count)
+{
+    uint32_t begin = 1;
+    for (uint32_t limit = 1 << 14; ; limit *= 2)
+    {
+        auto d = NumberTheory::divisor_count_sieve(limit + 1);
+        for (uint64_t i = begin; i != limit; ++i)
+        {
+            uint64_t divisors = i % 2 == 0 ? uint64_t(d[i / 2]) * d[i + 1] : uint64_t(d[i]) * d[(i + 1) / 2];
+            if (divisors > count)
+            {
+                return i % 2 == 0 ? (i / 2) * (i + 1) : ((i + 1) / 2) * i;
+            }
+        }
+        begin = limit;
+    }
+}
+
+
+void check(const std::string & name, uint64_t value, uint64_t expected)
+{
+    if (value != expected)
+    {
+        throw std::runtime_error(name + ": " + std::to_string(value) + " instead of " + std::to_string(expected));
+    }
+}
+
+
+uint64_t count_prime_factors(const NumberTheory::Factorization & factors)
+{
+    uint64_t count = 0;
+    for (const auto & f : factors)
+    {
+        count += f.exponent;
+    }
+    return count;
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Runner runner(argc, argv);
+
+    // The solvers.
+    runner.run("003/original", [] { check("003/original", Original::find_largest_prime_factor_of(600851475143), 6857); });
+    runner.run("003/factorize", [] { check("003/factorize", largest_prime_factor(600851475143), 6857); });
+    runner.run("005/original", [] { check("005/original", Original::get_smallest_evenly_divisible(20), 232792560); });
+    runner.run("005/SmallestPrimeFactors", [] { check("005/SmallestPrimeFactors", smallest_evenly_divisible(20), 232792560); });
+    runner.run("012/original", [] { check("012/original", Original::find_triangle_with_more_divisors_than(500), 76576500); });
+    runner.run("012/divisor_count_sieve", [] { check("012/divisor_count_sieve", triangle_with_more_divisors_than(500), 76576500); });
+
+    // Factorizing every number of a range, per number.
+    const uint32_t cRange = 1000 * 1000;
+    const uint64_t cRangeFactors = 3626607; // sum of Omega(n) for n < 10^6
+    runner.run_batch("range:1M/trial_division", cRange - 1, []
+    {
+        uint64_t count = 0;
+        for (uint32_t n = 2; n != cRange; ++n)
+        {
+            count += Original::count_prime_factors_by_trial_division(n);
+        }
+        check("range:1M/trial_division", count, cRangeFactors);
+    });
+    runner.run_batch("range:1M/factorize", cRange - 1, []
+    {
+        uint64_t count = 0;
+        for (uint32_t n = 2; n != cRange; ++n)
+        {
+            count += count_prime_factors(NumberTheory::factorize(n));
+        }
+        check("range:1M/factorize", count, cRangeFactors);
+    });
+    runner.run_batch("range:1M/SmallestPrimeFactors", cRange - 1, []
+    {
+        const NumberTheory::SmallestPrimeFactors table(cRange);
+        NumberTheory::Factorization factors;
+        uint64_t count = 0;
+        for (uint32_t n = 2; n != cRange; ++n)
+        {
+            factors.clear();
+            table.factorize(n, factors);
+            count += count_prime_factors(factors);
+        }
+        check("range:1M/SmallestPrimeFactors", count, cRangeFactors);
+    });
+    runner.run_batch("range:1M/divisor_count_sieve", cRange - 1, []
+    {
+        Bench::DoNotOptimize(NumberTheory::divisor_count_sieve(cRange).back());
+    });
+    runner.run_batch("range:1M/divisor_sum_sieve", cRange - 1, []
+    {
+        Bench::DoNotOptimize(NumberTheory::divisor_sum_sieve(cRange).back());
+    });
+
+    // Large 64-bit inputs: a product of two primes close to 2^31, and a prime.
+    const uint64_t cSemiprime = 2147483647ull * 2147483629ull;
+    runner.run("semiprime:2^62/trial_division", [&] { check("semiprime:2^62/trial_division", Original::count_prime_factors_by_trial_division(cSemiprime), 2); });
+    runner.run("semiprime:2^62/factorize", [&] { check("semiprime:2^62/factorize", count_prime_factors(NumberTheory::factorize(cSemiprime)), 2); });
+    runner.run("prime:2^64/is_prime", [] { check("prime:2^64/is_prime", NumberTheory::is_prime(18446744073709551557ull), 1); });
+}
@@ -0,0 +1,411 @@
+#ifndef COLLATZ_H_INCLUDED
+#define COLLATZ_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+// Cycle lengths of the 3n+1 problem: the number of terms from n down to 1,
+// both included, so cycle_length(1) == 1 and cycle_length(22) == 16.
+//
+// The values of a sequence can grow far above its start. The stepping uses
+// 64-bit arithmetic while that is safe and 128-bit arithmetic above, and
+// throws std::overflow_error beyond that.
+namespace Collatz {
+
+
+namespace Detail {
+
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+
+// Odd values below this can take the step (3n+1)/2 in 64 bits. Lower than
+// needed, so that the vector code can compare as signed.
+const uint64_t cSafeLimit = uint64_t(1) << 62;
+
+
+// Steps until n drops below inBound, continuing in 128 bits.
+inline uint32_t wide_steps_below(uint128_t & ioValue, uint64_t inBound)
+{
+	const uint128_t max_odd = ~uint128_t(0) / 3 - 1;
+	uint32_t steps = 0;
+	while (ioValue >= inBound)
+	{
+		if (ioValue & 1)
+		{
+			if (ioValue > max_odd)
+			{
+				throw std::overflow_error("Collatz: sequence exceeds 128 bits");
+			}
+			ioValue = (3 * ioValue + 1) / 2;
+			steps += 2;
+		}
+		else
+		{
+			ioValue /= 2;
+			steps += 1;
+		}
+	}
+	return steps;
+}
+
+
+// Steps until ioValue drops below inBound (> 1), which it does for every
+// start that has been tried so far. Every iteration takes the step 3n+1 and
+// all halvings after it at once, so the value can end up a few halvings
+// below inBound; it is still a value of the sequence.
+inline uint32_t steps_below(uint64_t & ioValue, uint64_t inBound)
+{
+	uint32_t steps = __builtin_ctzll(ioValue);
+	ioValue >>= steps;
+	while (ioValue >= inBound)
+	{
+		if (ioValue >= cSafeLimit)
+		{
+			uint128_t wide = ioValue;
+			steps += wide_steps_below(wide, inBound);
+			ioValue = static_cast<uint64_t>(wide);
+			break;
+		}
+		ioValue = 3 * ioValue + 1; // odd here
+		unsigned zeros = __builtin_ctzll(ioValue);
+		ioValue >>= zeros;
+		steps += 1 + zeros;
+	}
+	return steps;
+}
+
+
+} // namespace Detail
+
+
+// Walks the whole sequence, without memo.
+inline uint32_t cycle_length(uint64_t n)
+{
+	if (n == 0)
+	{
+		throw std::invalid_argument("Collatz: 0 has no cycle length");
+	}
+	return 1 + Detail::steps_below(n, 2);
+}
+
+
+struct Longest
+{
+	uint64_t start;
+	uint32_t length;
+};
+
+
+/**
+ * Cycle lengths with a memo: a table with the cycle length of every number
+ * below a limit, two bytes each. A start at or above the limit is stepped
+ * until it drops below and then finishes with one lookup.
+ *
+ * The table is filled in increasing order, and every sequence drops below
+ * its own start after a few steps, on average, which makes building it cheap.
+ * The object is read-only afterwards and can be shared by threads.
+ */
+class Engine
+{
+public:
+	enum { cDefaultMemoLimit = 1 << 24 };
+
+	explicit Engine(uint32_t inMemoLimit = cDefaultMemoLimit) :
+		mMemo(std::max<uint32_t>(inMemoLimit, 2), 0)
+	{
+		mMemo[1] = 1;
+		for (uint64_t n = 2; n < mMemo.size(); ++n)
+		{
+			uint64_t value = n;
+			uint32_t steps = Detail::steps_below(value, n);
+			mMemo[n] = static_cast<uint16_t>(steps + mMemo[value]);
+		}
+	}
+
+	uint64_t memo_limit() const { return mMemo.size(); }
+
+	uint32_t cycle_length(uint64_t n) const
+	{
+		if (n == 0)
+		{
+			throw std::invalid_argument("Collatz: 0 has no cycle length");
+		}
+		return finish(n, 0);
+	}
+
+	/**
+	 * outLengths[i] = cycle_length(inStarts[i]).
+	 *
+	 * With AVX2, starts far above the memo limit are stepped eight at a
+	 * time. Closer to the limit a sequence needs only a few iterations, and
+	 * the lane bookkeeping and the table lookup cost more than the stepping,
+	 * so those go one at a time. The first start decides for the whole batch.
+	 */
+	void cycle_lengths(const uint64_t * inStarts, size_t inCount, uint32_t * outLengths) const
+	{
+#ifdef __AVX2__
+		if (inCount >= 8 && inStarts[0] / mMemo.size() >= cVectorRatio)
+		{
+			cycle_lengths_avx2(inStarts, inCount, outLengths);
+			return;
+		}
+#endif
+		cycle_lengths_scalar(inStarts, inCount, outLengths);
+	}
+
+	//! One start at a time.
+	void cycle_lengths_scalar(const uint64_t * inStarts, size_t inCount, uint32_t * outLengths) const
+	{
+		for (size_t i = 0; i != inCount; ++i)
+		{
+			outLengths[i] = cycle_length(inStarts[i]);
+		}
+	}
+
+#ifdef __AVX2__
+	/**
+	 * Like cycle_lengths(), but always eight starts at a time, one per 64-bit
+	 * lane of two vectors, which keeps two independent dependency chains in
+	 * flight. Lanes whose value dropped below the memo limit, or grew past
+	 * the safe limit, stop stepping. Every few steps those are finished in
+	 * scalar code and get the next start; checking after every step would
+	 * cost more than it saves.
+	 */
+	void cycle_lengths_avx2(const uint64_t * inStarts, size_t inCount, uint32_t * outLengths) const
+	{
+		enum { cLanes = 8, cStepsPerCheck = 8 };
+		alignas(32) uint64_t values[cLanes];
+		alignas(32) uint64_t steps[cLanes];
+		size_t index[cLanes];
+		bool busy[cLanes];
+		size_t next = 0;
+
+		// Lanes that stopped below the memo limit, waiting for their lookup.
+		size_t pending_index[cLanes];
+		uint64_t pending_values[cLanes];
+		uint64_t pending_steps[cLanes];
+		unsigned pending_count = 0;
+
+		// Gives the lane the next start that needs stepping, answering the
+		// others right away. An idle lane holds 1, which never steps.
+		auto refill = [&](unsigned inLane)
+		{
+			for (; next != inCount; ++next)
+			{
+				uint64_t n = inStarts[next];
+				if (n >= mMemo.size() && n < Detail::cSafeLimit)
+				{
+					index[inLane] = next++;
+					values[inLane] = n;
+					steps[inLane] = 0;
+					busy[inLane] = true;
+					return;
+				}
+				outLengths[next] = cycle_length(n);
+			}
+			values[inLane] = 1;
+			steps[inLane] = 0;
+			busy[inLane] = false;
+		};
+
+		for (unsigned lane = 0; lane != cLanes; ++lane)
+		{
+			refill(lane);
+		}
+
+		const __m256i memo_limit = _mm256_set1_epi64x(static_cast<long long>(mMemo.size()));
+		const __m256i safe_limit = _mm256_set1_epi64x(static_cast<long long>(Detail::cSafeLimit - 1));
+		__m256i * vector_values = reinterpret_cast<__m256i*>(values);
+		__m256i * vector_steps = reinterpret_cast<__m256i*>(steps);
+		for (;;)
+		{
+			// Named variables, not arrays, so that they stay in registers.
+			__m256i v0 = _mm256_load_si256(vector_values), v1 = _mm256_load_si256(vector_values + 1);
+			__m256i s0 = _mm256_load_si256(vector_steps), s1 = _mm256_load_si256(vector_steps + 1);
+			for (unsigned k = 0; k != cStepsPerCheck; ++k)
+			{
+				step_lanes(v0, s0, memo_limit, safe_limit);
+				step_lanes(v1, s1, memo_limit, safe_limit);
+			}
+			_mm256_store_si256(vector_values, v0);
+			_mm256_store_si256(vector_values + 1, v1);
+			_mm256_store_si256(vector_steps, s0);
+			_mm256_store_si256(vector_steps + 1, s1);
+
+			// The table lookups of the lanes that stopped at the previous
+			// check have had some steps' time to arrive from memory.
+			for (unsigned i = 0; i != pending_count; ++i)
+			{
+				outLengths[pending_index[i]] = static_cast<uint32_t>(pending_steps[i]) + mMemo[pending_values[i]];
+			}
+			pending_count = 0;
+
+			bool any_busy = false;
+			for (unsigned lane = 0; lane != cLanes; ++lane)
+			{
+				if (busy[lane] && values[lane] < mMemo.size())
+				{
+					__builtin_prefetch(&mMemo[values[lane]]);
+					pending_index[pending_count] = index[lane];
+					pending_values[pending_count] = values[lane];
+					pending_steps[pending_count] = steps[lane];
+					pending_count++;
+					refill(lane);
+				}
+				else if (busy[lane] && values[lane] >= Detail::cSafeLimit)
+				{
+					outLengths[index[lane]] = finish(values[lane], static_cast<uint32_t>(steps[lane]));
+					refill(lane);
+				}
+				any_busy = any_busy || busy[lane];
+			}
+			if (!any_busy)
+			{
+				for (unsigned i = 0; i != pending_count; ++i)
+				{
+					outLengths[pending_index[i]] = static_cast<uint32_t>(pending_steps[i]) + mMemo[pending_values[i]];
+				}
+				return;
+			}
+		}
+	}
+#endif
+
+	/**
+	 * The start in [a, b] with the longest cycle, the smallest one on ties.
+	 *
+	 * For n <= b/2, 2n is in range and one step longer, so only the upper
+	 * half of the range is searched. Threads claim blocks of it from an
+	 * atomic cursor.
+	 */
+	Longest max_cycle_length(uint64_t a, uint64_t b, unsigned inThreads = std::thread::hardware_concurrency()) const
+	{
+		if (a == 0 || a > b)
+		{
+			throw std::invalid_argument("Collatz: bad range [" + std::to_string(a) + ", " + std::to_string(b) + "]");
+		}
+		const uint64_t first = std::max(a, b / 2 + 1);
+		const uint64_t blocks = (b - first) / cBlockSize + 1;
+		const unsigned thread_count = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(inThreads, blocks)));
+
+		std::atomic<uint64_t> cursor(0);
+		std::vector<Longest> results(thread_count);
+		auto worker = [&](unsigned t)
+		{
+			std::vector<uint64_t> starts(cBlockSize);
+			std::vector<uint32_t> lengths(cBlockSize);
+			Longest best = { 0, 0 };
+			for (uint64_t block; (block = cursor.fetch_add(1, std::memory_order_relaxed)) < blocks; )
+			{
+				uint64_t begin = first + block * cBlockSize;
+				size_t count = static_cast<size_t>(std::min<uint64_t>(cBlockSize, b - begin + 1));
+				for (size_t i = 0; i != count; ++i)
+				{
+					starts[i] = begin + i;
+				}
+				cycle_lengths(starts.data(), count, lengths.data());
+				for (size_t i = 0; i != count; ++i)
+				{
+					if (lengths[i] > best.length)
+					{
+						best.start = starts[i];
+						best.length = lengths[i];
+					}
+				}
+			}
+			results[t] = best;
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 1; t < thread_count; ++t)
+		{
+			threads.push_back(std::thread(worker, t));
+		}
+		worker(0);
+		for (auto & thread : threads)
+		{
+			thread.join();
+		}
+
+		Longest best = results[0];
+		for (const Longest & result : results)
+		{
+			if (result.length > best.length || (result.length == best.length && result.start < best.start))
+			{
+				best = result;
+			}
+		}
+		return best;
+	}
+
+private:
+	enum
+	{
+		cBlockSize = 4096,
+		cVectorRatio = 1024 // start / memo limit from which the vector code wins, measured on an AVX-512 Xeon
+	};
+
+	// inSteps plus the cycle length of n.
+	uint32_t finish(uint64_t n, uint32_t inSteps) const
+	{
+		inSteps += Detail::steps_below(n, mMemo.size());
+		return inSteps + mMemo[n];
+	}
+
+#ifdef __AVX2__
+	// Trailing zero bits of every lane. Without AVX-512 at most 8: the lanes
+	// are then shifted further in the next iterations.
+	static __m256i trailing_zeros(__m256i inValues)
+	{
+#if defined(__AVX512CD__) && defined(__AVX512VL__)
+		__m256i lowest = _mm256_and_si256(inValues, _mm256_sub_epi64(_mm256_setzero_si256(), inValues));
+		return _mm256_sub_epi64(_mm256_set1_epi64x(63), _mm256_lzcnt_epi64(lowest));
+#else
+		// Per byte from the trailing zeros of each nibble; only the lowest byte counts.
+		const __m256i table = _mm256_setr_epi8(4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+		                                       4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0);
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i four = _mm256_set1_epi8(4);
+		__m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(inValues, nibble));
+		__m256i high = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(inValues, 4), nibble)), four);
+		__m256i zeros = _mm256_blendv_epi8(low, high, _mm256_cmpeq_epi8(low, four));
+		return _mm256_and_si256(zeros, _mm256_set1_epi64x(0xFF));
+#endif
+	}
+
+	// Like Detail::steps_below(), one iteration for the lanes that are still
+	// at or above inMemoLimit and not above inSafeLimit: 3n+1 if odd, then
+	// the halvings.
+	static void step_lanes(__m256i & ioValues, __m256i & ioSteps, __m256i inMemoLimit, __m256i inSafeLimit)
+	{
+		const __m256i one = _mm256_set1_epi64x(1);
+		// Signed compares, fine since the values stay below 2^63.
+		__m256i stop = _mm256_or_si256(_mm256_cmpgt_epi64(inMemoLimit, ioValues), _mm256_cmpgt_epi64(ioValues, inSafeLimit));
+		__m256i odd = _mm256_and_si256(ioValues, one);
+		__m256i odd_mask = _mm256_sub_epi64(_mm256_setzero_si256(), odd);
+		__m256i tripled = _mm256_add_epi64(ioValues, _mm256_and_si256(_mm256_add_epi64(_mm256_add_epi64(ioValues, ioValues), one), odd_mask));
+		__m256i zeros = trailing_zeros(tripled);
+		ioValues = _mm256_blendv_epi8(_mm256_srlv_epi64(tripled, zeros), ioValues, stop);
+		ioSteps = _mm256_add_epi64(ioSteps, _mm256_andnot_si256(stop, _mm256_add_epi64(odd, zeros)));
+	}
+#endif
+
+	std::vector<uint16_t> mMemo;
+};
+
+
+} // namespace Collatz
+
+
+#endif // COLLATZ_H_INCLUDED
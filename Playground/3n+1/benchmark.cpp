@@ -0,0 +1,185 @@
+#include "Benchmark.h"
+#include "Collatz.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Collatz cycle lengths: the walk that main.cpp used before against the
+// engine, per start and in batches, and the longest cycle over [1, limit)
+// for several memo sizes and thread counts. One operation is one start.
+//
+//   benchmark [limit]      (default 1000000000)
+//
+// Every run is checked: against the known answer for the default limit,
+// and against the first run otherwise.
+
+
+namespace Original {
+
+
+// main.cpp before the engine; wraps around for starts whose sequence
+// leaves 32 bits.
+unsigned cycle_length(unsigned n)
+{
+	unsigned count = 1;
+	while (n != 1)
+	{
+		if (n%2 == 0)
+		{
+			n /= 2;
+		}
+		else
+		{
+			n *= 3;
+			n += 1;
+		}
+		count++;
+	}
+	return count;
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+void check(const std::string & name, uint64_t value, uint64_t expected)
+{
+	if (value != expected)
+	{
+		throw std::runtime_error(name + ": " + std::to_string(value) + " instead of " + std::to_string(expected));
+	}
+}
+
+
+uint64_t sum(const std::vector<uint32_t> & inLengths)
+{
+	uint64_t result = 0;
+	for (uint32_t length : inLengths)
+	{
+		result += length;
+	}
+	return result;
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+	Bench::Options defaults;
+	defaults.repetitions = 3;
+	defaults.warmup = 0;
+	Bench::Runner runner(argc, argv, defaults);
+
+	const uint64_t cDefaultLimit = 1000 * 1000 * 1000;
+	uint64_t limit = cDefaultLimit;
+	if (!runner.options().arguments.empty())
+	{
+		limit = std::strtoull(runner.options().arguments[0].c_str(), 0, 10);
+		if (limit < 2)
+		{
+			throw std::invalid_argument("Limit must be at least 2: " + runner.options().arguments[0]);
+		}
+	}
+
+	const Collatz::Engine engine;
+
+	// Per start, for the starts below 10^5, whose sequences fit in 32 bits;
+	// some below 10^6 do not.
+	const uint32_t cSmall = 100 * 1000;
+	std::vector<uint64_t> small_starts;
+	for (uint32_t n = 1; n != cSmall; ++n)
+	{
+		small_starts.push_back(n);
+	}
+	const uint64_t cSmallSum = 10853711; // sum of the cycle lengths below 10^5
+	std::vector<uint32_t> lengths(small_starts.size());
+	runner.run_batch("small/original", small_starts.size(), [&]
+	{
+		uint64_t total = 0;
+		for (uint32_t n = 1; n != cSmall; ++n)
+		{
+			total += Original::cycle_length(n);
+		}
+		check("small/original", total, cSmallSum);
+	});
+	runner.run_batch("small/cycle_length", small_starts.size(), [&]
+	{
+		uint64_t total = 0;
+		for (uint64_t n : small_starts)
+		{
+			total += Collatz::cycle_length(n);
+		}
+		check("small/cycle_length", total, cSmallSum);
+	});
+	runner.run_batch("small/engine", small_starts.size(), [&]
+	{
+		engine.cycle_lengths(small_starts.data(), small_starts.size(), lengths.data());
+		check("small/engine", sum(lengths), cSmallSum);
+	});
+
+	// In batches, far above the memo limit, where the lanes pay off.
+	const size_t cFar = 1000 * 1000;
+	std::vector<uint64_t> far_starts;
+	for (uint64_t n = uint64_t(1) << 40; far_starts.size() != cFar; ++n)
+	{
+		far_starts.push_back(n);
+	}
+	lengths.resize(far_starts.size());
+	uint64_t far_sum = 0;
+	for (uint64_t n : far_starts)
+	{
+		far_sum += Collatz::cycle_length(n);
+	}
+	runner.run_batch("far:2^40/cycle_length", far_starts.size(), [&]
+	{
+		uint64_t total = 0;
+		for (uint64_t n : far_starts)
+		{
+			total += Collatz::cycle_length(n);
+		}
+		check("far:2^40/cycle_length", total, far_sum);
+	});
+	runner.run_batch("far:2^40/engine_scalar", far_starts.size(), [&]
+	{
+		engine.cycle_lengths_scalar(far_starts.data(), far_starts.size(), lengths.data());
+		check("far:2^40/engine_scalar", sum(lengths), far_sum);
+	});
+#ifdef __AVX2__
+	runner.run_batch("far:2^40/engine_avx2", far_starts.size(), [&]
+	{
+		engine.cycle_lengths_avx2(far_starts.data(), far_starts.size(), lengths.data());
+		check("far:2^40/engine_avx2", sum(lengths), far_sum);
+	});
+#endif
+
+	// The longest cycle over [1, limit).
+	Collatz::Longest expected = { 670617279, 987 };
+	bool known = limit == cDefaultLimit;
+	for (unsigned memo_bits : { 16u, 20u, 24u })
+	{
+		const Collatz::Engine range_engine(1u << memo_bits);
+		for (unsigned threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+		{
+			const std::string name = "range/memo:2^" + std::to_string(memo_bits) + "/threads:" + std::to_string(threads);
+			runner.run_batch(name, limit - 1, [&]
+			{
+				Collatz::Longest longest = range_engine.max_cycle_length(1, limit - 1, threads);
+				if (!known)
+				{
+					expected = longest;
+					known = true;
+				}
+				check(name + " start", longest.start, expected.start);
+				check(name + " length", longest.length, expected.length);
+			});
+		}
+	}
+}
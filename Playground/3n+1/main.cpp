@@ -1,55 +1,24 @@
+#include "Collatz.h"
 #include <algorithm>
 #include <iostream>
 
 // For mor information see:
 // http://www.programming-challenges.com/english/pdfs/110101.pdf
 
-unsigned cycle_length(unsigned n)
+// The problem gives i and j in either order.
+void print_max_cycle_length(const Collatz::Engine & engine, uint64_t a, uint64_t b)
 {
-	unsigned count = 1;
-	while (n != 1)
-	{
-		if (n%2 == 0)
-		{
-			n /= 2;
-		}
-		else
-		{
-			n *= 3;
-			n += 1;
-		}
-		count++;
-	}
-	return count;
-}
-
-
-unsigned max_cycle_length(unsigned a, unsigned b)
-{
-	unsigned result = cycle_length(a);
-	for (unsigned i = a + 1; i <= b; ++i)
-	{
-		unsigned len = cycle_length(i);
-		if (len > result)
-		{
-			result = len;
-		}
-	}
-	return result;
-}
-
-
-void print_max_cycle_length(unsigned a, unsigned b)
-{
-	std::cout << a << " " << b << " " << max_cycle_length(a, b) << std::endl;
+	Collatz::Longest longest = engine.max_cycle_length(std::min(a, b), std::max(a, b));
+	std::cout << a << " " << b << " " << longest.length << std::endl;
 }
 
 
 int main()
 {
-	print_max_cycle_length(1   , 10);
-	print_max_cycle_length(100 , 200);
-	print_max_cycle_length(201 , 210);
-	print_max_cycle_length(900 , 1000);
+	const Collatz::Engine engine(1 << 16);
+	print_max_cycle_length(engine, 1   , 10);
+	print_max_cycle_length(engine, 100 , 200);
+	print_max_cycle_length(engine, 201 , 210);
+	print_max_cycle_length(engine, 900 , 1000);
 	return 0;
 }
@@ -0,0 +1,404 @@
+#ifndef ACTOR_H_INCLUDED
+#define ACTOR_H_INCLUDED
+
+
+#include "InplaceFunction.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Bounded lock-free multi-producer single-consumer queue.
+ * This is Dmitry Vyukov's bounded MPMC queue with the consumer side reduced
+ * to a plain index, because only one worker drains a mailbox at a time.
+ */
+template<typename T, std::size_t Capacity>
+class Mailbox
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+    Mailbox() : mTail(0), mHead(0)
+    {
+        for (std::size_t i = 0; i != Capacity; ++i)
+        {
+            mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    //! Thread-safe. Returns false (and leaves value untouched) if the mailbox is full.
+    bool try_push(T&& value)
+    {
+        Slot* slot;
+        std::size_t pos = mTail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot = &mSlots[pos & (Capacity - 1)];
+            std::size_t seq = slot->mSequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->mValue = std::move(value);
+        slot->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! Consumer only. Returns false if the next slot has not been published yet.
+    bool try_pop(T& value)
+    {
+        Slot& slot = mSlots[mHead & (Capacity - 1)];
+        if (slot.mSequence.load(std::memory_order_acquire) != mHead + 1)
+        {
+            return false;
+        }
+        value = std::move(slot.mValue);
+        slot.mSequence.store(mHead + Capacity, std::memory_order_release);
+        ++mHead;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> mSequence;
+        T mValue;
+    };
+
+    // Padding instead of alignas, so that actors can still be created with
+    // plain operator new in C++11.
+    enum { cCacheLineSize = 64 };
+
+    std::atomic<std::size_t> mTail;
+    char mPadding1[cCacheLineSize - sizeof(std::atomic<std::size_t>)];
+    std::size_t mHead;
+    char mPadding2[cCacheLineSize - sizeof(std::size_t)];
+    Slot mSlots[Capacity];
+};
+
+
+class ActorRuntime;
+
+
+/**
+ * ActorBase contains the scheduling state shared by all actors.
+ *
+ * mPending counts the messages that were pushed but not yet processed. The
+ * sender that raises it from zero hands the actor to the runtime, and the
+ * worker that lowers it back to zero releases it. So an actor is queued at
+ * most once and never runs on two workers at the same time.
+ */
+class ActorBase
+{
+public:
+    ActorBase(const ActorBase&) = delete;
+    ActorBase& operator=(const ActorBase&) = delete;
+
+protected:
+    explicit ActorBase(ActorRuntime& inRuntime) : mRuntime(inRuntime), mPending(0)
+    {
+    }
+
+    virtual ~ActorBase()
+    {
+    }
+
+    // Must be called after each successful push into the mailbox.
+    inline void notify();
+
+    // Blocks until all pushed messages have been processed.
+    void wait_idle() const
+    {
+        while (mPending.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    friend class ActorRuntime;
+
+    // Processes exactly inCount messages. Called by one worker at a time.
+    virtual void drain(std::size_t inCount) = 0;
+
+    ActorRuntime& mRuntime;
+    std::atomic<std::size_t> mPending;
+};
+
+
+/**
+ * ActorRuntime multiplexes any number of actors onto a fixed pool of worker
+ * threads. Workers sleep on a condition variable when there is no work and
+ * are woken up only when an idle actor receives a message.
+ *
+ * All actors must be destroyed before their runtime.
+ */
+class ActorRuntime
+{
+public:
+    //! Maximum number of messages an actor processes before yielding its worker.
+    enum { cBatchSize = 64 };
+
+    explicit ActorRuntime(unsigned inWorkerCount = std::max(1u, std::thread::hardware_concurrency())) :
+        mIdleCount(0),
+        mQuit(false)
+    {
+        mWorkers.reserve(inWorkerCount);
+        for (unsigned i = 0; i != inWorkerCount; ++i)
+        {
+            mWorkers.push_back(std::thread([this]{ this->worker(); }));
+        }
+    }
+
+    ActorRuntime(const ActorRuntime&) = delete;
+    ActorRuntime& operator=(const ActorRuntime&) = delete;
+
+    ~ActorRuntime()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mCondition.notify_all();
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+    }
+
+    std::size_t worker_count() const
+    {
+        return mWorkers.size();
+    }
+
+private:
+    friend class ActorBase;
+
+    void schedule(ActorBase* inActor)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mReady.push_back(inActor);
+        bool wakeup = mIdleCount != 0;
+        lock.unlock();
+        if (wakeup)
+        {
+            mCondition.notify_one();
+        }
+    }
+
+    void worker()
+    {
+        for (;;)
+        {
+            ActorBase* actor;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                while (mReady.empty() && !mQuit)
+                {
+                    ++mIdleCount;
+                    mCondition.wait(lock);
+                    --mIdleCount;
+                }
+                if (mReady.empty())
+                {
+                    return;
+                }
+                actor = mReady.front();
+                mReady.pop_front();
+            }
+
+            // Only counted messages are drained. Their producers have already
+            // claimed a slot, so drain never waits for a push that did not start.
+            std::size_t pending = actor->mPending.load(std::memory_order_acquire);
+            std::size_t count = std::min<std::size_t>(pending, cBatchSize);
+            actor->drain(count);
+
+            // The actor may be destroyed as soon as the counter hits zero,
+            // so this is the last access unless more messages are waiting.
+            if (actor->mPending.fetch_sub(count, std::memory_order_acq_rel) != count)
+            {
+                schedule(actor);
+            }
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<ActorBase*> mReady;
+    unsigned mIdleCount;
+    bool mQuit;
+    std::vector<std::thread> mWorkers;
+};
+
+
+inline void ActorBase::notify()
+{
+    if (mPending.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        mRuntime.schedule(this);
+    }
+}
+
+
+/**
+ * Actor owns an object of type T and serializes all access to it through
+ * its mailbox. Messages are processed in batches on the runtime's workers.
+ *
+ * The mailbox is bounded. Senders yield while it is full, so an actor should
+ * not send more than MailboxCapacity messages to another actor from within a
+ * single message handler when the runtime has only one worker.
+ */
+template<typename T, std::size_t MailboxCapacity = 256>
+class Actor : public ActorBase
+{
+public:
+    template<typename ...Args>
+    explicit Actor(ActorRuntime& inRuntime, Args&& ...args) :
+        ActorBase(inRuntime),
+        mMailbox(),
+        mObject(std::forward<Args>(args)...)
+    {
+    }
+
+    //! No messages may be sent while the actor is being destroyed.
+    ~Actor()
+    {
+        wait_idle();
+    }
+
+    //! Fire-and-forget: f(T&) will run on one of the runtime's workers.
+    template<typename F>
+    void send(F f)
+    {
+        push(Task(Message<F>(mObject, std::move(f))));
+    }
+
+    //! Like send, but returns a future for the result of f(T&).
+    template<typename F>
+    auto execute(F f) -> std::future<typename std::result_of<F(T&)>::type>
+    {
+        typedef typename std::result_of<F(T&)>::type Ret;
+        std::promise<Ret> promise;
+        std::future<Ret> future = promise.get_future();
+        push(Task(PromiseMessage<Ret, F>(mObject, std::move(promise), std::move(f))));
+        return future;
+    }
+
+private:
+    typedef InplaceFunction<void()> Task;
+
+    template<typename F>
+    struct Message
+    {
+        Message(T& obj, F&& f) : mObject(&obj), mFunction(std::move(f)) {}
+
+        void operator()() { mFunction(*mObject); }
+
+        T* mObject;
+        F mFunction;
+    };
+
+    template<typename R, typename F>
+    struct PromiseMessage
+    {
+        PromiseMessage(T& obj, std::promise<R>&& p, F&& f) : mObject(&obj), mPromise(std::move(p)), mFunction(std::move(f)) {}
+
+        void operator()()
+        {
+            try
+            {
+                mPromise.set_value(mFunction(*mObject));
+            }
+            catch (...)
+            {
+                mPromise.set_exception(std::current_exception());
+            }
+        }
+
+        T* mObject;
+        std::promise<R> mPromise;
+        F mFunction;
+    };
+
+    template<typename F>
+    struct PromiseMessage<void, F>
+    {
+        PromiseMessage(T& obj, std::promise<void>&& p, F&& f) : mObject(&obj), mPromise(std::move(p)), mFunction(std::move(f)) {}
+
+        void operator()()
+        {
+            try
+            {
+                mFunction(*mObject);
+                mPromise.set_value();
+            }
+            catch (...)
+            {
+                mPromise.set_exception(std::current_exception());
+            }
+        }
+
+        T* mObject;
+        std::promise<void> mPromise;
+        F mFunction;
+    };
+
+    void push(Task&& task)
+    {
+        while (!mMailbox.try_push(std::move(task)))
+        {
+            std::this_thread::yield();
+        }
+        notify();
+    }
+
+    virtual void drain(std::size_t inCount)
+    {
+        Task task;
+        while (inCount != 0)
+        {
+            // A producer may have claimed an earlier slot without having
+            // published it yet. That window is a few instructions long.
+            if (!mMailbox.try_pop(task))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            task();
+            task.reset();
+            --inCount;
+        }
+    }
+
+    Mailbox<Task, MailboxCapacity> mMailbox;
+    T mObject;
+};
+
+
+#endif // ACTOR_H_INCLUDED
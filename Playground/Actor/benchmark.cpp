@@ -0,0 +1,107 @@
+#include "Actor.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+// Ping-pong: two actors bounce a message back and forth.
+// Fan-out: one producer thread sprays messages over many actors.
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+struct Counter
+{
+    Counter() : value() {}
+    uint64_t value;
+};
+
+
+typedef Actor<Counter> CounterActor;
+
+
+void bounce(CounterActor& self, CounterActor& other, unsigned remaining, std::promise<void>* done)
+{
+    self.send([&self, &other, remaining, done](Counter& counter)
+    {
+        ++counter.value;
+        if (remaining == 0)
+        {
+            done->set_value();
+            return;
+        }
+        bounce(other, self, remaining - 1, done);
+    });
+}
+
+
+double ping_pong(unsigned inWorkers, unsigned inRoundTrips)
+{
+    // The last message may still be in set_value() when the wait returns,
+    // so the promise has to outlive the actors, which wait until idle.
+    std::promise<void> done;
+    ActorRuntime runtime(inWorkers);
+    CounterActor ping(runtime), pong(runtime);
+    auto start = Clock::now();
+    bounce(ping, pong, 2 * inRoundTrips, &done);
+    done.get_future().wait();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / inRoundTrips;
+}
+
+
+double fan_out(unsigned inWorkers, unsigned inActors, unsigned inMessages)
+{
+    ActorRuntime runtime(inWorkers);
+    std::vector<std::unique_ptr<CounterActor>> actors;
+    for (unsigned i = 0; i != inActors; ++i)
+    {
+        actors.emplace_back(new CounterActor(runtime));
+    }
+
+    auto start = Clock::now();
+    for (unsigned i = 0; i != inMessages; ++i)
+    {
+        actors[i % inActors]->send([](Counter& counter) { ++counter.value; });
+    }
+
+    uint64_t total = 0;
+    for (auto& actor : actors)
+    {
+        total += actor->execute([](Counter& counter) { return counter.value; }).get();
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (total != inMessages)
+    {
+        std::cerr << "Lost messages: " << total << "/" << inMessages << std::endl;
+    }
+    return inMessages / elapsed;
+}
+
+
+int main()
+{
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> worker_counts{1, 2, 4};
+    if (hw > 4)
+    {
+        worker_counts.push_back(hw);
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "ping-pong (ns per round trip)" << std::endl;
+    for (unsigned workers : worker_counts)
+    {
+        std::cout << "  workers=" << std::setw(3) << workers << ": " << ping_pong(workers, 200 * 1000) << std::endl;
+    }
+
+    std::cout << "fan-out 1000 actors (million messages/s)" << std::endl;
+    for (unsigned workers : worker_counts)
+    {
+        std::cout << "  workers=" << std::setw(3) << workers << ": " << fan_out(workers, 1000, 4 * 1000 * 1000) / 1e6 << std::endl;
+    }
+}
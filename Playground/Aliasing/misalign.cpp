@@ -1,132 +1,393 @@
+#include "Benchmark.h"
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
-#include <stdexcept>
+#include <map>
+#include <sstream>
 #include <vector>
-#include <cxxabi.h>
+#include <immintrin.h>
 #include <stdint.h>
-#include <sys/time.h>
-#include <typeinfo>
+#include <stdlib.h>
 
 
-struct u128 { uint64_t a, b; };
-struct u256 { u128 a, b; };
-struct u512 { u256 a, b; };
-struct u1024 { u512 a, b; };
+// Cost of unaligned loads, over load widths, load strategies and the
+// position of the load relative to cache lines and pages.
+//
+//   unaligned/<strategy>/width:<W>/offset:<O>
+//       Loads of W bytes at offset O (0 .. 63) into consecutive cache lines
+//       of an L1-resident buffer. Offsets with O + W > 64 split a line.
+//   page/<strategy>/width:<W>/<position>
+//       Loads one per page, either aligned, splitting a cache line inside the
+//       page, or splitting the page itself.
+//
+// Strategies for the widths of integers, as used to decode packet fields:
+//   cast      dereference a reinterpret_cast pointer (undefined behaviour, works on x86)
+//   memcpy, memmove, std_copy
+// Strategies for wider loads, all of them unaligned:
+//   scalar    8-byte memcpy loads
+//   sse, avx, avx512   _mm*_loadu_* of 16, 32 and 64 bytes
+//
+// One operation is one load of W bytes. For the numbers in a form that
+// scripts can read, pass --format=json or --format=csv, e.g.
+//   ./test --format=csv --out=misalign.csv
+// The summary at the end compares the mean cost of the offsets that stay
+// in one line with those that split one.
 
 
-struct counter_t
+enum
 {
-    counter_t() : value() {}
+    cLineSize = 64,
+    cPageSize = 4096,
+    cLines = 256,       // 16 KB, fits in L1
+    cPasses = 64,
+    cPages = 64         // one load per page, within the L1 TLB
+};
+
+
+// Vector registers wrapped in structs: vector types lose their attributes
+// as template arguments.
+#ifdef __SSE2__
+struct V128 { __m128i v; };
+inline V128 Combine(V128 a, V128 b) { V128 r = { _mm_xor_si128(a.v, b.v) }; return r; }
+#endif
+#ifdef __AVX2__
+struct V256 { __m256i v; };
+inline V256 Combine(V256 a, V256 b) { V256 r = { _mm256_xor_si256(a.v, b.v) }; return r; }
+#endif
+#ifdef __AVX512F__
+struct V512 { __m512i v; };
+inline V512 Combine(V512 a, V512 b) { V512 r = { _mm512_xor_si512(a.v, b.v) }; return r; }
+#endif
+
+template<typename T> T Combine(T a, T b) { return a ^ b; }
 
-    operator uint64_t() const { return value; }
 
-    void operator+=(uint16_t v) { value = v; }
-    void operator+=(uint32_t v) { value = v; }
-    void operator+=(uint64_t v) { value = v; }
-    void operator+=(u128 v)     { value = v.a; }
-    void operator+=(u256 v)     { value = v.b.a; }
-    void operator+=(u512 v)     { value = v.a.b.a; }
-    void operator+=(u1024 v)     { value = v.a.b.a.b; }
+template<typename T>
+struct Cast
+{
+    typedef T Value;
+    static const char * Name() { return "cast"; }
+    static T Load(const char * p) { return *reinterpret_cast<const T*>(p); }
+};
 
 
-    uint64_t value;
+template<typename T>
+struct Memcpy
+{
+    typedef T Value;
+    static const char * Name() { return "memcpy"; }
+    static T Load(const char * p) { T t; std::memcpy(&t, p, sizeof(t)); return t; }
+};
+
+
+template<typename T>
+struct Memmove
+{
+    typedef T Value;
+    static const char * Name() { return "memmove"; }
+    static T Load(const char * p) { T t; std::memmove(&t, p, sizeof(t)); return t; }
 };
 
 
-counter_t counter;
+template<typename T>
+struct StdCopy
+{
+    typedef T Value;
+    static const char * Name() { return "std_copy"; }
+    static T Load(const char * p) { T t; std::copy(p, p + sizeof(t), reinterpret_cast<char*>(&t)); return t; }
+};
 
 
-std::string demangle(const char * name)
+// Width bytes as a sequence of loads of the given vector type.
+template<typename Vector, unsigned Width, Vector (*LoadOne)(const char *)>
+struct Wide
 {
-    int st;
-    char * const p = abi::__cxa_demangle(name, 0, 0, &st);
+    typedef Vector Value;
 
-    if (st != 0)
+    static Vector Load(const char * p)
     {
-        switch (st)
+        Vector result = LoadOne(p);
+        for (unsigned i = sizeof(Vector); i != Width; i += sizeof(Vector))
         {
-            case -1: throw std::runtime_error("A memory allocation failure occurred.");
-            case -2: throw std::runtime_error("Not a valid name under the GCC C++ ABI mangling rules.");
-            case -3: throw std::runtime_error("One of the arguments is invalid.");
-            default: throw std::runtime_error("Unexpected demangle status");
+            result = Combine(result, LoadOne(p + i));
         }
+        return result;
     }
+};
 
-    std::string result(p);
-    free(p);
-    return result;
-}
 
+inline uint64_t LoadScalar(const char * p) { return Memcpy<uint64_t>::Load(p); }
 
+template<unsigned Width>
+struct Scalar : Wide<uint64_t, Width, &LoadScalar>
+{
+    static const char * Name() { return "scalar"; }
+};
 
-const unsigned iterations = 100000;
 
+#ifdef __SSE2__
+inline V128 LoadSSE(const char * p) { V128 r = { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; return r; }
+
+template<unsigned Width>
+struct SSE : Wide<V128, Width, &LoadSSE>
+{
+    static const char * Name() { return "sse"; }
+};
+#endif
 
-template<typename T>
-struct Header { T a, b, c; };
 
+#ifdef __AVX2__
+inline V256 LoadAVX(const char * p) { V256 r = { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; return r; }
 
-double get_current_time()
+template<unsigned Width>
+struct AVX : Wide<V256, Width, &LoadAVX>
 {
-    timeval tv;
-    gettimeofday(&tv, NULL);
-    return double (tv.tv_sec) + 0.000001 * tv.tv_usec;
-}
+    static const char * Name() { return "avx"; }
+};
+#endif
 
 
-template<typename T>
-std::vector<uint8_t> get_buffer()
+#ifdef __AVX512F__
+inline V512 LoadAVX512(const char * p) { V512 r = { _mm512_loadu_si512(p) }; return r; }
+
+template<unsigned Width>
+struct AVX512 : Wide<V512, Width, &LoadAVX512>
+{
+    static const char * Name() { return "avx512"; }
+};
+#endif
+
+
+// Page-aligned buffer filled with arbitrary bytes.
+struct Buffer
 {
-    std::vector<uint8_t> buffer(sizeof(long) + sizeof(Header<T>) * iterations);
-    for (std::vector<uint8_t>::size_type i = 0; i != buffer.size(); ++i)
+    explicit Buffer(std::size_t inSize) : mData(0)
     {
-        buffer[i] = buffer.size();
+        if (posix_memalign(reinterpret_cast<void**>(&mData), cPageSize, inSize) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        for (std::size_t i = 0; i != inSize; ++i)
+        {
+            mData[i] = static_cast<char>(i * 131);
+        }
     }
-    std::random_shuffle(buffer.begin(), buffer.end());
-    return buffer;
+
+    ~Buffer() { free(mData); }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    char * mData;
+};
+
+
+//! Loads at inData + i * inStride for i in [0, inCount), inPasses times.
+template<typename Loader>
+void Loads(const char * inData, std::size_t inStride, std::size_t inCount, unsigned inPasses)
+{
+    typename Loader::Value result = typename Loader::Value();
+    for (unsigned pass = 0; pass != inPasses; ++pass)
+    {
+        const char * p = inData;
+        for (std::size_t i = 0; i != inCount; ++i, p += inStride)
+        {
+            result = Combine(result, Loader::Load(p));
+        }
+        Bench::ClobberMemory();
+    }
+    Bench::DoNotOptimize(result);
 }
 
 
-template<typename T>
-void run_benchmark(const uint8_t * data, const std::vector<std::size_t> & indices)
+std::string Prefix(const char * inKind, const char * inStrategy, unsigned inWidth)
 {
-    for (unsigned i = 0; i != iterations; ++i)
+    return std::string(inKind) + "/" + inStrategy + "/width:" + std::to_string(inWidth);
+}
+
+
+template<typename Loader, unsigned Width>
+void Run(Bench::Runner & runner, const Buffer & lines, const Buffer & pages)
+{
+    const std::string unaligned = Prefix("unaligned", Loader::Name(), Width);
+    for (unsigned offset = 0; offset != cLineSize; ++offset)
     {
-        const Header<T> * hdr = reinterpret_cast<const Header<T>*>(data);
-        counter += hdr[indices[i]].b;
+        runner.run_batch(unaligned + "/offset:" + std::to_string(offset), cLines * cPasses, [&]
+        {
+            Loads<Loader>(lines.mData + offset, cLineSize, cLines, cPasses);
+        });
+    }
+
+    struct Position { const char * name; unsigned offset; };
+    const Position positions[] = {
+        { "aligned", 0 },
+        { "line_split", cLineSize - Width / 2 },
+        { "page_split", cPageSize - Width / 2 }
+    };
+
+    const std::string page = Prefix("page", Loader::Name(), Width);
+    for (const Position & position : positions)
+    {
+        runner.run_batch(page + "/" + position.name, cPages * cPasses, [&]
+        {
+            Loads<Loader>(pages.mData + position.offset, cPageSize, cPages, cPasses);
+        });
     }
 }
 
 
 template<typename T>
-void run()
+void RunIntegers(Bench::Runner & runner, const Buffer & lines, const Buffer & pages)
+{
+    Run<Cast<T>, sizeof(T)>(runner, lines, pages);
+    Run<Memcpy<T>, sizeof(T)>(runner, lines, pages);
+    Run<Memmove<T>, sizeof(T)>(runner, lines, pages);
+    Run<StdCopy<T>, sizeof(T)>(runner, lines, pages);
+}
+
+
+void RunWide(Bench::Runner & runner, const Buffer & lines, const Buffer & pages)
 {
-    std::cout << "\n*** " << demangle(typeid(T).name()) << " ***" << std::endl;
-    for (unsigned offset = 0; offset < (4 * sizeof(T)); ++offset)
+    Run<Scalar<16>, 16>(runner, lines, pages);
+#ifdef __SSE2__
+    Run<SSE<16>, 16>(runner, lines, pages);
+#endif
+
+    Run<Scalar<32>, 32>(runner, lines, pages);
+#ifdef __SSE2__
+    Run<SSE<32>, 32>(runner, lines, pages);
+#endif
+#ifdef __AVX2__
+    Run<AVX<32>, 32>(runner, lines, pages);
+#endif
+
+    Run<Scalar<64>, 64>(runner, lines, pages);
+#ifdef __SSE2__
+    Run<SSE<64>, 64>(runner, lines, pages);
+#endif
+#ifdef __AVX2__
+    Run<AVX<64>, 64>(runner, lines, pages);
+#endif
+#ifdef __AVX512F__
+    Run<AVX512<64>, 64>(runner, lines, pages);
+#endif
+}
+
+
+struct Summary
+{
+    Summary() : aligned(0), in_line(0), split(0), worst(0), worst_offset(0), in_line_count(0), split_count(0) {}
+
+    double aligned, in_line, split, worst;
+    unsigned worst_offset, in_line_count, split_count;
+    std::map<std::string, double> page;
+};
+
+
+// Per strategy and width: aligned cost, mean cost of the offsets inside one
+// line and of those that split a line, the worst offset, and the page tests.
+void PrintSummary(std::ostream & os, const Bench::Runner & runner)
+{
+    std::vector<std::string> order;
+    std::map<std::string, Summary> summaries;
+    for (const Bench::Result & result : runner.results())
+    {
+        std::string::size_type kind_end = result.name.find('/');
+        std::string::size_type last = result.name.rfind('/');
+        std::string kind = result.name.substr(0, kind_end);
+        std::string key = result.name.substr(kind_end + 1, last - kind_end - 1);
+        std::string item = result.name.substr(last + 1);
+
+        if (summaries.find(key) == summaries.end())
+        {
+            order.push_back(key);
+        }
+        Summary & summary = summaries[key];
+
+        if (kind == "page")
+        {
+            summary.page[item] = result.median;
+            continue;
+        }
+
+        unsigned width = std::stoul(key.substr(key.find("width:") + 6));
+        unsigned offset = std::stoul(item.substr(item.find(':') + 1));
+        if (offset == 0)
+        {
+            summary.aligned = result.median;
+        }
+        if (offset + width > cLineSize)
+        {
+            summary.split += result.median;
+            ++summary.split_count;
+        }
+        else
+        {
+            summary.in_line += result.median;
+            ++summary.in_line_count;
+        }
+        if (result.median > summary.worst)
+        {
+            summary.worst = result.median;
+            summary.worst_offset = offset;
+        }
+    }
+
+    os << std::endl << "ns per load (median)" << std::endl
+       << std::left << std::setw(22) << "strategy" << std::right
+       << std::setw(9) << "aligned" << std::setw(9) << "in_line" << std::setw(9) << "split" << std::setw(9) << "penalty"
+       << std::setw(13) << "worst" << std::setw(13) << "page:aligned" << std::setw(12) << "page:line" << std::setw(12) << "page:page" << std::endl;
+
+    for (const std::string & key : order)
     {
-        static std::vector<uint8_t> buffer = get_buffer<T>();
+        const Summary & s = summaries[key];
+        auto page = [&](const char * inName) -> std::string
+        {
+            auto it = s.page.find(inName);
+            if (it == s.page.end())
+            {
+                return "-";
+            }
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision(2) << it->second;
+            return ss.str();
+        };
 
-        std::vector<std::size_t> indices;
-        while (indices.size() < iterations) indices.push_back(indices.size());
-        std::random_shuffle(indices.begin(), indices.end());
+        double in_line = s.in_line_count ? s.in_line / s.in_line_count : 0;
+        double split = s.split_count ? s.split / s.split_count : 0;
+        std::ostringstream worst;
+        worst << std::fixed << std::setprecision(2) << s.worst << "@" << s.worst_offset;
 
-        auto start = get_current_time();
-        run_benchmark<T>(buffer.data() + offset, indices);
-        auto elapsed = get_current_time() - start;
-        std::cout << "offset " << std::setw(4) << offset << ": " << std::string(unsigned(40000 * elapsed), '#') << std::endl;
+        os << std::left << std::setw(22) << key << std::right << std::fixed << std::setprecision(2)
+           << std::setw(9) << s.aligned << std::setw(9) << in_line;
+        if (s.split_count)
+        {
+            os << std::setw(9) << split << std::setw(8) << split / in_line << "x";
+        }
+        else
+        {
+            os << std::setw(9) << "-" << std::setw(9) << "-";
+        }
+        os << std::setw(13) << worst.str() << std::setw(13) << page("aligned") << std::setw(12) << page("line_split") << std::setw(12) << page("page_split") << std::endl;
     }
 }
 
 
-int main()
+int main(int argc, char ** argv)
 {
-    run<uint16_t>();
-    run<uint32_t>();
-    run<uint64_t>();
-    run<u128>();
-//    run<u256>();
-//    run<u512>();
-//    run<u1024>();
-    std::cout << "counter: " << counter << std::endl;
+    Bench::Runner runner(argc, argv);
+
+    // One spare line and page for the loads that run over the end.
+    Buffer lines((cLines + 1) * cLineSize);
+    Buffer pages((cPages + 1) * cPageSize);
+
+    RunIntegers<uint16_t>(runner, lines, pages);
+    RunIntegers<uint32_t>(runner, lines, pages);
+    RunIntegers<uint64_t>(runner, lines, pages);
+    RunWide(runner, lines, pages);
+
+    // Keep JSON and CSV on stdout parseable.
+    bool text = runner.options().format == Bench::Options::cText || !runner.options().out.empty();
+    PrintSummary(text ? std::cout : std::cerr, runner);
 }
@@ -0,0 +1,181 @@
+#ifndef SHARDEDCOUNTER_H_INCLUDED
+#define SHARDEDCOUNTER_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+
+
+/**
+ * Statistics counter for values that many threads increment and that are
+ * read rarely (packet counts, error counts, allocations).
+ *
+ * Each thread adds to one of a number of shards, so threads on different
+ * cores don't fight over one cache line. Every shard sits on its own pair
+ * of cache lines: the adjacent-line prefetcher of x86 CPUs pulls lines in
+ * 128-byte pairs, and 64-byte padding still shows false sharing there.
+ *
+ * add() is one relaxed fetch_add on a line that is usually already owned
+ * by the calling core. value() sums the shards: exact when no thread is
+ * adding, otherwise some value the counter had during the call.
+ *
+ * For the hottest paths, Buffered accumulates in a plain local variable and
+ * folds into the shard every FoldInterval additions and when destroyed.
+ */
+class ShardedCounter
+{
+public:
+    enum { cShardSize = 128 };
+
+    explicit ShardedCounter(unsigned inShardCount = DefaultShardCount()) :
+        mShards(nullptr),
+        mMask(RoundUpToPowerOfTwo(inShardCount) - 1)
+    {
+        std::size_t count = mMask + 1;
+        mStorage.reset(new char[count * cShardSize + cShardSize]);
+        char * aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(mStorage.get()) + cShardSize - 1) & ~uintptr_t(cShardSize - 1));
+        mShards = reinterpret_cast<Shard*>(aligned);
+        for (std::size_t i = 0; i != count; ++i)
+        {
+            new (&mShards[i]) Shard;
+        }
+    }
+
+    ~ShardedCounter()
+    {
+        for (std::size_t i = 0; i != shard_count(); ++i)
+        {
+            mShards[i].~Shard();
+        }
+    }
+
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+    void add(int64_t inValue = 1)
+    {
+        shard().fetch_add(inValue, std::memory_order_relaxed);
+    }
+
+    int64_t value() const
+    {
+        int64_t sum = 0;
+        for (std::size_t i = 0; i != shard_count(); ++i)
+        {
+            sum += mShards[i].mValue.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    //! Not atomic as a whole: additions that race with reset() may survive it.
+    void reset()
+    {
+        for (std::size_t i = 0; i != shard_count(); ++i)
+        {
+            mShards[i].mValue.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t shard_count() const { return mMask + 1; }
+
+    /**
+     * Thread-local front end. Must not be shared between threads.
+     * Additions become visible in value() when they are folded.
+     */
+    class Buffered
+    {
+    public:
+        explicit Buffered(ShardedCounter & inCounter, unsigned inFoldInterval = 64) :
+            mCounter(inCounter),
+            mFoldInterval(inFoldInterval),
+            mPendingCount(0),
+            mPendingValue(0)
+        {
+        }
+
+        ~Buffered()
+        {
+            flush();
+        }
+
+        Buffered(const Buffered&) = delete;
+        Buffered& operator=(const Buffered&) = delete;
+
+        void add(int64_t inValue = 1)
+        {
+            mPendingValue += inValue;
+            if (++mPendingCount == mFoldInterval)
+            {
+                flush();
+            }
+        }
+
+        void flush()
+        {
+            if (mPendingCount != 0)
+            {
+                mCounter.add(mPendingValue);
+                mPendingCount = 0;
+                mPendingValue = 0;
+            }
+        }
+
+    private:
+        ShardedCounter & mCounter;
+        unsigned mFoldInterval;
+        unsigned mPendingCount;
+        int64_t mPendingValue;
+    };
+
+    //! One shard per hardware thread, rounded up to a power of two.
+    static unsigned DefaultShardCount()
+    {
+        return std::min(256u, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+private:
+    struct Shard
+    {
+        Shard() : mValue(0) {}
+
+        std::atomic<int64_t> mValue;
+        char mPadding[cShardSize - sizeof(std::atomic<int64_t>)];
+    };
+
+    static_assert(sizeof(Shard) == cShardSize, "Shard must fill its cache lines exactly.");
+
+    static unsigned RoundUpToPowerOfTwo(unsigned n)
+    {
+        unsigned result = 1;
+        while (result < n)
+        {
+            result *= 2;
+        }
+        return result;
+    }
+
+    // Threads are numbered in the order in which they first add to any
+    // counter, so the first shard_count() threads never share a shard.
+    static unsigned ThreadIndex()
+    {
+        static std::atomic<unsigned> fNextIndex(0);
+        static thread_local unsigned fIndex = fNextIndex.fetch_add(1, std::memory_order_relaxed);
+        return fIndex;
+    }
+
+    std::atomic<int64_t> & shard()
+    {
+        return mShards[ThreadIndex() & mMask].mValue;
+    }
+
+    std::unique_ptr<char[]> mStorage;
+    Shard * mShards;
+    std::size_t mMask;
+};
+
+
+#endif // SHARDEDCOUNTER_H_INCLUDED
@@ -1,5 +1,259 @@
+#include "Benchmark.h"
+#include "ShardedCounter.h"
+#include <algorithm>
 #include <atomic>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <vector>
 #include <thread>
+
+
+// Cost of counting from a number of threads, over counter layouts, update
+// operations and memory orders. One operation is one increment, timed over
+// all threads together.
+//
+// Layouts:
+//   shared       one counter for all threads
+//   packed       one counter per thread, neighbours share a cache line
+//   padded:N     one counter per thread, N bytes apart
+//   fold:N       one shared counter, every thread adds its local count every N increments
+//   ShardedCounter/add, ShardedCounter/buffered:N   see ShardedCounter.h
+//
+// The per-thread layouts report the cost of the increments only; summing the
+// counters is left to the reader, like ShardedCounter::value() does.
+
+
+enum
+{
+    cIncrementsPerThread = 1000 * 1000,
+    cMaxThreads = 256
+};
+
+
+template<unsigned Size>
+struct PaddedCounter
+{
+    std::atomic<long> value;
+    char padding[Size - sizeof(std::atomic<long>)];
+};
+
+
+std::atomic<long> gShared(0);
+std::atomic<long> gPacked[cMaxThreads];
+alignas(64) PaddedCounter<64> gPadded64[cMaxThreads];
+alignas(128) PaddedCounter<128> gPadded128[cMaxThreads];
+ShardedCounter gSharded;
+
+
+template<typename Increment>
+void Repeat(Increment increment)
+{
+    for (unsigned i = 0; i != cIncrementsPerThread; ++i)
+    {
+        increment();
+    }
+}
+
+
+//! Runs worker(t) on threads t = 0 .. inThreadCount - 1.
+template<typename Worker>
+void run(Bench::Runner & runner, const std::string & inName, unsigned inThreadCount, Worker worker)
+{
+    const std::string name = inName + "/threads:" + std::to_string(inThreadCount);
+    Bench::Region & region = Bench::Region::Get(name);
+    runner.run_batch(name, inThreadCount * cIncrementsPerThread, [&]
+    {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t != inThreadCount; ++t)
+        {
+            threads.push_back(std::thread([&, t]
+            {
+                Bench::Scope scope(region);
+                worker(t);
+            }));
+        }
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+    });
+}
+
+
+template<std::memory_order Order>
+struct FetchAdd
+{
+    static void Increment(std::atomic<long> & ioCounter)
+    {
+        ioCounter.fetch_add(1, Order);
+    }
+};
+
+
+template<std::memory_order Order>
+struct CompareExchange
+{
+    static void Increment(std::atomic<long> & ioCounter)
+    {
+        long value = ioCounter.load(std::memory_order_relaxed);
+        while (!ioCounter.compare_exchange_weak(value, value + 1, Order, std::memory_order_relaxed))
+        {
+        }
+    }
+};
+
+
+template<typename Operation>
+void RunLayouts(Bench::Runner & runner, const std::string & inOperation, unsigned inThreadCount)
+{
+    run(runner, "shared/" + inOperation, inThreadCount, [](unsigned)
+    {
+        Repeat([] { Operation::Increment(gShared); });
+    });
+    run(runner, "packed/" + inOperation, inThreadCount, [](unsigned t)
+    {
+        Repeat([t] { Operation::Increment(gPacked[t]); });
+    });
+    run(runner, "padded:64/" + inOperation, inThreadCount, [](unsigned t)
+    {
+        Repeat([t] { Operation::Increment(gPadded64[t].value); });
+    });
+    run(runner, "padded:128/" + inOperation, inThreadCount, [](unsigned t)
+    {
+        Repeat([t] { Operation::Increment(gPadded128[t].value); });
+    });
+}
+
+
+template<template<std::memory_order> class Operation>
+void RunOrders(Bench::Runner & runner, const std::string & inOperation, unsigned inThreadCount)
+{
+    RunLayouts<Operation<std::memory_order_relaxed>>(runner, inOperation + "/relaxed", inThreadCount);
+    RunLayouts<Operation<std::memory_order_acq_rel>>(runner, inOperation + "/acq_rel", inThreadCount);
+    RunLayouts<Operation<std::memory_order_seq_cst>>(runner, inOperation + "/seq_cst", inThreadCount);
+}
+
+
+template<unsigned Interval>
+void RunFold(Bench::Runner & runner, unsigned inThreadCount)
+{
+    run(runner, "fold:" + std::to_string(Interval) + "/fetch_add/relaxed", inThreadCount, [](unsigned)
+    {
+        long pending = 0;
+        Repeat([&]
+        {
+            Bench::DoNotOptimize(++pending);
+            if (pending == Interval)
+            {
+                gShared.fetch_add(pending, std::memory_order_relaxed);
+                pending = 0;
+            }
+        });
+        gShared.fetch_add(pending, std::memory_order_relaxed);
+    });
+}
+
+
+void RunMatrix(Bench::Runner & runner, unsigned inThreadCount)
+{
+    RunOrders<FetchAdd>(runner, "fetch_add", inThreadCount);
+    RunOrders<CompareExchange>(runner, "cas", inThreadCount);
+
+    // Counters with a single writer need no read-modify-write.
+    run(runner, "packed/store/relaxed", inThreadCount, [](unsigned t)
+    {
+        Repeat([t] { gPacked[t].store(gPacked[t].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); });
+    });
+    run(runner, "padded:128/store/relaxed", inThreadCount, [](unsigned t)
+    {
+        std::atomic<long> & counter = gPadded128[t].value;
+        Repeat([&] { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); });
+    });
+
+    RunFold<16>(runner, inThreadCount);
+    RunFold<256>(runner, inThreadCount);
+
+    run(runner, "ShardedCounter/add", inThreadCount, [](unsigned)
+    {
+        Repeat([] { gSharded.add(); });
+    });
+    run(runner, "ShardedCounter/buffered:64", inThreadCount, [](unsigned)
+    {
+        ShardedCounter::Buffered counter(gSharded, 64);
+        Repeat([&] { counter.add(); });
+    });
+}
+
+
+// Nanoseconds per increment, one row per variant and one column per thread count.
+void PrintMatrix(std::ostream & os, const Bench::Runner & runner, const std::vector<unsigned> & inThreadCounts)
+{
+    std::vector<std::string> variants;
+    std::map<std::string, double> ns;
+    for (const Bench::Result & result : runner.results())
+    {
+        std::string variant = result.name.substr(0, result.name.rfind("/threads:"));
+        if (std::find(variants.begin(), variants.end(), variant) == variants.end())
+        {
+            variants.push_back(variant);
+        }
+        ns[result.name] = result.median;
+    }
+
+    os << std::endl << "ns per increment (median)" << std::endl << std::left << std::setw(32) << "variant" << std::right;
+    for (unsigned threads : inThreadCounts)
+    {
+        os << std::setw(10) << ("threads:" + std::to_string(threads));
+    }
+    os << std::endl;
+
+    for (const std::string & variant : variants)
+    {
+        os << std::left << std::setw(32) << variant << std::right << std::fixed << std::setprecision(2);
+        for (unsigned threads : inThreadCounts)
+        {
+            auto it = ns.find(variant + "/threads:" + std::to_string(threads));
+            if (it != ns.end())
+            {
+                os << std::setw(10) << it->second;
+            }
+            else
+            {
+                os << std::setw(10) << "-";
+            }
+        }
+        os << std::endl;
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
+    volatile long plain = 0;
+    run(runner, "volatile", 1, [&](unsigned)
+    {
+        Repeat([&] { plain = plain + 1; });
+    });
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads <= std::min<unsigned>(cMaxThreads, std::max(4u, std::thread::hardware_concurrency())); threads *= 2)
+    {
+        thread_counts.push_back(threads);
+        RunMatrix(runner, threads);
+    }
+
+    bool text = runner.options().format == Bench::Options::cText || !runner.options().out.empty();
+    PrintMatrix(text ? std::cout : std::cerr, runner, thread_counts);
+
+    if (gSharded.value() % cIncrementsPerThread != 0)
+    {
+        std::cerr << "ShardedCounter lost increments: " << gSharded.value() << std::endl;
+        return 1;
+    }
+}
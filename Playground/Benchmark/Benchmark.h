@@ -0,0 +1,592 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+
+#include "PerfCounters.h"
+#include "Regions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+
+/**
+ * Shared micro-benchmark harness.
+ *
+ *     int main(int argc, char ** argv)
+ *     {
+ *         Bench::Runner runner(argc, argv);
+ *         runner.run("memcpy/1500", [&] { memcpy(dst, src, 1500); Bench::ClobberMemory(); }, 1500);
+ *         runner.run_batch("lookup/1M", 1000000, [&] { ... one million lookups ... });
+ *     }
+ *
+ * run() calls the function once per operation and picks the number of
+ * operations per repetition so that a repetition lasts at least
+ * Options::min_time_ms. run_batch() times a function that performs a known
+ * number of operations itself, one call per repetition.
+ *
+ * Every benchmark is warmed up, then repeated. The summary reports the
+ * minimum, median, mean, percentiles and standard deviation of the time per
+ * operation, the throughput if bytes per operation are given, and the
+ * hardware counters per operation if --perf was passed and the kernel allows
+ * it.
+ *
+ * Command line options, all optional:
+ *
+ *     --repetitions=N  --warmup=N  --min-time-ms=N  --cpu=N  --perf
+ *     --filter=SUBSTRING  --format=text|json|csv  --out=FILE
+ *
+ * Text rows are printed as soon as a benchmark finishes. JSON and CSV are
+ * written when the runner is destroyed, so that they form one document.
+ *
+ * The counters above only cover the thread that calls run(). Benchmarks with
+ * worker threads measure them with Scopes (see Regions.h); --perf enables
+ * their counters too, and the runner reports the regions at the end (in
+ * JSON always).
+ */
+namespace Bench {
+
+
+//! Forces the compiler to materialize inValue, without generating any code for it.
+template<typename T>
+inline void DoNotOptimize(const T & inValue)
+{
+    asm volatile("" : : "r,m"(inValue) : "memory");
+}
+
+
+//! Forces all pending memory writes to be considered observable.
+inline void ClobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+
+
+//! Binds the calling thread to one CPU. Returns false if that is not allowed.
+inline bool PinThread(int inCPU)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(inCPU, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+
+struct Options
+{
+    enum Format { cText, cJSON, cCSV };
+
+    Options() :
+        repetitions(11),
+        warmup(1),
+        min_time_ms(10),
+        cpu(-1),
+        perf(false),
+        format(cText)
+    {
+    }
+
+    //! Overrides the fields that are given on the command line.
+    void parse(int argc, char ** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            std::string::size_type eq = arg.find('=');
+            std::string key = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+            if (key == "--repetitions")     { repetitions = std::max(1, std::atoi(value.c_str())); }
+            else if (key == "--warmup")      { warmup = std::max(0, std::atoi(value.c_str())); }
+            else if (key == "--min-time-ms") { min_time_ms = std::atof(value.c_str()); }
+            else if (key == "--cpu")         { cpu = std::atoi(value.c_str()); }
+            else if (key == "--perf")        { perf = true; }
+            else if (key == "--filter")      { filter = value; }
+            else if (key == "--out")         { out = value; }
+            else if (key == "--format")
+            {
+                if (value == "text")      { format = cText; }
+                else if (value == "json") { format = cJSON; }
+                else if (value == "csv")  { format = cCSV; }
+                else { throw std::runtime_error("Unknown format: " + value); }
+            }
+            else
+            {
+                arguments.push_back(arg);
+            }
+        }
+    }
+
+    int repetitions;
+    int warmup;
+    double min_time_ms;
+    int cpu;                 // -1: don't pin
+    bool perf;
+    Format format;
+    std::string filter;      // only run benchmarks whose name contains this
+    std::string out;         // file name, stdout if empty
+    std::vector<std::string> arguments; // the ones that are not ours
+};
+
+
+struct Result
+{
+    Result() :
+        operations(0),
+        bytes_per_operation(0),
+        min(0), median(0), mean(0), p90(0), p99(0), max(0), stddev(0),
+        has_counters(false)
+    {
+        std::fill(counters, counters + PerfCounters::cEventCount, 0.0);
+    }
+
+    std::string name;
+    uint64_t operations;          // per repetition
+    double bytes_per_operation;
+    std::vector<double> samples;  // nanoseconds per operation, one per repetition
+
+    // Summary of the samples, in nanoseconds per operation.
+    double min, median, mean, p90, p99, max, stddev;
+
+    bool has_counters;
+    double counters[PerfCounters::cEventCount]; // per operation
+
+    //! Bytes per second at the median, zero if unknown.
+    double throughput() const
+    {
+        return median > 0 ? bytes_per_operation * 1e9 / median : 0;
+    }
+};
+
+
+namespace Detail {
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+// Nearest-rank percentile of sorted samples.
+inline double Percentile(const std::vector<double> & inSorted, double inPercent)
+{
+    std::size_t rank = static_cast<std::size_t>(std::ceil(inPercent / 100.0 * inSorted.size()));
+    return inSorted[std::min(inSorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+
+inline void Summarize(Result & ioResult)
+{
+    std::vector<double> sorted = ioResult.samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double s : sorted)
+    {
+        sum += s;
+    }
+    ioResult.mean = sum / sorted.size();
+
+    double variance = 0;
+    for (double s : sorted)
+    {
+        variance += (s - ioResult.mean) * (s - ioResult.mean);
+    }
+    ioResult.stddev = sorted.size() > 1 ? std::sqrt(variance / (sorted.size() - 1)) : 0;
+
+    std::size_t n = sorted.size();
+    ioResult.min = sorted.front();
+    ioResult.max = sorted.back();
+    ioResult.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    ioResult.p90 = Percentile(sorted, 90);
+    ioResult.p99 = Percentile(sorted, 99);
+}
+
+
+inline std::string EscapeJSON(const std::string & inText)
+{
+    std::string result;
+    for (char c : inText)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+
+inline std::string EscapeCSV(const std::string & inText)
+{
+    if (inText.find_first_of(",\"") == std::string::npos)
+    {
+        return inText;
+    }
+    std::string result = "\"";
+    for (char c : inText)
+    {
+        result += c;
+        if (c == '"')
+        {
+            result += '"';
+        }
+    }
+    return result + "\"";
+}
+
+
+inline std::string CPUModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.compare(0, 10, "model name") == 0)
+        {
+            std::string::size_type colon = line.find(':');
+            return colon == std::string::npos ? line : line.substr(std::min(colon + 2, line.size()));
+        }
+    }
+    return "unknown";
+}
+
+
+} // namespace Detail
+
+
+class Runner
+{
+public:
+    explicit Runner(int argc, char ** argv, const Options & inDefaults = Options()) :
+        mOptions(inDefaults),
+        mPinned(false),
+        mHeaderPrinted(false)
+    {
+        mOptions.parse(argc, argv);
+        if (mOptions.cpu >= 0)
+        {
+            mPinned = PinThread(mOptions.cpu);
+            if (!mPinned)
+            {
+                std::cerr << "Could not pin to CPU " << mOptions.cpu << "." << std::endl;
+            }
+        }
+        if (mOptions.perf)
+        {
+            mPerf.reset(new PerfCounters);
+            if (!mPerf->valid())
+            {
+                std::cerr << "Hardware counters are not available." << std::endl;
+            }
+            Region::EnableCounters();
+        }
+        if (!mOptions.out.empty())
+        {
+            mFile.open(mOptions.out.c_str());
+            if (!mFile)
+            {
+                throw std::runtime_error("Could not open " + mOptions.out);
+            }
+        }
+    }
+
+    ~Runner()
+    {
+        if (mOptions.format == Options::cJSON)
+        {
+            write_json(stream());
+        }
+        else if (mOptions.format == Options::cCSV)
+        {
+            write_csv(stream());
+            if (mOptions.perf)
+            {
+                Region::Report(std::cerr); // keeps the CSV parseable
+            }
+        }
+        else if (mOptions.perf)
+        {
+            Region::Report(stream());
+        }
+    }
+
+    Runner(const Runner&) = delete;
+    Runner& operator=(const Runner&) = delete;
+
+    const Options & options() const { return mOptions; }
+
+    const std::vector<Result> & results() const { return mResults; }
+
+    //! Calls f() once per operation.
+    template<typename F>
+    void run(const std::string & inName, F f, double inBytesPerOperation = 0)
+    {
+        if (!selected(inName))
+        {
+            return;
+        }
+
+        uint64_t operations = calibrate(f);
+        measure(inName, operations, inBytesPerOperation, [&]
+        {
+            for (uint64_t i = 0; i != operations; ++i)
+            {
+                f();
+            }
+        });
+    }
+
+    //! Times f(), which performs inOperations operations per call.
+    template<typename F>
+    void run_batch(const std::string & inName, uint64_t inOperations, F f, double inBytesPerOperation = 0)
+    {
+        if (selected(inName))
+        {
+            measure(inName, inOperations, inBytesPerOperation, f);
+        }
+    }
+
+private:
+    bool selected(const std::string & inName) const
+    {
+        return mOptions.filter.empty() || inName.find(mOptions.filter) != std::string::npos;
+    }
+
+    // Doubles the number of operations (at most 10x at a time) until one
+    // repetition takes min_time_ms. This also serves as a first warmup.
+    template<typename F>
+    uint64_t calibrate(F & f)
+    {
+        const double min_ns = mOptions.min_time_ms * 1e6;
+        uint64_t operations = 1;
+        for (;;)
+        {
+            auto start = Detail::Clock::now();
+            for (uint64_t i = 0; i != operations; ++i)
+            {
+                f();
+            }
+            double ns = std::chrono::duration<double, std::nano>(Detail::Clock::now() - start).count();
+            if (ns >= min_ns || operations >= (uint64_t(1) << 40))
+            {
+                return operations;
+            }
+            double factor = ns > 0 ? 1.4 * min_ns / ns : 10;
+            operations = static_cast<uint64_t>(operations * std::min(10.0, std::max(2.0, factor)));
+        }
+    }
+
+    template<typename F>
+    void measure(const std::string & inName, uint64_t inOperations, double inBytesPerOperation, F && f)
+    {
+        for (int i = 0; i != mOptions.warmup; ++i)
+        {
+            f();
+        }
+
+        Result result;
+        result.name = inName;
+        result.operations = inOperations;
+        result.bytes_per_operation = inBytesPerOperation;
+
+        bool counting = mPerf && mPerf->valid();
+        if (counting)
+        {
+            mPerf->start();
+        }
+        for (int i = 0; i != mOptions.repetitions; ++i)
+        {
+            auto start = Detail::Clock::now();
+            f();
+            double ns = std::chrono::duration<double, std::nano>(Detail::Clock::now() - start).count();
+            result.samples.push_back(ns / inOperations);
+        }
+        if (counting)
+        {
+            mPerf->stop();
+            uint64_t values[PerfCounters::cEventCount];
+            if (mPerf->read(values))
+            {
+                result.has_counters = true;
+                double total = double(inOperations) * mOptions.repetitions;
+                for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+                {
+                    result.counters[e] = values[e] / total;
+                }
+            }
+        }
+
+        Detail::Summarize(result);
+        mResults.push_back(result);
+        if (mOptions.format == Options::cText)
+        {
+            write_text(stream(), result);
+        }
+    }
+
+    std::ostream & stream()
+    {
+        return mFile.is_open() ? static_cast<std::ostream&>(mFile) : std::cout;
+    }
+
+    // Formats into a string of its own, so that the caller's stream keeps
+    // its flags and precision.
+    void write_text(std::ostream & os, const Result & r)
+    {
+        std::ostringstream line;
+        if (!mHeaderPrinted)
+        {
+            mHeaderPrinted = true;
+            line << std::left << std::setw(40) << "benchmark" << std::right
+                 << std::setw(12) << "ops/rep" << std::setw(12) << "min ns" << std::setw(12) << "median ns"
+                 << std::setw(12) << "p90 ns" << std::setw(12) << "max ns" << std::setw(9) << "stddev"
+                 << std::setw(12) << "MB/s" << '\n';
+        }
+
+        line << std::left << std::setw(40) << r.name << std::right << std::fixed << std::setprecision(2)
+             << std::setw(12) << r.operations << std::setw(12) << r.min << std::setw(12) << r.median
+             << std::setw(12) << r.p90 << std::setw(12) << r.max
+             << std::setw(8) << (r.mean > 0 ? 100 * r.stddev / r.mean : 0) << "%"
+             << std::setw(12);
+        if (r.bytes_per_operation > 0)
+        {
+            line << r.throughput() / 1e6;
+        }
+        else
+        {
+            line << "-";
+        }
+        if (r.has_counters)
+        {
+            line << "  cycles=" << r.counters[PerfCounters::cCycles]
+                 << " ipc=" << (r.counters[PerfCounters::cCycles] > 0 ? r.counters[PerfCounters::cInstructions] / r.counters[PerfCounters::cCycles] : 0)
+                 << " l1_misses=" << r.counters[PerfCounters::cL1Misses]
+                 << " llc_misses=" << r.counters[PerfCounters::cLLCMisses]
+                 << " branch_misses=" << r.counters[PerfCounters::cBranchMisses];
+        }
+        line << '\n';
+        os << line.str() << std::flush;
+    }
+
+    void write_json(std::ostream & os) const
+    {
+        char host[256] = "unknown";
+        gethostname(host, sizeof(host) - 1);
+
+        os << std::setprecision(6) << "{\n"
+           << "  \"context\": {\n"
+           << "    \"time\": " << std::time(0) << ",\n"
+           << "    \"host\": \"" << Detail::EscapeJSON(host) << "\",\n"
+           << "    \"cpu_model\": \"" << Detail::EscapeJSON(Detail::CPUModel()) << "\",\n"
+           << "    \"pinned_cpu\": " << (mPinned ? mOptions.cpu : -1) << ",\n"
+           << "    \"repetitions\": " << mOptions.repetitions << "\n"
+           << "  },\n"
+           << "  \"benchmarks\": [";
+
+        for (std::size_t i = 0; i != mResults.size(); ++i)
+        {
+            const Result & r = mResults[i];
+            os << (i ? "," : "") << "\n    {"
+               << "\"name\": \"" << Detail::EscapeJSON(r.name) << "\", "
+               << "\"operations\": " << r.operations << ", "
+               << "\"min_ns\": " << r.min << ", \"median_ns\": " << r.median << ", \"mean_ns\": " << r.mean << ", "
+               << "\"p90_ns\": " << r.p90 << ", \"p99_ns\": " << r.p99 << ", \"max_ns\": " << r.max << ", "
+               << "\"stddev_ns\": " << r.stddev;
+            if (r.bytes_per_operation > 0)
+            {
+                os << ", \"bytes_per_second\": " << r.throughput();
+            }
+            if (r.has_counters)
+            {
+                for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+                {
+                    os << ", \"" << PerfCounters::Name(PerfCounters::Event(e)) << "\": " << r.counters[e];
+                }
+            }
+            os << ", \"samples_ns\": [";
+            for (std::size_t s = 0; s != r.samples.size(); ++s)
+            {
+                os << (s ? ", " : "") << r.samples[s];
+            }
+            os << "]}";
+        }
+        os << "\n  ],\n  \"regions\": [";
+
+        bool first = true;
+        for (const Region * region : Region::All())
+        {
+            Region::Totals t = region->totals();
+            if (t.calls == 0)
+            {
+                continue;
+            }
+            os << (first ? "" : ",") << "\n    {"
+               << "\"name\": \"" << Detail::EscapeJSON(region->name()) << "\", "
+               << "\"calls\": " << t.calls << ", \"ns\": " << t.ns;
+            if (t.counted_calls != 0)
+            {
+                os << ", \"counted_calls\": " << t.counted_calls;
+                for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+                {
+                    os << ", \"" << PerfCounters::Name(PerfCounters::Event(e)) << "\": " << t.counters[e];
+                }
+            }
+            os << "}";
+            first = false;
+        }
+        os << "\n  ]\n}" << std::endl;
+    }
+
+    void write_csv(std::ostream & os) const
+    {
+        os << "name,operations,min_ns,median_ns,mean_ns,p90_ns,p99_ns,max_ns,stddev_ns,bytes_per_second";
+        for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+        {
+            os << "," << PerfCounters::Name(PerfCounters::Event(e));
+        }
+        os << std::endl << std::setprecision(6);
+
+        for (const Result & r : mResults)
+        {
+            os << Detail::EscapeCSV(r.name) << "," << r.operations << "," << r.min << "," << r.median << ","
+               << r.mean << "," << r.p90 << "," << r.p99 << "," << r.max << "," << r.stddev << ","
+               << r.throughput();
+            for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+            {
+                os << ",";
+                if (r.has_counters)
+                {
+                    os << r.counters[e];
+                }
+            }
+            os << std::endl;
+        }
+    }
+
+    Options mOptions;
+    bool mPinned;
+    bool mHeaderPrinted;
+    std::unique_ptr<PerfCounters> mPerf;
+    std::ofstream mFile;
+    std::vector<Result> mResults;
+};
+
+
+} // namespace Bench
+
+
+#endif // BENCHMARK_H_INCLUDED
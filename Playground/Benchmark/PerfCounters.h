@@ -0,0 +1,168 @@
+#ifndef PERFCOUNTERS_H_INCLUDED
+#define PERFCOUNTERS_H_INCLUDED
+
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace Bench {
+
+
+/**
+ * Hardware counters of the calling thread, read with perf_event_open.
+ *
+ * The events form one group, so they are scheduled onto the PMU together
+ * and their values cover exactly the same interval. Only user-space events
+ * are counted, which works with the default perf_event_paranoid level.
+ *
+ * Events that the CPU doesn't support (L1 misses in many VMs, for example)
+ * are left out of the group and read as zero; has() tells them apart. When
+ * the kernel or the sandbox refuses the cycle counter, valid() is false and
+ * everything else becomes a no-op.
+ */
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        cCycles,
+        cInstructions,
+        cL1Misses,      // L1 data cache read misses
+        cLLCMisses,     // last level cache misses
+        cBranchMisses,
+        cEventCount
+    };
+
+    static const char * Name(Event inEvent)
+    {
+        static const char * cNames[cEventCount] = { "cycles", "instructions", "l1_misses", "llc_misses", "branch_misses" };
+        return cNames[inEvent];
+    }
+
+    PerfCounters() : mOpenCount(0)
+    {
+        static const uint32_t cTypes[cEventCount] = {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE
+        };
+        static const uint64_t cConfigs[cEventCount] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (unsigned i = 0; i != cEventCount; ++i)
+        {
+            mFds[i] = -1;
+        }
+
+        for (unsigned i = 0; i != cEventCount; ++i)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = cTypes[i];
+            attr.config = cConfigs[i];
+            attr.disabled = i == 0; // the leader enables the whole group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            mFds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : mFds[0], 0));
+            if (mFds[0] < 0)
+            {
+                return;
+            }
+            if (mFds[i] >= 0)
+            {
+                mOpenCount++;
+            }
+        }
+    }
+
+    ~PerfCounters()
+    {
+        close_all();
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool valid() const { return mFds[0] >= 0; }
+
+    bool has(Event inEvent) const { return mFds[inEvent] >= 0; }
+
+    void start()
+    {
+        if (valid())
+        {
+            ioctl(mFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(mFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void stop()
+    {
+        if (valid())
+        {
+            ioctl(mFds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    /**
+     * Values since the last start(), zero for the events that aren't
+     * available. Can be called while counting. Returns false if the counters
+     * are unavailable.
+     */
+    bool read(uint64_t (&outValues)[cEventCount]) const
+    {
+        if (!valid())
+        {
+            return false;
+        }
+
+        uint64_t buffer[1 + cEventCount]; // number of events, then the values in the order they were opened
+        ssize_t size = static_cast<ssize_t>((1 + mOpenCount) * sizeof(uint64_t));
+        if (::read(mFds[0], buffer, size) != size || buffer[0] != mOpenCount)
+        {
+            return false;
+        }
+        for (unsigned i = 0, value = 1; i != cEventCount; ++i)
+        {
+            outValues[i] = has(Event(i)) ? buffer[value++] : 0;
+        }
+        return true;
+    }
+
+private:
+    void close_all()
+    {
+        for (unsigned i = cEventCount; i != 0; --i)
+        {
+            if (mFds[i - 1] >= 0)
+            {
+                close(mFds[i - 1]);
+                mFds[i - 1] = -1;
+            }
+        }
+    }
+
+    int mFds[cEventCount];
+    unsigned mOpenCount;
+};
+
+
+} // namespace Bench
+
+
+#endif // PERFCOUNTERS_H_INCLUDED
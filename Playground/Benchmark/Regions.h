@@ -0,0 +1,257 @@
+#ifndef REGIONS_H_INCLUDED
+#define REGIONS_H_INCLUDED
+
+
+#include "PerfCounters.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/**
+ * Named code regions with time and hardware counters, aggregated over all
+ * threads and all executions:
+ *
+ *     Bench::Region & region = Bench::Region::Get("decode");
+ *     ...
+ *     {
+ *         Bench::Scope scope(region);
+ *         ... code to measure, in any thread ...
+ *     }
+ *     Bench::Region::Report(std::cout);
+ *
+ * Counters are read only when they were enabled with EnableCounters(), which
+ * the Runner does for --perf. Every thread then opens its own counters on
+ * its first scope and leaves them running; a scope costs two reads of them,
+ * one system call each, so scopes should last some microseconds at least.
+ * Without counters a scope costs two clock reads.
+ */
+namespace Bench {
+
+
+class Region
+{
+public:
+    //! The region of that name, created on first use. References stay valid.
+    static Region & Get(const std::string & inName)
+    {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mMutex);
+        std::unique_ptr<Region> & region = registry.mRegions[inName];
+        if (!region)
+        {
+            region.reset(new Region(inName));
+            registry.mOrder.push_back(region.get());
+        }
+        return *region;
+    }
+
+    static void EnableCounters(bool inEnable = true)
+    {
+        EnabledFlag().store(inEnable, std::memory_order_relaxed);
+    }
+
+    static bool CountersEnabled()
+    {
+        return EnabledFlag().load(std::memory_order_relaxed);
+    }
+
+    struct Totals
+    {
+        Totals() : calls(0), counted_calls(0), ns(0)
+        {
+            for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+            {
+                counters[e] = 0;
+            }
+        }
+
+        uint64_t calls;
+        uint64_t counted_calls; // calls with counter values
+        double ns;
+        uint64_t counters[PerfCounters::cEventCount];
+    };
+
+    const std::string & name() const { return mName; }
+
+    Totals totals() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTotals;
+    }
+
+    void add(double inNanoseconds, const uint64_t * inCounters)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTotals.calls++;
+        mTotals.ns += inNanoseconds;
+        if (inCounters)
+        {
+            mTotals.counted_calls++;
+            for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+            {
+                mTotals.counters[e] += inCounters[e];
+            }
+        }
+    }
+
+    //! Regions in the order of their creation.
+    static std::vector<const Region*> All()
+    {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mMutex);
+        return std::vector<const Region*>(registry.mOrder.begin(), registry.mOrder.end());
+    }
+
+    //! Per call averages of the regions that were entered.
+    static void Report(std::ostream & os)
+    {
+        // Formatted apart, so that os keeps its flags and precision.
+        std::ostringstream report;
+        std::vector<const Region*> regions = All();
+        bool header = false;
+        for (const Region * region : regions)
+        {
+            Totals t = region->totals();
+            if (t.calls == 0)
+            {
+                continue;
+            }
+            if (!header)
+            {
+                header = true;
+                report << '\n' << std::left << std::setw(40) << "region" << std::right
+                       << std::setw(10) << "calls" << std::setw(14) << "ns/call" << std::setw(14) << "cycles/call"
+                       << std::setw(7) << "ipc" << std::setw(12) << "l1_miss" << std::setw(12) << "llc_miss"
+                       << std::setw(12) << "br_miss" << '\n';
+            }
+
+            report << std::left << std::setw(40) << region->name() << std::right << std::fixed << std::setprecision(1)
+                   << std::setw(10) << t.calls << std::setw(14) << t.ns / t.calls;
+            if (t.counted_calls == 0)
+            {
+                report << std::setw(14) << "-" << std::setw(7) << "-" << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(12) << "-";
+            }
+            else
+            {
+                double n = double(t.counted_calls);
+                double cycles = t.counters[PerfCounters::cCycles];
+                report << std::setw(14) << cycles / n
+                       << std::setw(7) << std::setprecision(2) << (cycles > 0 ? t.counters[PerfCounters::cInstructions] / cycles : 0)
+                       << std::setprecision(1)
+                       << std::setw(12) << t.counters[PerfCounters::cL1Misses] / n
+                       << std::setw(12) << t.counters[PerfCounters::cLLCMisses] / n
+                       << std::setw(12) << t.counters[PerfCounters::cBranchMisses] / n;
+            }
+            report << '\n';
+        }
+        os << report.str() << std::flush;
+    }
+
+private:
+    explicit Region(const std::string & inName) : mName(inName) {}
+
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+    struct Registry
+    {
+        std::mutex mMutex;
+        std::map<std::string, std::unique_ptr<Region>> mRegions;
+        std::vector<Region*> mOrder;
+    };
+
+    static Registry & GetRegistry()
+    {
+        static Registry fRegistry;
+        return fRegistry;
+    }
+
+    static std::atomic<bool> & EnabledFlag()
+    {
+        static std::atomic<bool> fEnabled(false);
+        return fEnabled;
+    }
+
+    std::string mName;
+    mutable std::mutex mMutex;
+    Totals mTotals;
+};
+
+
+namespace Detail {
+
+
+// Free-running counters of the calling thread, opened on first use.
+inline PerfCounters & ThreadCounters()
+{
+    static thread_local PerfCounters fCounters;
+    static thread_local bool fStarted = false;
+    if (!fStarted)
+    {
+        fStarted = true;
+        fCounters.start();
+    }
+    return fCounters;
+}
+
+
+} // namespace Detail
+
+
+//! Adds the time and counters between construction and destruction to a region.
+class Scope
+{
+public:
+    explicit Scope(Region & inRegion) :
+        mRegion(inRegion),
+        mCounters(Region::CountersEnabled() ? &Detail::ThreadCounters() : nullptr)
+    {
+        if (mCounters && !mCounters->read(mStart))
+        {
+            mCounters = nullptr;
+        }
+        mStartTime = std::chrono::steady_clock::now();
+    }
+
+    ~Scope()
+    {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - mStartTime).count();
+        uint64_t end[PerfCounters::cEventCount];
+        if (mCounters && mCounters->read(end))
+        {
+            for (unsigned e = 0; e != PerfCounters::cEventCount; ++e)
+            {
+                end[e] -= mStart[e];
+            }
+            mRegion.add(ns, end);
+        }
+        else
+        {
+            mRegion.add(ns, nullptr);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Region & mRegion;
+    PerfCounters * mCounters;
+    uint64_t mStart[PerfCounters::cEventCount];
+    std::chrono::steady_clock::time_point mStartTime;
+};
+
+
+} // namespace Bench
+
+
+#endif // REGIONS_H_INCLUDED
@@ -0,0 +1,41 @@
+#include "Benchmark.h"
+#include <cstring>
+#include <map>
+#include <vector>
+
+
+// Example and self-check of the harness. Try:
+//   ./test --perf --cpu=0
+//   ./test --format=json --out=results.json
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Runner runner(argc, argv);
+
+    // Should be close to zero: DoNotOptimize generates no instructions.
+    runner.run("empty", [] { Bench::ClobberMemory(); });
+
+    int x = 1;
+    runner.run("increment", [&] { Bench::DoNotOptimize(++x); });
+
+    std::vector<char> src(4096, 'a'), dst(4096);
+    runner.run("memcpy/4096", [&]
+    {
+        std::memcpy(dst.data(), src.data(), src.size());
+        Bench::ClobberMemory();
+    }, double(src.size()));
+
+    std::map<int, int> map;
+    for (int i = 0; i != 1000; ++i)
+    {
+        map[i] = i;
+    }
+    runner.run_batch("map/find/1000", map.size(), [&]
+    {
+        for (int i = 0; i != 1000; ++i)
+        {
+            Bench::DoNotOptimize(map.find(i));
+        }
+    });
+}
@@ -0,0 +1,52 @@
+#ifndef DECODE_H_INCLUDED
+#define DECODE_H_INCLUDED
+
+
+#include <algorithm>
+#include <stdint.h>
+
+
+//! Decodes the network data to the request type.
+//! Endianness conversion will be performed if T is an unsigned
+//! fixed-width integer type (e.g. uint16_t, uint32_t or uint64_t).
+template<typename T>
+T decode(const uint8_t * data);
+
+template<typename T>
+struct identity { typedef T type; };
+
+//! Decodes the network-encoded data to a host-encoded 16-bit integer.
+inline uint16_t decode_impl(const uint8_t * data, const identity<uint16_t>&)
+{
+    return data[0] << 8 | data[1];
+}
+
+//! Decodes the network-encoded data to a host-encoded 32-bit integer.
+inline uint32_t decode_impl(const uint8_t * data, const identity<uint32_t>&)
+{
+    return decode<uint16_t>(data) << 16 | decode<uint16_t>(data + 2);
+}
+
+//! Decodes the network-encoded data to a host-encoded 64-bit integer.
+inline uint64_t decode_impl(const uint8_t * data, const identity<uint64_t>&)
+{
+    return uint64_t(decode<uint32_t>(data)) << 32 | decode<uint32_t>(data + 4);
+}
+
+//! Fallback decoder does not take endianness into account.
+template<typename T>
+T decode_impl(const uint8_t * data, const identity<T>&)
+{
+    T t;
+    std::copy(data, data + sizeof(T), reinterpret_cast<char*>(&t));
+    return t;
+}
+
+template<typename T>
+T decode(const uint8_t * data)
+{
+    return decode_impl(data, identity<T>());
+}
+
+
+#endif // DECODE_H_INCLUDED
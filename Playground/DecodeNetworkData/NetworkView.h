@@ -0,0 +1,372 @@
+#ifndef NETWORKVIEW_H_INCLUDED
+#define NETWORKVIEW_H_INCLUDED
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <stdint.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+
+/**
+ * Typed views over packed network-order records.
+ *
+ * A layout is a struct that lists its fields with their byte offsets and
+ * declares its wire size:
+ *
+ *     struct UDPHeader
+ *     {
+ *         typedef Net::Field<0, uint16_t> SourcePort;
+ *         typedef Net::Field<2, uint16_t> DestinationPort;
+ *         typedef Net::Field<4, uint16_t> Length;
+ *         typedef Net::Field<6, uint16_t> Checksum;
+ *         enum { cSize = 8 };
+ *     };
+ *
+ *     Net::View<UDPHeader> udp(buffer);
+ *     uint16_t port = udp.get<UDPHeader::DestinationPort>();
+ *
+ * Integer fields are read with one unaligned load and a byte swap.
+ * Bytes<Offset, N> fields (addresses, tags) are copied as they are.
+ *
+ * DecodeSoA() converts an array of records into one array per field. With
+ * SSSE3 the fields of several records are gathered and byte-swapped by a
+ * few shuffles per 16 output bytes instead of one load per value.
+ */
+namespace Net {
+
+
+inline uint8_t ByteSwap(uint8_t v) { return v; }
+inline uint16_t ByteSwap(uint16_t v) { return __builtin_bswap16(v); }
+inline uint32_t ByteSwap(uint32_t v) { return __builtin_bswap32(v); }
+inline uint64_t ByteSwap(uint64_t v) { return __builtin_bswap64(v); }
+
+
+//! Loads a big-endian integer from a possibly unaligned address.
+template<typename T>
+T LoadBigEndian(const uint8_t * inData)
+{
+    static_assert(std::is_integral<T>::value, "LoadBigEndian requires an integer type.");
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    Unsigned value;
+    std::memcpy(&value, inData, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = ByteSwap(value);
+#endif
+    return static_cast<T>(value);
+}
+
+
+template<typename T>
+void StoreBigEndian(uint8_t * outData, T inValue)
+{
+    static_assert(std::is_integral<T>::value, "StoreBigEndian requires an integer type.");
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    Unsigned value = static_cast<Unsigned>(inValue);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = ByteSwap(value);
+#endif
+    std::memcpy(outData, &value, sizeof(value));
+}
+
+
+namespace Detail {
+
+
+#if defined(__SSSE3__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/**
+ * Shuffle masks that gather a Size-byte field from records that are Stride
+ * bytes apart into one 16-byte vector, reversing the bytes of every value.
+ *
+ * Each load starts at the field of a record and covers the fields of all
+ * records that end within the next 16 bytes. Output lanes that belong to
+ * another load are zeroed (0x80), so the shuffled loads can be or-ed.
+ */
+template<std::size_t Size, std::size_t Stride>
+struct GatherMasks
+{
+    enum
+    {
+        cLanes = 16 / Size,
+        cFieldsPerLoad = (16 - Size) / Stride + 1 < cLanes ? (16 - Size) / Stride + 1 : cLanes,
+        cLoads = (cLanes + cFieldsPerLoad - 1) / cFieldsPerLoad
+    };
+
+    static const GatherMasks & Instance()
+    {
+        static const GatherMasks fInstance;
+        return fInstance;
+    }
+
+    __m128i mMasks[cLoads];
+
+private:
+    GatherMasks()
+    {
+        for (unsigned load = 0; load != cLoads; ++load)
+        {
+            uint8_t mask[16];
+            std::memset(mask, 0x80, sizeof(mask));
+            unsigned first = load * cFieldsPerLoad;
+            unsigned last = std::min<unsigned>(first + cFieldsPerLoad, cLanes);
+            for (unsigned lane = first; lane != last; ++lane)
+            {
+                for (unsigned b = 0; b != Size; ++b)
+                {
+                    mask[lane * Size + b] = static_cast<uint8_t>((lane - first) * Stride + Size - 1 - b);
+                }
+            }
+            mMasks[load] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+        }
+    }
+};
+#endif
+
+
+} // namespace Detail
+
+
+//! Big-endian integer at a fixed byte offset of a record.
+template<std::size_t Offset, typename T>
+struct Field
+{
+    typedef T Type;
+
+    enum { cOffset = Offset, cEnd = Offset + sizeof(T) };
+
+    static T Load(const uint8_t * inRecord)
+    {
+        return LoadBigEndian<T>(inRecord + Offset);
+    }
+
+    static void Store(uint8_t * outRecord, T inValue)
+    {
+        StoreBigEndian<T>(outRecord + Offset, inValue);
+    }
+
+    /**
+     * Decodes this field of inCount records that are Stride bytes apart.
+     * inEnd is the end of the readable buffer; the vector loads may read
+     * past the last record but never past inEnd.
+     */
+    template<std::size_t Stride>
+    static void DecodeColumn(const uint8_t * inRecords, std::size_t inCount, const uint8_t * inEnd, T * outValues)
+    {
+        static_assert(cEnd <= Stride, "Field does not fit into the record.");
+        std::size_t i = 0;
+
+#if defined(__SSSE3__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        typedef Detail::GatherMasks<sizeof(T), Stride> Masks;
+
+        // With one field per load the shuffles only add work to the
+        // scalar loop, whose loads already swap for free (movbe).
+        if (Masks::cFieldsPerLoad >= 2)
+        {
+            const __m128i * masks = Masks::Instance().mMasks;
+            const uint8_t * fields = inRecords + Offset;
+            const std::size_t available = inEnd - fields;
+
+            // The last load of a step starts at the field of record i + last_load.
+            const std::size_t last_load = (Masks::cLoads - 1) * Masks::cFieldsPerLoad;
+
+#ifdef __AVX2__
+            // Two steps at once: the upper half of each 256-bit register
+            // serves the next cLanes records, so one shuffle does two loads.
+            for (; i + 2 * Masks::cLanes <= inCount && (i + Masks::cLanes + last_load) * Stride + 16 <= available; i += 2 * Masks::cLanes)
+            {
+                __m256i result = _mm256_setzero_si256();
+                for (unsigned load = 0; load != Masks::cLoads; ++load)
+                {
+                    const uint8_t * source = fields + (i + load * Masks::cFieldsPerLoad) * Stride;
+                    __m256i data = _mm256_inserti128_si256(
+                        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + Masks::cLanes * Stride)), 1);
+                    __m256i mask = _mm256_broadcastsi128_si256(masks[load]);
+                    result = _mm256_or_si256(result, _mm256_shuffle_epi8(data, mask));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(outValues + i), result);
+            }
+#endif
+
+            for (; i + Masks::cLanes <= inCount && (i + last_load) * Stride + 16 <= available; i += Masks::cLanes)
+            {
+                __m128i result = _mm_setzero_si128();
+                for (unsigned load = 0; load != Masks::cLoads; ++load)
+                {
+                    const uint8_t * source = fields + (i + load * Masks::cFieldsPerLoad) * Stride;
+                    __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+                    result = _mm_or_si128(result, _mm_shuffle_epi8(data, masks[load]));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(outValues + i), result);
+            }
+        }
+#endif
+        (void)inEnd;
+
+        for (; i != inCount; ++i)
+        {
+            outValues[i] = Load(inRecords + i * Stride);
+        }
+    }
+};
+
+
+//! Raw bytes at a fixed offset, copied without any byte swapping.
+template<std::size_t Offset, std::size_t N>
+struct Bytes
+{
+    typedef std::array<uint8_t, N> Type;
+
+    enum { cOffset = Offset, cEnd = Offset + N };
+
+    static Type Load(const uint8_t * inRecord)
+    {
+        Type result;
+        std::memcpy(result.data(), inRecord + Offset, N);
+        return result;
+    }
+
+    static void Store(uint8_t * outRecord, const Type & inValue)
+    {
+        std::memcpy(outRecord + Offset, inValue.data(), N);
+    }
+
+    template<std::size_t Stride>
+    static void DecodeColumn(const uint8_t * inRecords, std::size_t inCount, const uint8_t *, Type * outValues)
+    {
+        static_assert(cEnd <= Stride, "Field does not fit into the record.");
+        for (std::size_t i = 0; i != inCount; ++i)
+        {
+            std::memcpy(outValues[i].data(), inRecords + i * Stride + Offset, N);
+        }
+    }
+};
+
+
+namespace Detail {
+
+
+//! True if DecodeColumn<Stride> of the field uses shuffles.
+template<typename F, std::size_t Stride>
+struct Vectorized
+{
+    enum { value = 0 };
+};
+
+
+#if defined(__SSSE3__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+template<std::size_t Offset, typename T, std::size_t Stride>
+struct Vectorized<Field<Offset, T>, Stride>
+{
+    enum { value = GatherMasks<sizeof(T), Stride>::cFieldsPerLoad >= 2 };
+};
+#endif
+
+
+} // namespace Detail
+
+
+//! Read-only view of one record. Does not own the buffer.
+template<typename Layout>
+class View
+{
+public:
+    explicit View(const uint8_t * inData) : mData(inData) {}
+
+    template<typename F>
+    typename F::Type get() const
+    {
+        static_assert(std::size_t(F::cEnd) <= std::size_t(Layout::cSize), "Field does not belong to this layout.");
+        return F::Load(mData);
+    }
+
+    const uint8_t * data() const { return mData; }
+
+    //! View of the record that follows this one.
+    View next() const { return View(mData + Layout::cSize); }
+
+private:
+    const uint8_t * mData;
+};
+
+
+//! Writable view of one record, used to build network buffers.
+template<typename Layout>
+class MutableView
+{
+public:
+    explicit MutableView(uint8_t * inData) : mData(inData) {}
+
+    template<typename F>
+    typename F::Type get() const
+    {
+        static_assert(std::size_t(F::cEnd) <= std::size_t(Layout::cSize), "Field does not belong to this layout.");
+        return F::Load(mData);
+    }
+
+    template<typename F>
+    void set(const typename F::Type & inValue)
+    {
+        static_assert(std::size_t(F::cEnd) <= std::size_t(Layout::cSize), "Field does not belong to this layout.");
+        F::Store(mData, inValue);
+    }
+
+    uint8_t * data() const { return mData; }
+
+private:
+    uint8_t * mData;
+};
+
+
+/**
+ * Decodes inCount consecutive records into one output array per field:
+ *
+ *     Net::DecodeSoA<UDPHeader, UDPHeader::SourcePort, UDPHeader::Length>(buffer, count, ports, lengths);
+ *
+ * The records are processed in blocks that stay in L1. Within a block the
+ * fields that can be gathered with shuffles are extracted column by column,
+ * the others in a single pass over the records.
+ */
+template<typename Layout, typename... Fields>
+void DecodeSoA(const uint8_t * inRecords, std::size_t inCount, typename Fields::Type *... outColumns)
+{
+    enum
+    {
+        cStride = Layout::cSize,
+        cBlockRecords = (16 * 1024 / cStride + 31) / 32 * 32 // about 16 KB, a multiple of any SIMD step
+    };
+
+    const uint8_t * end = inRecords + inCount * cStride;
+    for (std::size_t begin = 0; begin < inCount; begin += cBlockRecords)
+    {
+        std::size_t count = std::min<std::size_t>(cBlockRecords, inCount - begin);
+        const uint8_t * block = inRecords + begin * cStride;
+
+        int columns[] = { 0, (Detail::Vectorized<Fields, cStride>::value
+                              ? (Fields::template DecodeColumn<cStride>(block, count, end, outColumns + begin), 0)
+                              : 0)... };
+        (void)columns;
+
+        for (std::size_t i = 0; i != count; ++i)
+        {
+            const uint8_t * record = block + i * cStride;
+            int rows[] = { 0, (Detail::Vectorized<Fields, cStride>::value
+                               ? 0
+                               : (outColumns[begin + i] = Fields::Load(record), 0))... };
+            (void)rows;
+        }
+    }
+}
+
+
+} // namespace Net
+
+
+#endif // NETWORKVIEW_H_INCLUDED
@@ -0,0 +1,259 @@
+#include "Decode.h"
+#include "NetworkView.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+
+// Decodes buffers of packed records into one array per field with
+// the original decode<T>, with per-record views and with DecodeSoA().
+
+
+struct UDPHeader
+{
+    typedef Net::Field<0, uint16_t> SourcePort;
+    typedef Net::Field<2, uint16_t> DestinationPort;
+    typedef Net::Field<4, uint16_t> Length;
+    typedef Net::Field<6, uint16_t> Checksum;
+    enum { cSize = 8 };
+};
+
+
+struct IPv4Header
+{
+    typedef Net::Field<0, uint8_t> VersionAndLength;
+    typedef Net::Field<2, uint16_t> TotalLength;
+    typedef Net::Field<4, uint16_t> Identification;
+    typedef Net::Field<8, uint8_t> TTL;
+    typedef Net::Field<9, uint8_t> Protocol;
+    typedef Net::Field<12, uint32_t> Source;
+    typedef Net::Field<16, uint32_t> Destination;
+    enum { cSize = 20 };
+};
+
+
+struct Quote
+{
+    typedef Net::Field<0, uint64_t> Timestamp;
+    typedef Net::Field<8, uint32_t> Instrument;
+    typedef Net::Field<12, uint32_t> Price;
+    typedef Net::Field<16, uint32_t> Quantity;
+    enum { cSize = 20 };
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+// Best of enough repetitions to decode at least 10 million records, in
+// nanoseconds per record.
+template<typename F>
+double measure(std::size_t inRecordCount, F f)
+{
+    double best = 1e99;
+    for (std::size_t done = 0; done < 10 * 1000 * 1000; done += inRecordCount)
+    {
+        auto start = Clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    return best / inRecordCount;
+}
+
+
+std::vector<uint8_t> make_buffer(std::size_t inSize)
+{
+    std::vector<uint8_t> result(inSize + 1);
+    srand(1);
+    for (auto & b : result)
+    {
+        b = static_cast<uint8_t>(rand());
+    }
+    return result;
+}
+
+
+void report(const char * inName, std::size_t inRecordSize, double inDecode, double inView, double inSoA)
+{
+    std::cout << std::setw(12) << inName << std::setw(8) << inRecordSize
+              << std::setw(12) << inDecode << std::setw(12) << inView << std::setw(12) << inSoA
+              << std::setw(10) << inDecode / inSoA << "x" << std::endl;
+}
+
+
+void check(bool inCondition, const char * inWhat)
+{
+    if (!inCondition)
+    {
+        std::cerr << "Mismatch: " << inWhat << std::endl;
+        std::abort();
+    }
+}
+
+
+void benchmark_udp(std::size_t inRecordCount)
+{
+    // Offset by one byte so that no record is aligned.
+    std::vector<uint8_t> buffer = make_buffer(inRecordCount * UDPHeader::cSize);
+    const uint8_t * records = buffer.data() + 1;
+
+    std::vector<uint16_t> a(inRecordCount), b(inRecordCount), c(inRecordCount), d(inRecordCount);
+    std::vector<uint16_t> a2(inRecordCount), b2(inRecordCount), c2(inRecordCount), d2(inRecordCount);
+
+    double t_decode = measure(inRecordCount, [&]
+    {
+        for (std::size_t i = 0; i != inRecordCount; ++i)
+        {
+            const uint8_t * p = records + i * UDPHeader::cSize;
+            a[i] = decode<uint16_t>(p);
+            b[i] = decode<uint16_t>(p + 2);
+            c[i] = decode<uint16_t>(p + 4);
+            d[i] = decode<uint16_t>(p + 6);
+        }
+    });
+
+    double t_view = measure(inRecordCount, [&]
+    {
+        Net::View<UDPHeader> view(records);
+        for (std::size_t i = 0; i != inRecordCount; ++i, view = view.next())
+        {
+            a2[i] = view.get<UDPHeader::SourcePort>();
+            b2[i] = view.get<UDPHeader::DestinationPort>();
+            c2[i] = view.get<UDPHeader::Length>();
+            d2[i] = view.get<UDPHeader::Checksum>();
+        }
+    });
+    check(a == a2 && b == b2 && c == c2 && d == d2, "UDP view");
+
+    double t_soa = measure(inRecordCount, [&]
+    {
+        Net::DecodeSoA<UDPHeader, UDPHeader::SourcePort, UDPHeader::DestinationPort, UDPHeader::Length, UDPHeader::Checksum>(
+            records, inRecordCount, a2.data(), b2.data(), c2.data(), d2.data());
+    });
+    check(a == a2 && b == b2 && c == c2 && d == d2, "UDP SoA");
+
+    report("UDP", UDPHeader::cSize, t_decode, t_view, t_soa);
+}
+
+
+void benchmark_ipv4(std::size_t inRecordCount)
+{
+    typedef IPv4Header H;
+    std::vector<uint8_t> buffer = make_buffer(inRecordCount * H::cSize);
+    const uint8_t * records = buffer.data() + 1;
+
+    std::vector<uint8_t> vl(inRecordCount), ttl(inRecordCount), proto(inRecordCount);
+    std::vector<uint16_t> len(inRecordCount), id(inRecordCount);
+    std::vector<uint32_t> src(inRecordCount), dst(inRecordCount);
+    std::vector<uint8_t> vl2(inRecordCount), ttl2(inRecordCount), proto2(inRecordCount);
+    std::vector<uint16_t> len2(inRecordCount), id2(inRecordCount);
+    std::vector<uint32_t> src2(inRecordCount), dst2(inRecordCount);
+
+    double t_decode = measure(inRecordCount, [&]
+    {
+        for (std::size_t i = 0; i != inRecordCount; ++i)
+        {
+            const uint8_t * p = records + i * H::cSize;
+            vl[i] = decode<uint8_t>(p);
+            len[i] = decode<uint16_t>(p + 2);
+            id[i] = decode<uint16_t>(p + 4);
+            ttl[i] = decode<uint8_t>(p + 8);
+            proto[i] = decode<uint8_t>(p + 9);
+            src[i] = decode<uint32_t>(p + 12);
+            dst[i] = decode<uint32_t>(p + 16);
+        }
+    });
+
+    double t_view = measure(inRecordCount, [&]
+    {
+        Net::View<H> view(records);
+        for (std::size_t i = 0; i != inRecordCount; ++i, view = view.next())
+        {
+            vl2[i] = view.get<H::VersionAndLength>();
+            len2[i] = view.get<H::TotalLength>();
+            id2[i] = view.get<H::Identification>();
+            ttl2[i] = view.get<H::TTL>();
+            proto2[i] = view.get<H::Protocol>();
+            src2[i] = view.get<H::Source>();
+            dst2[i] = view.get<H::Destination>();
+        }
+    });
+    check(vl == vl2 && len == len2 && id == id2 && ttl == ttl2 && proto == proto2 && src == src2 && dst == dst2, "IPv4 view");
+
+    double t_soa = measure(inRecordCount, [&]
+    {
+        Net::DecodeSoA<H, H::VersionAndLength, H::TotalLength, H::Identification, H::TTL, H::Protocol, H::Source, H::Destination>(
+            records, inRecordCount, vl2.data(), len2.data(), id2.data(), ttl2.data(), proto2.data(), src2.data(), dst2.data());
+    });
+    check(vl == vl2 && len == len2 && id == id2 && ttl == ttl2 && proto == proto2 && src == src2 && dst == dst2, "IPv4 SoA");
+
+    report("IPv4", H::cSize, t_decode, t_view, t_soa);
+}
+
+
+void benchmark_quote(std::size_t inRecordCount)
+{
+    std::vector<uint8_t> buffer = make_buffer(inRecordCount * Quote::cSize);
+    const uint8_t * records = buffer.data() + 1;
+
+    std::vector<uint64_t> ts(inRecordCount), ts2(inRecordCount);
+    std::vector<uint32_t> instr(inRecordCount), price(inRecordCount), qty(inRecordCount);
+    std::vector<uint32_t> instr2(inRecordCount), price2(inRecordCount), qty2(inRecordCount);
+
+    double t_decode = measure(inRecordCount, [&]
+    {
+        for (std::size_t i = 0; i != inRecordCount; ++i)
+        {
+            const uint8_t * p = records + i * Quote::cSize;
+            ts[i] = decode<uint64_t>(p);
+            instr[i] = decode<uint32_t>(p + 8);
+            price[i] = decode<uint32_t>(p + 12);
+            qty[i] = decode<uint32_t>(p + 16);
+        }
+    });
+
+    double t_view = measure(inRecordCount, [&]
+    {
+        Net::View<Quote> view(records);
+        for (std::size_t i = 0; i != inRecordCount; ++i, view = view.next())
+        {
+            ts2[i] = view.get<Quote::Timestamp>();
+            instr2[i] = view.get<Quote::Instrument>();
+            price2[i] = view.get<Quote::Price>();
+            qty2[i] = view.get<Quote::Quantity>();
+        }
+    });
+    check(ts == ts2 && instr == instr2 && price == price2 && qty == qty2, "Quote view");
+
+    double t_soa = measure(inRecordCount, [&]
+    {
+        Net::DecodeSoA<Quote, Quote::Timestamp, Quote::Instrument, Quote::Price, Quote::Quantity>(
+            records, inRecordCount, ts2.data(), instr2.data(), price2.data(), qty2.data());
+    });
+    check(ts == ts2 && instr == instr2 && price == price2 && qty == qty2, "Quote SoA");
+
+    report("Quote", Quote::cSize, t_decode, t_view, t_soa);
+}
+
+
+int main()
+{
+    // Cache-resident and memory-bound buffers.
+    const std::size_t record_counts[] = { 2 * 1024, 1000 * 1000 };
+
+    for (std::size_t count : record_counts)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Nanoseconds per record, " << count << " unaligned records" << std::endl
+                  << std::setw(12) << "layout" << std::setw(8) << "bytes"
+                  << std::setw(12) << "decode<T>" << std::setw(12) << "View" << std::setw(12) << "DecodeSoA"
+                  << std::setw(11) << "speedup" << std::endl;
+
+        benchmark_udp(count);
+        benchmark_ipv4(count);
+        benchmark_quote(count);
+        std::cout << std::endl;
+    }
+}
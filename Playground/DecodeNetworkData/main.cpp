@@ -7,48 +7,8 @@
 #include <type_traits>
 #include <stdint.h>
 #include <deque>
-
-//! Decodes the network data to the request type.
-//! Endianness conversion will be performed if T is an unsigned
-//! fixed-width integer type (e.g. uint16_t, uint32_t or uint64_t).
-template<typename T>
-T decode(const uint8_t * data);
-
-template<typename T>
-struct identity { typedef T type; };
-
-//! Decodes the network-encoded data to a host-encoded 16-bit integer.
-uint16_t decode_impl(const uint8_t * data, const identity<uint16_t>&)
-{
-    return data[0] << 8 | data[1];
-}
-
-//! Decodes the network-encoded data to a host-encoded 32-bit integer.
-uint32_t decode_impl(const uint8_t * data, const identity<uint32_t>&)
-{
-    return decode<uint16_t>(data) << 16 | decode<uint16_t>(data + 2);
-}
-
-//! Decodes the network-encoded data to a host-encoded 64-bit integer.
-uint64_t decode_impl(const uint8_t * data, const identity<uint64_t>&)
-{
-    return uint64_t(decode<uint32_t>(data)) << 32 | decode<uint32_t>(data + 4);
-}
-
-//! Fallback decoder does not take endianness into account.
-template<typename T>
-T decode_impl(const uint8_t * data, const identity<T>&)
-{
-    T t;
-    std::copy(data, data + sizeof(T), reinterpret_cast<char*>(&t));
-    return t;
-}
-
-template<typename T>
-T decode(const uint8_t * data)
-{
-    return decode_impl(data, identity<T>());
-}
+#include "Decode.h"
+#include "NetworkView.h"
 
 void print_binary(const uint8_t * data, unsigned length)
 {
@@ -116,4 +76,25 @@ int main()
         check(network_data, n);
         print_binary(reinterpret_cast<uint8_t*>(&n), sizeof(n));
     }
+    
+    {
+        struct Layout
+        {
+            typedef Net::Field<0, uint16_t> Short;
+            typedef Net::Field<2, uint32_t> Int;
+            typedef Net::Bytes<6, 2> Tail;
+            enum { cSize = 8 };
+        };
+        
+        std::cout << "parse fields of a view: ";
+        Net::View<Layout> view(network_data);
+        auto s = view.get<Layout::Short>();
+        auto i = view.get<Layout::Int>();
+        auto t = view.get<Layout::Tail>();
+        assert(s == decode<uint16_t>(network_data));
+        assert(i == decode<uint32_t>(network_data + 2));
+        print_binary(reinterpret_cast<uint8_t*>(&s), sizeof(s));
+        print_binary(reinterpret_cast<uint8_t*>(&i), sizeof(i));
+        print_binary(t.data(), t.size());
+    }
 }
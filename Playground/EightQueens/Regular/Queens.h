@@ -0,0 +1,208 @@
+#ifndef QUEENS_H_INCLUDED
+#define QUEENS_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+
+// N queens on an N x N board, one row at a time. The state of a partial
+// placement is three bit masks over the columns of the next row: the
+// occupied columns, and the squares attacked along either diagonal. Placing
+// a queen is three ORs and two shifts, so nothing is copied or undone.
+namespace Queens {
+
+
+enum { cMaxSize = 32 };
+
+
+//! Column of the queen in every row, row 0 first.
+typedef std::vector<unsigned> Solution;
+
+
+namespace Detail {
+
+
+inline uint32_t AllColumns(unsigned inSize)
+{
+    if (inSize == 0 || inSize > cMaxSize)
+    {
+        throw std::invalid_argument("Queens: board size must be in [1, " + std::to_string(int(cMaxSize)) + "]: " + std::to_string(inSize));
+    }
+    return inSize == cMaxSize ? ~uint32_t(0) : (uint32_t(1) << inSize) - 1;
+}
+
+
+// The attacked squares move one column per row: the left diagonals to
+// higher bits, the right diagonals to lower ones.
+struct Placement
+{
+    uint32_t columns;
+    uint32_t left;
+    uint32_t right;
+
+    uint32_t free(uint32_t inAll) const { return inAll & ~(columns | left | right); }
+
+    Placement place(uint32_t inBit) const
+    {
+        Placement result = { columns | inBit, (left | inBit) << 1, (right | inBit) >> 1 };
+        return result;
+    }
+};
+
+
+inline uint64_t CountBelow(uint32_t inAll, const Placement & inPlacement)
+{
+    if (inPlacement.columns == inAll)
+    {
+        return 1;
+    }
+    uint64_t count = 0;
+    for (uint32_t free = inPlacement.free(inAll); free != 0; free &= free - 1)
+    {
+        count += CountBelow(inAll, inPlacement.place(free & (~free + 1)));
+    }
+    return count;
+}
+
+
+inline bool FindBelow(uint32_t inAll, const Placement & inPlacement, Solution & ioSolution)
+{
+    if (inPlacement.columns == inAll)
+    {
+        return true;
+    }
+    for (uint32_t free = inPlacement.free(inAll); free != 0; free &= free - 1)
+    {
+        uint32_t bit = free & (~free + 1);
+        ioSolution.push_back(__builtin_ctz(bit));
+        if (FindBelow(inAll, inPlacement.place(bit), ioSolution))
+        {
+            return true;
+        }
+        ioSolution.pop_back();
+    }
+    return false;
+}
+
+
+/**
+ * The placements of the first two rows that represent the solutions up to
+ * mirroring the board left to right. Every solution with the first queen
+ * in the left half has a mirror image with it in the right half. With an
+ * odd size the first queen can also be in the middle column; the second
+ * one is not, and then it picks the half.
+ *
+ * So the number of solutions is twice the number found below these. Sizes
+ * below 2 have no second row and are not split.
+ */
+inline std::vector<Placement> Split(unsigned inSize)
+{
+    const uint32_t all = AllColumns(inSize);
+    const uint32_t left_half = (uint32_t(1) << (inSize / 2)) - 1;
+    std::vector<Placement> result;
+    Placement empty = { 0, 0, 0 };
+    for (unsigned col = 0; col != (inSize + 1) / 2; ++col)
+    {
+        Placement first = empty.place(uint32_t(1) << col);
+        uint32_t second = first.free(all);
+        if (col == inSize / 2)
+        {
+            second &= left_half;
+        }
+        for (; second != 0; second &= second - 1)
+        {
+            result.push_back(first.place(second & (~second + 1)));
+        }
+    }
+    return result;
+}
+
+
+} // namespace Detail
+
+
+//! The first solution in lexicographic order of the columns, empty if there is none.
+inline Solution FindSolution(unsigned inSize)
+{
+    Solution result;
+    Detail::Placement empty = { 0, 0, 0 };
+    Detail::FindBelow(Detail::AllColumns(inSize), empty, result);
+    return result;
+}
+
+
+//! The number of ways to place inSize queens on an inSize x inSize board.
+inline uint64_t CountSolutions(unsigned inSize)
+{
+    const uint32_t all = Detail::AllColumns(inSize);
+    if (inSize == 1)
+    {
+        return 1;
+    }
+    uint64_t count = 0;
+    for (const Detail::Placement & placement : Detail::Split(inSize))
+    {
+        count += Detail::CountBelow(all, placement);
+    }
+    return 2 * count;
+}
+
+
+/**
+ * CountSolutions() with the subtrees of the first two rows spread over
+ * inThreadCount threads. The subtrees differ a lot in size, so the threads
+ * claim them one by one from a shared counter instead of taking a fixed
+ * share each.
+ */
+inline uint64_t CountSolutions_MultiThreaded(unsigned inSize, unsigned inThreadCount = std::thread::hardware_concurrency())
+{
+    const uint32_t all = Detail::AllColumns(inSize);
+    if (inSize == 1)
+    {
+        return 1;
+    }
+    const std::vector<Detail::Placement> subtrees = Detail::Split(inSize);
+    const unsigned thread_count = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(inThreadCount, subtrees.size())));
+
+    std::atomic<size_t> next(0);
+    std::vector<uint64_t> counts(thread_count, 0);
+    auto worker = [&](unsigned t)
+    {
+        uint64_t count = 0;
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < subtrees.size(); )
+        {
+            count += Detail::CountBelow(all, subtrees[i]);
+        }
+        counts[t] = count;
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < thread_count; ++t)
+    {
+        threads.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    uint64_t count = 0;
+    for (uint64_t c : counts)
+    {
+        count += c;
+    }
+    return 2 * count;
+}
+
+
+} // namespace Queens
+
+
+#endif // QUEENS_H_INCLUDED
@@ -0,0 +1,197 @@
+#include "Benchmark.h"
+#include "Queens.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// The board with one int per square that main.cpp used before against the
+// bit masks: finding the first 8 queens solution, and counting all
+// solutions for 8 queens up to a maximum size, without and with the
+// mirror symmetry, and with 1, 2, 4, ... threads.
+//
+//   benchmark [max size]      (default 16, at most 18)
+//
+// Every count is checked against the known number of solutions.
+
+
+namespace Original {
+
+
+class ChessBoard
+{
+public:
+    ChessBoard() :
+        mFields(64, 0)
+    {
+    }
+
+    int get(unsigned row, unsigned col) const
+    { return mFields[8 * row + col]; }
+
+    void set(unsigned row, unsigned col, int value)
+    {
+        if (get(row, col) == 0)
+        {
+            mFields[8 * row + col] = value;
+        }
+    }
+
+    void setQueen(unsigned row, unsigned col, int value)
+    {
+        // Mark queen as negative value.
+        set(row, col, -value);
+
+        // Mark vertical line as occupied
+        for (unsigned r = 0; r < 8; ++r)
+        {
+            set(r, col, value);
+        }
+
+        // Mark horizontal line as occupied
+        for (unsigned c = 0; c < 8; ++c)
+        {
+            set(row, c, value);
+        }
+
+        // Mark diagonal as occupied
+        int r1_offset = int(row) - int(col);
+        int r2_offset = row + col;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            int r = r1_offset + i;
+            if (r >= 0 && r < 8)
+            {
+                set(r, i, value);
+            }
+
+
+            int r2 = r2_offset - i;
+            if (r2 >= 0 && r2 < 8)
+            {
+                set(r2, i, value);
+            }
+        }
+    }
+
+private:
+    std::vector<int> mFields;
+};
+
+
+bool PutQueen(ChessBoard & board, int rowOffset = 0, int colOffset = 0, int remaining = 8)
+{
+    if (remaining == 0)
+    {
+        return true;
+    }
+
+    for (unsigned row = rowOffset; row < 8; ++row)
+    {
+        for (unsigned col = colOffset; col < 8; ++col)
+        {
+            colOffset = 0; // set to 0 again
+            if (board.get(row, col) == 0)
+            {
+                ChessBoard backup = board;
+
+                board.setQueen(row, col, 8 - remaining + 1);
+                if (PutQueen(board, row, col + 1, remaining - 1))
+                {
+                    return true;
+                }
+                else
+                {
+                    // Revert
+                    board = std::move(backup);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+
+
+
+} // namespace Original
+
+
+namespace {
+
+
+// Solutions for 0, 1, ... 18 queens.
+const uint64_t cSolutions[] = {
+    1, 1, 0, 0, 2, 10, 4, 40, 92, 352, 724, 2680, 14200, 73712, 365596,
+    2279184, 14772512, 95815104, 666090624
+};
+
+
+void check(const std::string & name, uint64_t value, uint64_t expected)
+{
+    if (value != expected)
+    {
+        throw std::runtime_error(name + ": " + std::to_string(value) + " instead of " + std::to_string(expected));
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 3;
+    defaults.warmup = 0;
+    Bench::Runner runner(argc, argv, defaults);
+
+    const unsigned cLargest = sizeof(cSolutions) / sizeof(cSolutions[0]) - 1;
+    unsigned max_size = 16;
+    if (!runner.options().arguments.empty())
+    {
+        max_size = std::atoi(runner.options().arguments[0].c_str());
+        if (max_size < 8 || max_size > cLargest)
+        {
+            throw std::invalid_argument("Max size must be in [8, " + std::to_string(cLargest) + "]: " + runner.options().arguments[0]);
+        }
+    }
+
+    // The first solution on the 8 x 8 board.
+    runner.run("find/8/original", []
+    {
+        Original::ChessBoard board;
+        check("find/8/original", Original::PutQueen(board), 1);
+    });
+    runner.run("find/8/bitboard", []
+    {
+        check("find/8/bitboard", Queens::FindSolution(8).size(), 8);
+    });
+
+    for (unsigned size = 8; size <= max_size; ++size)
+    {
+        const std::string prefix = "count/" + std::to_string(size);
+        const uint64_t expected = cSolutions[size];
+        runner.run(prefix + "/no_symmetry", [&]
+        {
+            Queens::Detail::Placement empty = { 0, 0, 0 };
+            check(prefix + "/no_symmetry", Queens::Detail::CountBelow(Queens::Detail::AllColumns(size), empty), expected);
+        });
+        runner.run(prefix + "/symmetry", [&]
+        {
+            check(prefix + "/symmetry", Queens::CountSolutions(size), expected);
+        });
+        for (unsigned threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+        {
+            const std::string name = prefix + "/threads:" + std::to_string(threads);
+            runner.run(name, [&]
+            {
+                check(name, Queens::CountSolutions_MultiThreaded(size, threads), expected);
+            });
+        }
+    }
+}
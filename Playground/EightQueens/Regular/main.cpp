@@ -1,118 +1,22 @@
+#include "Queens.h"
+#include <cstdlib>
 #include <iostream>
-#include <string>
-#include <sstream>
-#include <vector>
 
 
-class ChessBoard
+// Queens are numbered by row, starting at 1.
+void PrintBoard(const Queens::Solution & solution)
 {
-public:
-    ChessBoard() :
-        mFields(64, 0)
+    for (unsigned r = 0; r < solution.size(); ++r)
     {
-    }
-
-    int get(unsigned row, unsigned col) const
-    { return mFields[8 * row + col]; }
-
-    void set(unsigned row, unsigned col, int value)
-    {
-        if (get(row, col) == 0)
-        {
-            mFields[8 * row + col] = value;
-        }
-    }
-
-    void setQueen(unsigned row, unsigned col, int value)
-    {
-        // Mark queen as negative value.
-        set(row, col, -value);
-
-        // Mark vertical line as occupied
-        for (unsigned r = 0; r < 8; ++r)
-        {
-            set(r, col, value);
-        }
-
-        // Mark horizontal line as occupied
-        for (unsigned c = 0; c < 8; ++c)
-        {
-            set(row, c, value);
-        }
-
-        // Mark diagonal as occupied
-        int r1_offset = int(row) - int(col);
-        int r2_offset = row + col;
-
-        for (int i = 0; i < 8; ++i)
-        {
-            int r = r1_offset + i;
-            if (r >= 0 && r < 8)
-            {
-                set(r, i, value);
-            }
-
-
-            int r2 = r2_offset - i;
-            if (r2 >= 0 && r2 < 8)
-            {
-                set(r2, i, value);
-            }
-        }
-    }
-
-private:
-    std::vector<int> mFields;
-};
-
-
-bool PutQueen(ChessBoard & board, int rowOffset = 0, int colOffset = 0, int remaining = 8)
-{
-    if (remaining == 0)
-    {
-        return true;
-    }
-
-    for (unsigned row = rowOffset; row < 8; ++row)
-    {
-        for (unsigned col = colOffset; col < 8; ++col)
-        {
-            colOffset = 0; // set to 0 again
-            if (board.get(row, col) == 0)
-            {
-                ChessBoard backup = board;
-
-                board.setQueen(row, col, 8 - remaining + 1);
-                if (PutQueen(board, row, col + 1, remaining - 1))
-                {
-                    return true;
-                }
-                else
-                {
-                    // Revert
-                    board = std::move(backup);
-                }
-            }
-        }
-    }
-    return false;
-}
-
-
-void PrintBoard(const ChessBoard & board)
-{
-    for (unsigned r = 0; r < 8; ++r)
-    {
-        for (unsigned c = 0; c < 8; ++c)
+        for (unsigned c = 0; c < solution.size(); ++c)
         {
             if (c != 0)
             {
                 std::cout << " ";
             }
-            int v = board.get(r, c);
-            if (v != 0)
+            if (solution[r] == c)
             {
-                std::cout << v;
+                std::cout << r + 1;
             }
             else
             {
@@ -126,22 +30,27 @@ void PrintBoard(const ChessBoard & board)
 
 int main(int argc, char ** argv)
 {
-    ChessBoard board;
-    PutQueen(board);
-    
-    ChessBoard printable;
-
-    for (int r = 0; r < 8; ++r)
+    unsigned size = 8;
+    if (argc > 1)
     {
-        for (int c = 0; c < 8; ++c)
+        char * end = 0;
+        long arg = std::strtol(argv[1], &end, 10);
+        if (argc > 2 || *end != 0 || arg < 1 || arg > Queens::cMaxSize)
         {
-            int value = board.get(r, c);
-            if (value < 0)
-            {
-                printable.set(r, c, -value);
-            }
+            std::cerr << "Usage: " << argv[0] << " [board size, 1 to " << int(Queens::cMaxSize) << ", default 8]" << std::endl;
+            return 1;
         }
+        size = static_cast<unsigned>(arg);
+    }
+    Queens::Solution solution = Queens::FindSolution(size);
+    if (solution.empty())
+    {
+        std::cout << "No solution for " << size << " queens." << std::endl;
+    }
+    else
+    {
+        PrintBoard(solution);
     }
-    PrintBoard(printable);
+    std::cout << Queens::CountSolutions_MultiThreaded(size) << " solutions" << std::endl;
     return 0;
 }
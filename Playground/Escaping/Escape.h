@@ -0,0 +1,153 @@
+#ifndef ESCAPE_H_INCLUDED
+#define ESCAPE_H_INCLUDED
+
+
+#include "URI.h"
+#include <cstring>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Escaping of delimiters, so that escaped fields can be joined and split
+ * again: every special character and every escape character gets an
+ * escape character in front.
+ *
+ * Both directions make one pass over the text. Which bytes are special is
+ * a URI::ByteSet, so with AVX2 each block of 32 bytes is classified at once
+ * and copied in the runs between the bytes that need work.
+ */
+namespace Escape {
+
+
+class Escaper
+{
+public:
+    //! Escapes the characters of inSpecials, and inEscape itself, with inEscape.
+    explicit Escaper(const std::string & inSpecials, char inEscape = '\\') :
+        mEscape(inEscape),
+        mSpecials(inSpecials + inEscape),
+        mEscapes(std::string(1, inEscape))
+    {
+    }
+
+    //! Appends the escaped [inBegin, inEnd) to ioOutput.
+    void encode(const char * inBegin, const char * inEnd, std::string & ioOutput) const
+    {
+        const size_t size = ioOutput.size();
+        ioOutput.resize(size + 2 * (inEnd - inBegin));
+        char * out = &ioOutput[0] + size;
+        const char * p = inBegin;
+#ifdef __AVX2__
+        for (; inEnd - p >= 32; p += 32)
+        {
+            // Copies the runs between the special characters.
+            unsigned done = 0;
+            for (uint32_t specials = mSpecials.match(p); specials != 0; specials &= specials - 1)
+            {
+                unsigned k = __builtin_ctz(specials);
+                std::memcpy(out, p + done, k - done);
+                out += k - done;
+                *out++ = mEscape;
+                done = k;
+            }
+            std::memcpy(out, p + done, 32 - done);
+            out += 32 - done;
+        }
+#endif
+        for (; p != inEnd; ++p)
+        {
+            out = put_encoded(out, *p);
+        }
+        ioOutput.resize(out - ioOutput.data());
+    }
+
+    std::string encode(const std::string & inText) const
+    {
+        std::string result;
+        encode(inText.data(), inText.data() + inText.size(), result);
+        return result;
+    }
+
+    /**
+     * Appends [inBegin, inEnd) to ioOutput without the escape characters in
+     * front of special characters. Other escape characters, which encode()
+     * does not produce, are kept as they are.
+     */
+    void decode(const char * inBegin, const char * inEnd, std::string & ioOutput) const
+    {
+        const size_t size = ioOutput.size();
+        ioOutput.resize(size + (inEnd - inBegin));
+        char * out = &ioOutput[0] + size;
+        const char * p = inBegin;
+#ifdef __AVX2__
+        while (inEnd - p >= 32)
+        {
+            // Copies the runs between the escape characters. An escaped
+            // escape character is skipped, and one at the end can reach
+            // into the next block.
+            const char * block = p;
+            for (uint32_t escapes = mEscapes.match(block); escapes != 0; escapes &= escapes - 1)
+            {
+                const char * escape = block + __builtin_ctz(escapes);
+                if (escape < p)
+                {
+                    continue;
+                }
+                std::memcpy(out, p, escape - p);
+                out += escape - p;
+                p = escape;
+                put_decoded(p, inEnd, out);
+            }
+            if (p < block + 32)
+            {
+                std::memcpy(out, p, block + 32 - p);
+                out += block + 32 - p;
+                p = block + 32;
+            }
+        }
+#endif
+        while (p != inEnd)
+        {
+            put_decoded(p, inEnd, out);
+        }
+        ioOutput.resize(out - ioOutput.data());
+    }
+
+    std::string decode(const std::string & inText) const
+    {
+        std::string result;
+        decode(inText.data(), inText.data() + inText.size(), result);
+        return result;
+    }
+
+private:
+    // Always writes two bytes, and keeps one or two.
+    char * put_encoded(char * outData, char inChar) const
+    {
+        bool special = mSpecials.contains(static_cast<uint8_t>(inChar));
+        outData[0] = special ? mEscape : inChar;
+        outData[1] = inChar;
+        return outData + (special ? 2 : 1);
+    }
+
+    void put_decoded(const char * & ioData, const char * inEnd, char * & ioOutput) const
+    {
+        if (*ioData == mEscape && inEnd - ioData >= 2 && mSpecials.contains(static_cast<uint8_t>(ioData[1])))
+        {
+            ioData++;
+        }
+        *ioOutput++ = *ioData++;
+    }
+
+    char mEscape;
+    URI::ByteSet mSpecials; // the special characters and the escape character
+    URI::ByteSet mEscapes;  // the escape character alone
+};
+
+
+} // namespace Escape
+
+
+#endif // ESCAPE_H_INCLUDED
@@ -0,0 +1,167 @@
+#include "Benchmark.h"
+#include "Escape.h"
+#include <boost/algorithm/string/replace.hpp>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Escaping throughput: the replace_all passes that encode and decode used
+// before, against Escape.h. One operation is one input byte.
+//
+//   benchmark [size]      (default 16777216)
+//
+// The inputs are text with a comma now and then, and fields where one
+// character in four needs an escape. Escape.h must encode exactly like
+// the original, and decode back to the input.
+
+
+namespace Original {
+
+
+using boost::algorithm::replace_all;
+
+
+std::string encode(std::string text, const std::string& del, const std::string& esc = "\\")
+{
+    replace_all(text, esc, esc + esc);
+    replace_all(text, del, esc + del);
+    return text;
+}
+
+std::string decode(std::string text, const std::string& del, const std::string& esc = "\\")
+{
+    replace_all(text, esc + del, del);
+    replace_all(text, esc + esc, esc);
+    return text;
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+std::vector<std::pair<std::string, std::string> > generate(size_t inSize)
+{
+    std::mt19937 random(7);
+    const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 .";
+    std::vector<std::pair<std::string, std::string> > result;
+
+    std::string text(inSize, ' ');
+    for (char & c : text)
+    {
+        c = random() % 64 == 0 ? ',' : letters[random() % letters.size()];
+    }
+    result.push_back(std::make_pair("text", text));
+
+    for (char & c : text)
+    {
+        c = random() % 4 == 0 ? ",\\"[random() % 2] : letters[random() % letters.size()];
+    }
+    result.push_back(std::make_pair("dense", text));
+    return result;
+}
+
+
+void check(const std::string & inName, const std::string & inValue, const std::string & inExpected)
+{
+    if (inValue != inExpected)
+    {
+        throw std::runtime_error(inName + ": wrong result");
+    }
+}
+
+
+// Escaping byte by byte, for comparison with the vector path.
+std::string encode_reference(const std::string & inText, const std::string & inSpecials, char inEscape)
+{
+    std::string result;
+    for (char c : inText)
+    {
+        if (c == inEscape || inSpecials.find(c) != std::string::npos)
+        {
+            result += inEscape;
+        }
+        result += c;
+    }
+    return result;
+}
+
+
+// Non-ASCII special and escape characters must be found wherever they are
+// in a block, in both directions.
+void verify_vector_path()
+{
+    const std::pair<std::string, char> cases[] = {
+        std::make_pair(std::string(","), '\\'),
+        std::make_pair(std::string("\xA7"), '\\'),
+        std::make_pair(std::string(",\xFF"), '\\'),
+        std::make_pair(std::string(","), '\xFE')
+    };
+    std::mt19937 random(11);
+    for (const auto & entry : cases)
+    {
+        const Escape::Escaper escaper(entry.first, entry.second);
+        const std::string alphabet = entry.first + entry.second + "ab\x80\xFF";
+        for (size_t size = 0; size != 200; ++size)
+        {
+            std::string text(size, 'a');
+            for (char & c : text)
+            {
+                c = alphabet[random() % alphabet.size()];
+            }
+            const std::string encoded = escaper.encode(text);
+            if (encoded != encode_reference(text, entry.first, entry.second) || escaper.decode(encoded) != text)
+            {
+                throw std::runtime_error("escaping differs from the byte by byte reference for size " + std::to_string(size));
+            }
+        }
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+    verify_vector_path();
+
+    size_t size = 16 << 20;
+    if (!runner.options().arguments.empty())
+    {
+        size = std::strtoul(runner.options().arguments[0].c_str(), 0, 10);
+    }
+
+    const Escape::Escaper escaper(",", '\\');
+    for (const auto & input : generate(size))
+    {
+        const std::string prefix = input.first + "/";
+        const std::string & text = input.second;
+        const std::string encoded = Original::encode(text, ",");
+
+        runner.run_batch(prefix + "original_encode", text.size(), [&]
+        {
+            Bench::DoNotOptimize(Original::encode(text, ",").size());
+        }, 1);
+        runner.run_batch(prefix + "encode", text.size(), [&]
+        {
+            check(prefix + "encode", escaper.encode(text), encoded);
+        }, 1);
+        runner.run_batch(prefix + "original_decode", text.size(), [&]
+        {
+            Bench::DoNotOptimize(Original::decode(encoded, ",").size());
+        }, 1);
+        runner.run_batch(prefix + "decode", text.size(), [&]
+        {
+            check(prefix + "decode", escaper.decode(encoded), text);
+        }, 1);
+    }
+}
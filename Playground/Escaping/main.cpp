@@ -1,34 +1,23 @@
-#include <boost/algorithm/string/replace.hpp>
+#include "Escape.h"
 #include <iostream>
 #include <string>
 
 
-using boost::algorithm::replace_all;
-
-
-std::string encode(std::string text, const std::string& del, const std::string& esc = "\\")
-{
-    replace_all(text, esc, esc + esc);
-    replace_all(text, del, esc + del);
-    return text;
-}
-
-std::string decode(std::string text, const std::string& del, const std::string& esc = "\\")
+int main(int argc, char** argv)
 {
-    replace_all(text, esc + del, del);
-    replace_all(text, esc + esc, esc);
-    return text;
-}
-
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " text" << std::endl;
+        return 1;
+    }
 
-int main(int, char** argv)
-{
+    Escape::Escaper escaper(",", '\\');
     if (std::string(argv[0]).find("decode") != std::string::npos)
     {
-        std::cout << decode(argv[1], ",", "\\") << std::endl;
+        std::cout << escaper.decode(argv[1]) << std::endl;
     }
     else
     {
-        std::cout << encode(argv[1], ",", "\\") << std::endl;
+        std::cout << escaper.encode(argv[1]) << std::endl;
     }
 }
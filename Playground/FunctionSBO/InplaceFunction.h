@@ -0,0 +1,176 @@
+#ifndef INPLACEFUNCTION_H_INCLUDED
+#define INPLACEFUNCTION_H_INCLUDED
+
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * InplaceFunction is a move-only replacement for std::function that stores
+ * the callable in a fixed-size inline buffer. It never allocates and has no
+ * refcount: a callable that does not fit in Capacity bytes is rejected at
+ * compile time instead of silently falling back to the heap.
+ *
+ * The default capacity makes sizeof(InplaceFunction) equal to one cache line
+ * on 64-bit platforms.
+ */
+template<typename Signature, std::size_t Capacity = 64 - sizeof(void*)>
+class InplaceFunction;
+
+
+template<typename R, typename ...Args, std::size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+    template<typename F>
+    using EnableIfCallable = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InplaceFunction>::value &&
+        !std::is_same<typename std::decay<F>::type, std::nullptr_t>::value>::type;
+
+public:
+    static const std::size_t capacity = Capacity;
+
+    InplaceFunction() noexcept : mVTable(nullptr)
+    {
+    }
+
+    InplaceFunction(std::nullptr_t) noexcept : mVTable(nullptr)
+    {
+    }
+
+    template<typename F, typename = EnableIfCallable<F>>
+    InplaceFunction(F&& f) : mVTable(GetVTable<typename std::decay<F>::type>())
+    {
+        typedef typename std::decay<F>::type Functor;
+        static_assert(sizeof(Functor) <= Capacity, "InplaceFunction: callable does not fit in the inline storage.");
+        static_assert(alignof(Functor) <= alignof(std::max_align_t), "InplaceFunction: callable is over-aligned.");
+        static_assert(std::is_nothrow_move_constructible<Functor>::value, "InplaceFunction: callable must be nothrow movable.");
+        new (mStorage) Functor(std::forward<F>(f));
+    }
+
+    InplaceFunction(InplaceFunction&& rhs) noexcept : mVTable(rhs.mVTable)
+    {
+        if (mVTable)
+        {
+            mVTable->relocate(mStorage, rhs.mStorage);
+            rhs.mVTable = nullptr;
+        }
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            if (rhs.mVTable)
+            {
+                rhs.mVTable->relocate(mStorage, rhs.mStorage);
+                mVTable = rhs.mVTable;
+                rhs.mVTable = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    template<typename F, typename = EnableIfCallable<F>>
+    InplaceFunction& operator=(F&& f)
+    {
+        return *this = InplaceFunction(std::forward<F>(f));
+    }
+
+    InplaceFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if (mVTable)
+        {
+            mVTable->destroy(mStorage);
+            mVTable = nullptr;
+        }
+    }
+
+    void swap(InplaceFunction& rhs) noexcept
+    {
+        InplaceFunction tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return mVTable != nullptr;
+    }
+
+    R operator()(Args ...args) const
+    {
+        if (!mVTable)
+        {
+            throw std::bad_function_call();
+        }
+        return mVTable->call(mStorage, std::forward<Args>(args)...);
+    }
+
+private:
+    // Hand-written vtable: one static instance per callable type.
+    struct VTable
+    {
+        R (*call)(void*, Args&&...);
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template<typename F>
+    static R Call(void* f, Args&& ...args)
+    {
+        return (*static_cast<F*>(f))(std::forward<Args>(args)...);
+    }
+
+    template<typename F>
+    static void Relocate(void* dst, void* src)
+    {
+        F& source = *static_cast<F*>(src);
+        new (dst) F(std::move(source));
+        source.~F();
+    }
+
+    template<typename F>
+    static void Destroy(void* f)
+    {
+        static_cast<F*>(f)->~F();
+    }
+
+    template<typename F>
+    static const VTable* GetVTable()
+    {
+        static const VTable vtable = { &Call<F>, &Relocate<F>, &Destroy<F> };
+        return &vtable;
+    }
+
+    alignas(std::max_align_t) mutable unsigned char mStorage[Capacity];
+    const VTable* mVTable;
+};
+
+
+template<typename Signature, std::size_t Capacity>
+inline void swap(InplaceFunction<Signature, Capacity>& lhs, InplaceFunction<Signature, Capacity>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+
+#endif // INPLACEFUNCTION_H_INCLUDED
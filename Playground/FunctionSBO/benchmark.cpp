@@ -0,0 +1,121 @@
+#include "InplaceFunction.h"
+#include <tbb/concurrent_queue.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+
+// Measures the cost of pushing a task into a queue and popping/invoking it
+// again, for std::function and InplaceFunction with captures of various sizes.
+// Captures bigger than 16 bytes no longer fit in the libstdc++ std::function
+// small buffer, so that is where the heap allocation starts to show.
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+enum { cIterations = 1000 * 1000, cBatch = 1000 };
+
+
+volatile uint64_t gSink = 0;
+
+
+template<std::size_t N>
+struct Payload
+{
+    Payload(uint64_t value) : data() { data[0] = value; }
+
+    void operator()() const { gSink += data[0] + data[N - 1]; }
+
+    std::array<uint64_t, N> data;
+};
+
+
+template<typename Queue, typename Task, std::size_t N, typename Push, typename Pop>
+double run(Push push, Pop pop)
+{
+    Queue queue;
+    auto start = Clock::now();
+    for (unsigned i = 0; i != cIterations / cBatch; ++i)
+    {
+        for (unsigned j = 0; j != cBatch; ++j)
+        {
+            push(queue, Task(Payload<N>(j)));
+        }
+        Task task;
+        while (pop(queue, task))
+        {
+            task();
+        }
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cIterations;
+}
+
+
+struct DequeOps
+{
+    template<typename Task>
+    static void push(std::deque<Task>& q, Task&& t) { q.push_back(std::move(t)); }
+
+    template<typename Task>
+    static bool pop(std::deque<Task>& q, Task& t)
+    {
+        if (q.empty())
+        {
+            return false;
+        }
+        t = std::move(q.front());
+        q.pop_front();
+        return true;
+    }
+};
+
+
+struct TBBOps
+{
+    template<typename Task>
+    static void push(tbb::concurrent_bounded_queue<Task>& q, Task&& t) { q.push(std::move(t)); }
+
+    template<typename Task>
+    static bool pop(tbb::concurrent_bounded_queue<Task>& q, Task& t) { return q.try_pop(t); }
+};
+
+
+template<template<typename> class QueueT, typename Ops, typename Task>
+void measure(const std::string& queue_name, const std::string& task_name)
+{
+    typedef QueueT<Task> Queue;
+    auto push = [](Queue& q, Task&& t) { Ops::push(q, std::move(t)); };
+    auto pop = [](Queue& q, Task& t) { return Ops::pop(q, t); };
+
+    std::cout << std::setw(16) << queue_name << std::setw(20) << task_name
+              << std::setw(10) << run<Queue, Task, 1>(push, pop)
+              << std::setw(10) << run<Queue, Task, 2>(push, pop)
+              << std::setw(10) << run<Queue, Task, 4>(push, pop)
+              << std::setw(10) << run<Queue, Task, 7>(push, pop)
+              << std::endl;
+}
+
+
+template<typename T> using Deque = std::deque<T>;
+template<typename T> using TBBQueue = tbb::concurrent_bounded_queue<T>;
+
+
+int main()
+{
+    std::cout << std::fixed << std::setprecision(1)
+              << "ns per enqueue+dequeue+invoke (" << cIterations << " tasks)" << std::endl
+              << std::setw(16) << "queue" << std::setw(20) << "task"
+              << std::setw(10) << "8B" << std::setw(10) << "16B" << std::setw(10) << "32B" << std::setw(10) << "56B"
+              << std::endl;
+
+    measure<Deque, DequeOps, std::function<void()>>("std::deque", "std::function");
+    measure<Deque, DequeOps, InplaceFunction<void()>>("std::deque", "InplaceFunction");
+    measure<TBBQueue, TBBOps, std::function<void()>>("tbb::queue", "std::function");
+    measure<TBBQueue, TBBOps, InplaceFunction<void()>>("tbb::queue", "InplaceFunction");
+}
@@ -1 +1 @@
-g++-mp-4.7 -std=c++11 -I/opt/local/include -L/opt/local/lib http_server.cpp -lboost_thread-mt -lboost_system-mt
+g++-mp-4.7 -std=c++11 -I/opt/local/include -I../URI -L/opt/local/lib http_server.cpp -lboost_thread-mt -lboost_system-mt
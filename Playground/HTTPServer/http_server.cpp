@@ -657,9 +657,9 @@ reply reply::stock_reply(reply::status_type status)
 //
 
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <boost/lexical_cast.hpp>
+#include "URI.h"
 
 namespace http {
 namespace server3 {
@@ -730,41 +730,7 @@ void request_handler::handle_request(const Request& req, reply& rep)
 
 bool request_handler::url_decode(const std::string& in, std::string& out)
 {
-  out.clear();
-  out.reserve(in.size());
-  for (std::size_t i = 0; i < in.size(); ++i)
-  {
-    if (in[i] == '%')
-    {
-      if (i + 3 <= in.size())
-      {
-        int value = 0;
-        std::istringstream is(in.substr(i + 1, 2));
-        if (is >> std::hex >> value)
-        {
-          out += static_cast<char>(value);
-          i += 2;
-        }
-        else
-        {
-          return false;
-        }
-      }
-      else
-      {
-        return false;
-      }
-    }
-    else if (in[i] == '+')
-    {
-      out += ' ';
-    }
-    else
-    {
-      out += in[i];
-    }
-  }
-  return true;
+  return URI::decode(in, out);
 }
 
 } // namespace server3
@@ -10,9 +10,9 @@
 
 #include "request_handler.hpp"
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <boost/lexical_cast.hpp>
+#include "URI.h"
 #include "mime_types.hpp"
 #include "reply.hpp"
 #include "request.hpp"
@@ -81,41 +81,7 @@ void request_handler::handle_request(const request& req, reply& rep)
 
 bool request_handler::url_decode(const std::string& in, std::string& out)
 {
-  out.clear();
-  out.reserve(in.size());
-  for (std::size_t i = 0; i < in.size(); ++i)
-  {
-    if (in[i] == '%')
-    {
-      if (i + 3 <= in.size())
-      {
-        int value = 0;
-        std::istringstream is(in.substr(i + 1, 2));
-        if (is >> std::hex >> value)
-        {
-          out += static_cast<char>(value);
-          i += 2;
-        }
-        else
-        {
-          return false;
-        }
-      }
-      else
-      {
-        return false;
-      }
-    }
-    else if (in[i] == '+')
-    {
-      out += ' ';
-    }
-    else
-    {
-      out += in[i];
-    }
-  }
-  return true;
+  return URI::decode(in, out);
 }
 
 } // namespace server3
@@ -0,0 +1,406 @@
+#ifndef IP6CODEC_H_INCLUDED
+#define IP6CODEC_H_INCLUDED
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * IPv6 text <-> binary codec.
+ *
+ * Parse() accepts everything inet_pton(AF_INET6, ...) accepts, including
+ * '::' and a trailing dotted IPv4 part. Format() writes the canonical
+ * compressed text of RFC 5952: lowercase, no leading zeros, the longest
+ * run of two or more zero groups replaced by '::'. Like inet_ntop it uses
+ * the dotted form for IPv4-mapped and IPv4-compatible addresses.
+ *
+ * The input characters are classified 16 at a time with SSE2 (hex digit,
+ * colon, dot, and the nibble value of each digit). The grammar is then
+ * walked on the resulting bit masks instead of on the characters.
+ *
+ * Nothing allocates. The batch functions work on caller-provided arrays.
+ */
+namespace IP6 {
+
+
+struct Address
+{
+    uint8_t bytes[16];
+};
+
+
+enum
+{
+    cMaxTextLength = 45, // "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+    cTextStride = 46     // INET6_ADDRSTRLEN: text plus terminating zero
+};
+
+
+namespace Detail {
+
+
+struct Classified
+{
+    uint64_t hex;
+    uint64_t colon;
+    uint64_t dot;
+    uint8_t nibbles[48];
+};
+
+
+// inLength must not exceed cMaxTextLength.
+inline void Classify(const char * inText, std::size_t inLength, char * outPadded, Classified & out)
+{
+    std::memset(outPadded, 0, 48);
+    std::memcpy(outPadded, inText, inLength);
+    out.hex = out.colon = out.dot = 0;
+
+#ifdef __SSE2__
+    for (unsigned chunk = 0; chunk != 3; ++chunk)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(outPadded + 16 * chunk));
+
+        // Unsigned range checks: x <= limit  <=>  min(x, limit) == x
+        __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+        __m128i nibble = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                                      _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.nibbles + 16 * chunk), nibble);
+
+        unsigned shift = 16 * chunk;
+        out.hex |= uint64_t(_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha))) << shift;
+        out.colon |= uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(':')))) << shift;
+        out.dot |= uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('.')))) << shift;
+    }
+#else
+    for (unsigned i = 0; i != 48; ++i)
+    {
+        unsigned char c = outPadded[i];
+        unsigned digit = c - '0';
+        unsigned alpha = (c | 0x20) - 'a';
+        out.nibbles[i] = digit <= 9 ? digit : alpha <= 5 ? alpha + 10 : 0;
+        out.hex |= uint64_t(digit <= 9 || alpha <= 5) << i;
+        out.colon |= uint64_t(c == ':') << i;
+        out.dot |= uint64_t(c == '.') << i;
+    }
+#endif
+}
+
+
+/**
+ * Parses the hex groups in [0, inLength) into inWordCount words, expanding
+ * a '::'. The text must consist of hex digits and colons only.
+ */
+inline bool ParseWords(const Classified & cls, std::size_t inLength, uint16_t * outWords, unsigned inWordCount)
+{
+    const uint64_t colon = cls.colon & ((uint64_t(1) << inLength) - 1);
+    uint16_t words[8];
+    unsigned count = 0;
+    int gap = -1;
+    std::size_t pos = 0;
+
+    if (inLength >= 1 && (colon & 1))
+    {
+        if (inLength < 2 || !(colon & 2))
+        {
+            return false;
+        }
+        gap = 0;
+        pos = 2;
+    }
+
+    while (pos < inLength)
+    {
+        if (count == inWordCount)
+        {
+            return false;
+        }
+
+        uint64_t next_colons = colon >> pos;
+        std::size_t length = next_colons ? __builtin_ctzll(next_colons) : inLength - pos;
+        uint64_t digits = (uint64_t(1) << length) - 1;
+        if (length == 0 || length > 4 || ((cls.hex >> pos) & digits) != digits)
+        {
+            return false;
+        }
+
+        unsigned word = 0;
+        for (std::size_t i = 0; i != length; ++i)
+        {
+            word = (word << 4) | cls.nibbles[pos + i];
+        }
+        words[count++] = static_cast<uint16_t>(word);
+
+        pos += length;
+        if (pos == inLength)
+        {
+            break;
+        }
+
+        // Skip the colon. A second one marks the gap.
+        if (++pos == inLength)
+        {
+            return false;
+        }
+        if ((colon >> pos) & 1)
+        {
+            if (gap >= 0)
+            {
+                return false;
+            }
+            gap = count;
+            ++pos;
+        }
+    }
+
+    if (gap < 0)
+    {
+        if (count != inWordCount)
+        {
+            return false;
+        }
+        std::memcpy(outWords, words, sizeof(uint16_t) * count);
+        return true;
+    }
+
+    if (count == inWordCount)
+    {
+        return false; // '::' must stand for at least one group
+    }
+    unsigned zeroes = inWordCount - count;
+    std::memcpy(outWords, words, sizeof(uint16_t) * gap);
+    std::memset(outWords + gap, 0, sizeof(uint16_t) * zeroes);
+    std::memcpy(outWords + gap + zeroes, words + gap, sizeof(uint16_t) * (count - gap));
+    return true;
+}
+
+
+// Dotted quad as accepted by inet_pton: four decimals 0-255 without leading zeros.
+inline bool ParseIPv4(const char * b, const char * e, uint8_t * out)
+{
+    unsigned octets = 0;
+    while (octets != 4)
+    {
+        if (b == e || *b < '0' || *b > '9')
+        {
+            return false;
+        }
+        unsigned value = 0;
+        const char * start = b;
+        while (b != e && *b >= '0' && *b <= '9')
+        {
+            value = value * 10 + (*b++ - '0');
+            if (value > 255 || (b - start > 1 && *start == '0'))
+            {
+                return false;
+            }
+        }
+        out[octets++] = static_cast<uint8_t>(value);
+        if (octets != 4)
+        {
+            if (b == e || *b++ != '.')
+            {
+                return false;
+            }
+        }
+    }
+    return b == e;
+}
+
+
+inline char * FormatIPv4(const uint8_t * in, char * out)
+{
+    for (unsigned i = 0; i != 4; ++i)
+    {
+        unsigned v = in[i];
+        if (v >= 100)
+        {
+            *out++ = static_cast<char>('0' + v / 100);
+        }
+        if (v >= 10)
+        {
+            *out++ = static_cast<char>('0' + v / 10 % 10);
+        }
+        *out++ = static_cast<char>('0' + v % 10);
+        if (i != 3)
+        {
+            *out++ = '.';
+        }
+    }
+    return out;
+}
+
+
+} // namespace Detail
+
+
+//! Returns false if [inText, inText + inLength) is not a valid IPv6 address.
+inline bool Parse(const char * inText, std::size_t inLength, Address & out)
+{
+    if (inLength == 0 || inLength > cMaxTextLength)
+    {
+        return false;
+    }
+
+    char padded[48];
+    Detail::Classified cls;
+    Detail::Classify(inText, inLength, padded, cls);
+
+    const uint64_t all = (uint64_t(1) << inLength) - 1;
+    if (((cls.hex | cls.colon | cls.dot) & all) != all)
+    {
+        return false;
+    }
+
+    uint16_t words[8];
+    if (cls.dot == 0)
+    {
+        if (!Detail::ParseWords(cls, inLength, words, 8))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Trailing IPv4 part: everything after the last colon.
+        const uint64_t colon = cls.colon & all;
+        if (colon == 0)
+        {
+            return false;
+        }
+        std::size_t last_colon = 63 - __builtin_clzll(colon);
+        if ((cls.dot & all) >> last_colon == 0 || (cls.dot & ((uint64_t(1) << last_colon) - 1)) != 0)
+        {
+            return false;
+        }
+        if (!Detail::ParseIPv4(padded + last_colon + 1, padded + inLength, out.bytes + 12))
+        {
+            return false;
+        }
+
+        // Keep the colon if it is the second half of a '::'.
+        std::size_t prefix = (last_colon > 0 && ((colon >> (last_colon - 1)) & 1)) ? last_colon + 1 : last_colon;
+        if (!Detail::ParseWords(cls, prefix, words, 6))
+        {
+            return false;
+        }
+        words[6] = static_cast<uint16_t>((out.bytes[12] << 8) | out.bytes[13]);
+        words[7] = static_cast<uint16_t>((out.bytes[14] << 8) | out.bytes[15]);
+    }
+
+    for (unsigned i = 0; i != 8; ++i)
+    {
+        out.bytes[2 * i] = static_cast<uint8_t>(words[i] >> 8);
+        out.bytes[2 * i + 1] = static_cast<uint8_t>(words[i]);
+    }
+    return true;
+}
+
+
+//! Writes the canonical text followed by a terminating zero.
+//! Returns a pointer to the terminating zero. out needs cTextStride bytes.
+inline char * Format(const Address & in, char * out)
+{
+    static const char cDigits[] = "0123456789abcdef";
+
+    uint16_t words[8];
+    unsigned zero_mask = 0;
+    for (unsigned i = 0; i != 8; ++i)
+    {
+        words[i] = static_cast<uint16_t>((in.bytes[2 * i] << 8) | in.bytes[2 * i + 1]);
+        zero_mask |= unsigned(words[i] == 0) << i;
+    }
+
+    // Longest run of zero words (the first one on ties), from the bit mask.
+    int best_base = -1;
+    int best_length = 0;
+    for (unsigned mask = zero_mask; mask; )
+    {
+        int base = __builtin_ctz(mask);
+        int length = __builtin_ctz(~(mask >> base));
+        if (length > best_length)
+        {
+            best_base = base;
+            best_length = length;
+        }
+        mask &= ~(((1u << length) - 1) << base);
+    }
+    if (best_length < 2)
+    {
+        best_base = -1;
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i == best_base)
+        {
+            *out++ = ':';
+            i += best_length - 1;
+            if (i == 7)
+            {
+                *out++ = ':';
+            }
+            continue;
+        }
+        if (i != 0)
+        {
+            *out++ = ':';
+        }
+        if (i == 6 && best_base == 0 && (best_length == 6 || (best_length == 5 && words[5] == 0xffff)))
+        {
+            out = Detail::FormatIPv4(in.bytes + 12, out);
+            break;
+        }
+
+        unsigned word = words[i];
+        int shift = word ? (31 - __builtin_clz(word)) & ~3 : 0;
+        for (; shift >= 0; shift -= 4)
+        {
+            *out++ = cDigits[(word >> shift) & 0xF];
+        }
+    }
+    *out = '\0';
+    return out;
+}
+
+
+/**
+ * Parses inCount addresses. inTexts[i] points to a text of inLengths[i]
+ * characters. outValid[i] is set to 1 for valid input and 0 otherwise.
+ * Returns the number of valid addresses.
+ */
+inline std::size_t ParseBatch(const char * const * inTexts, const std::size_t * inLengths, std::size_t inCount,
+                              Address * outAddresses, uint8_t * outValid)
+{
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i != inCount; ++i)
+    {
+        outValid[i] = Parse(inTexts[i], inLengths[i], outAddresses[i]);
+        valid += outValid[i];
+    }
+    return valid;
+}
+
+
+//! Formats inCount addresses into fixed slots of cTextStride bytes.
+inline void FormatBatch(const Address * inAddresses, std::size_t inCount, char * outTexts)
+{
+    for (std::size_t i = 0; i != inCount; ++i)
+    {
+        Format(inAddresses[i], outTexts + i * cTextStride);
+    }
+}
+
+
+} // namespace IP6
+
+
+#endif // IP6CODEC_H_INCLUDED
@@ -0,0 +1,110 @@
+#include "IP6Codec.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+// Throughput of IP6::ParseBatch/FormatBatch against inet_pton/inet_ntop.
+// Usage: benchmark [address count]
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+double Seconds(Clock::time_point inStart)
+{
+    return std::chrono::duration<double>(Clock::now() - inStart).count();
+}
+
+
+// Random addresses with the kinds of zero runs that show up in practice.
+std::vector<IP6::Address> MakeAddresses(std::size_t inCount)
+{
+    std::mt19937 rng(42);
+    std::vector<IP6::Address> result(inCount);
+    for (auto & address : result)
+    {
+        for (auto & byte : address.bytes)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+        unsigned zero_groups = rng() % 9;
+        unsigned first = rng() % (9 - zero_groups);
+        std::memset(address.bytes + 2 * first, 0, 2 * zero_groups);
+        if (rng() % 4 == 0)
+        {
+            address.bytes[2 * (rng() % 8)] = 0; // short groups
+        }
+    }
+    return result;
+}
+
+
+int main(int argc, char ** argv)
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4 * 1000 * 1000;
+
+    std::vector<IP6::Address> addresses = MakeAddresses(count);
+    std::vector<char> reference_text(count * IP6::cTextStride);
+    std::vector<char> codec_text(count * IP6::cTextStride);
+    std::vector<IP6::Address> parsed(count);
+    std::vector<uint8_t> valid(count);
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        inet_ntop(AF_INET6, addresses[i].bytes, &reference_text[i * IP6::cTextStride], IP6::cTextStride);
+    }
+    double ntop = Seconds(start);
+
+    start = Clock::now();
+    IP6::FormatBatch(addresses.data(), count, codec_text.data());
+    double format = Seconds(start);
+
+    std::vector<const char*> texts(count);
+    std::vector<std::size_t> lengths(count);
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        texts[i] = &reference_text[i * IP6::cTextStride];
+        lengths[i] = std::strlen(texts[i]);
+    }
+
+    start = Clock::now();
+    std::size_t pton_valid = 0;
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        // inet_pton needs a zero-terminated string, which the slots are.
+        pton_valid += inet_pton(AF_INET6, texts[i], parsed[i].bytes) == 1;
+    }
+    double pton = Seconds(start);
+
+    start = Clock::now();
+    std::size_t parse_valid = IP6::ParseBatch(texts.data(), lengths.data(), count, parsed.data(), valid.data());
+    double parse = Seconds(start);
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        bool same_text = std::strcmp(texts[i], &codec_text[i * IP6::cTextStride]) == 0;
+        bool same_binary = valid[i] && std::memcmp(parsed[i].bytes, addresses[i].bytes, 16) == 0;
+        if (!same_text || !same_binary)
+        {
+            if (mismatches++ < 5)
+            {
+                std::cerr << "Mismatch: " << texts[i] << " vs " << &codec_text[i * IP6::cTextStride] << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << count << " addresses (valid: inet_pton " << pton_valid << ", IP6::Parse " << parse_valid
+              << ", mismatches " << mismatches << ")" << std::endl
+              << "  format: inet_ntop " << count / ntop / 1e6 << " M/s, IP6::FormatBatch " << count / format / 1e6 << " M/s" << std::endl
+              << "  parse:  inet_pton " << count / pton / 1e6 << " M/s, IP6::ParseBatch  " << count / parse / 1e6 << " M/s" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
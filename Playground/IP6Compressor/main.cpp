@@ -1,3 +1,4 @@
+#include "IP6Codec.h"
 #include <assert.h>
 #include <iostream>
 #include <string>
@@ -119,4 +120,12 @@ int main()
     std::cout << "Number of intervals: " << vec.size() << std::endl;
     std::cout << vec << std::endl;
 
+    IP6::Address address;
+    char text[IP6::cTextStride];
+    if (IP6::Parse(data.data(), data.size(), address))
+    {
+        IP6::Format(address, text);
+        std::cout << "Compressed: " << text << std::endl;
+    }
+
 }
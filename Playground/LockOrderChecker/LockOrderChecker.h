@@ -0,0 +1,380 @@
+#ifndef LOCKORDERCHECKER_H_INCLUDED
+#define LOCKORDERCHECKER_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <execinfo.h>
+
+
+/**
+ * Thread-safe lock order checker that is cheap enough to stay enabled in
+ * release builds.
+ *
+ * - Every thread keeps a small stack of the locks it holds.
+ * - Acquiring B while A is on top of the stack records the edge A -> B.
+ *   Edges that were seen before are found in a lock-free hash set, so the
+ *   common case costs one hash lookup and no shared writes.
+ * - Only a new edge takes the global mutex. Before it is added to the lock
+ *   graph we check whether B already reaches A. If so, the new edge closes
+ *   a cycle and the inversion is reported.
+ *
+ * Lock ids are never reused, so the graph grows with the number of mutexes
+ * ever created, not with the number of lock operations.
+ */
+namespace LockOrder {
+
+
+typedef uint32_t LockId;
+
+
+typedef void (*ReportHandler)(LockId inHeld, LockId inAcquired, const std::vector<LockId> & inExistingPath);
+
+
+namespace Detail {
+
+
+inline void PrintStackTrace()
+{
+    void *array[16];
+    int size = backtrace(array, 16);
+    backtrace_symbols_fd(array, size, 2);
+}
+
+
+inline void DefaultReport(LockId inHeld, LockId inAcquired, const std::vector<LockId> & inExistingPath)
+{
+    std::cerr << "\n*** Inconsistent lock ordering detected! ***\n"
+              << "Acquiring lock #" << inAcquired << " while holding lock #" << inHeld
+              << ", but the opposite order was seen before:";
+    for (LockId id : inExistingPath)
+    {
+        std::cerr << " #" << id;
+    }
+    std::cerr << std::endl;
+    PrintStackTrace();
+}
+
+
+/**
+ * Insert-only lock-free set of 64-bit edge keys (open addressing, linear
+ * probing). Zero marks an empty slot, which is why lock ids start at one.
+ */
+class EdgeCache
+{
+public:
+    enum { cCapacity = 1 << 16, cMaxProbes = 32 };
+
+    EdgeCache()
+    {
+        for (auto & slot : mSlots)
+        {
+            slot.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool contains(uint64_t inKey) const
+    {
+        std::size_t index = Hash(inKey);
+        for (unsigned i = 0; i != cMaxProbes; ++i, index = (index + 1) & (cCapacity - 1))
+        {
+            uint64_t key = mSlots[index].load(std::memory_order_acquire);
+            if (key == inKey)
+            {
+                return true;
+            }
+            if (key == 0)
+            {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // When the probe sequence is full the edge is simply not cached and
+    // will take the slow path again next time.
+    void insert(uint64_t inKey)
+    {
+        std::size_t index = Hash(inKey);
+        for (unsigned i = 0; i != cMaxProbes; ++i, index = (index + 1) & (cCapacity - 1))
+        {
+            uint64_t expected = 0;
+            if (mSlots[index].compare_exchange_strong(expected, inKey, std::memory_order_acq_rel) || expected == inKey)
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    static std::size_t Hash(uint64_t inKey)
+    {
+        // Finalizer of MurmurHash3.
+        inKey ^= inKey >> 33;
+        inKey *= 0xff51afd7ed558ccdULL;
+        inKey ^= inKey >> 33;
+        return static_cast<std::size_t>(inKey) & (cCapacity - 1);
+    }
+
+    std::atomic<uint64_t> mSlots[cCapacity];
+};
+
+
+struct HeldLocks
+{
+    enum { cMaxDepth = 32 };
+
+    HeldLocks() : mSize(0) {}
+
+    LockId mIds[cMaxDepth];
+    unsigned mSize; // may exceed cMaxDepth, deeper locks are not tracked
+};
+
+
+inline HeldLocks & GetHeldLocks()
+{
+    static thread_local HeldLocks fHeldLocks;
+    return fHeldLocks;
+}
+
+
+} // namespace Detail
+
+
+class Checker
+{
+public:
+    static Checker & Instance()
+    {
+        static Checker fInstance;
+        return fInstance;
+    }
+
+    LockId new_lock_id()
+    {
+        return mNextId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void set_report_handler(ReportHandler inHandler)
+    {
+        mReportHandler.store(inHandler);
+    }
+
+    // Call before blocking on the lock, so that a deadlock is reported
+    // before it happens.
+    void acquire(LockId inId)
+    {
+        record(inId, true);
+    }
+
+    // A successful try_lock can't deadlock, so an inversion is not reported.
+    // Its edge is still recorded: later edges are only recorded from the top
+    // of the stack, and without this one the chain through the lock would be
+    // lost (A, try B, C would only give B -> C).
+    void acquired_without_check(LockId inId)
+    {
+        record(inId, false);
+    }
+
+    void release(LockId inId)
+    {
+        Detail::HeldLocks & held = Detail::GetHeldLocks();
+        if (held.mSize > Detail::HeldLocks::cMaxDepth)
+        {
+            --held.mSize;
+            return;
+        }
+
+        // Usually the top of the stack, but unlock order is not enforced.
+        for (unsigned i = held.mSize; i != 0; --i)
+        {
+            if (held.mIds[i - 1] == inId)
+            {
+                for (unsigned j = i; j < held.mSize; ++j)
+                {
+                    held.mIds[j - 1] = held.mIds[j];
+                }
+                --held.mSize;
+                return;
+            }
+        }
+    }
+
+    //! Number of distinct lock orderings that went through the slow path.
+    std::size_t edge_count() const
+    {
+        std::lock_guard<std::mutex> lock(mGraphMutex);
+        std::size_t result = 0;
+        for (const auto & entry : mGraph)
+        {
+            result += entry.second.size();
+        }
+        return result;
+    }
+
+private:
+    Checker() : mNextId(1), mReportHandler(&Detail::DefaultReport)
+    {
+    }
+
+    Checker(const Checker&) = delete;
+    Checker& operator=(const Checker&) = delete;
+
+    void record(LockId inId, bool inReport)
+    {
+        Detail::HeldLocks & held = Detail::GetHeldLocks();
+        if (held.mSize != 0 && held.mSize <= Detail::HeldLocks::cMaxDepth)
+        {
+            LockId top = held.mIds[held.mSize - 1];
+            uint64_t key = (uint64_t(top) << 32) | inId;
+            if (top != inId && !mEdgeCache.contains(key))
+            {
+                add_edge(top, inId, key, inReport);
+            }
+        }
+        push(held, inId);
+    }
+
+    static void push(Detail::HeldLocks & held, LockId inId)
+    {
+        if (held.mSize < Detail::HeldLocks::cMaxDepth)
+        {
+            held.mIds[held.mSize] = inId;
+        }
+        ++held.mSize;
+    }
+
+    void add_edge(LockId inFrom, LockId inTo, uint64_t inKey, bool inReport)
+    {
+        std::vector<LockId> path;
+        {
+            std::lock_guard<std::mutex> lock(mGraphMutex);
+            if (mEdgeCache.contains(inKey))
+            {
+                return; // another thread was faster
+            }
+
+            std::vector<LockId> & successors = mGraph[inFrom];
+            bool known = std::find(successors.begin(), successors.end(), inTo) != successors.end();
+
+            // Incremental check: only a path from inTo back to inFrom can be
+            // closed by this edge. An inverted edge is not added to the graph,
+            // so the first order seen stays the reference.
+            if (!known && !FindPath(inTo, inFrom, path))
+            {
+                successors.push_back(inTo);
+            }
+            else if (!known && !inReport)
+            {
+                // An unreported inversion stays out of the cache, so that a
+                // blocking lock in the same order is still checked.
+                return;
+            }
+            mEdgeCache.insert(inKey);
+        }
+
+        if (!path.empty())
+        {
+            mReportHandler.load()(inFrom, inTo, path);
+        }
+    }
+
+    // Iterative depth-first search. Requires mGraphMutex.
+    bool FindPath(LockId inFrom, LockId inTo, std::vector<LockId> & outPath)
+    {
+        std::unordered_map<LockId, LockId> parent; // also the visited set
+        std::vector<LockId> stack(1, inFrom);
+        parent[inFrom] = 0;
+        while (!stack.empty())
+        {
+            LockId current = stack.back();
+            stack.pop_back();
+            if (current == inTo)
+            {
+                for (LockId id = inTo; id != 0; id = parent[id])
+                {
+                    outPath.insert(outPath.begin(), id);
+                }
+                return true;
+            }
+
+            auto it = mGraph.find(current);
+            if (it == mGraph.end())
+            {
+                continue;
+            }
+            for (LockId next : it->second)
+            {
+                if (parent.insert(std::make_pair(next, current)).second)
+                {
+                    stack.push_back(next);
+                }
+            }
+        }
+        return false;
+    }
+
+    std::atomic<LockId> mNextId;
+    std::atomic<ReportHandler> mReportHandler;
+    Detail::EdgeCache mEdgeCache;
+    mutable std::mutex mGraphMutex;
+    std::unordered_map<LockId, std::vector<LockId>> mGraph;
+};
+
+
+/**
+ * Drop-in replacement for std::mutex that reports lock order inversions.
+ * Can be used with std::lock_guard and std::unique_lock.
+ */
+class CheckedMutex
+{
+public:
+    CheckedMutex() : mId(Checker::Instance().new_lock_id())
+    {
+    }
+
+    CheckedMutex(const CheckedMutex&) = delete;
+    CheckedMutex& operator=(const CheckedMutex&) = delete;
+
+    void lock()
+    {
+        Checker::Instance().acquire(mId);
+        mMutex.lock();
+    }
+
+    bool try_lock()
+    {
+        if (!mMutex.try_lock())
+        {
+            return false;
+        }
+        Checker::Instance().acquired_without_check(mId);
+        return true;
+    }
+
+    void unlock()
+    {
+        mMutex.unlock();
+        Checker::Instance().release(mId);
+    }
+
+    LockId id() const
+    {
+        return mId;
+    }
+
+private:
+    LockId mId;
+    std::mutex mMutex;
+};
+
+
+} // namespace LockOrder
+
+
+#endif // LOCKORDERCHECKER_H_INCLUDED
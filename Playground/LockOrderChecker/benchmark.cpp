@@ -0,0 +1,129 @@
+#include "LockOrderChecker.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+// Overhead of LockOrder::CheckedMutex compared to a plain std::mutex.
+// Every thread repeatedly takes a chain of nested locks in a consistent order.
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+enum
+{
+    cMutexCount = 64,
+    cChainLength = 3,
+    cIterations = 500 * 1000
+};
+
+
+unsigned gReportCount = 0;
+
+
+void CountReport(LockOrder::LockId, LockOrder::LockId, const std::vector<LockOrder::LockId> &)
+{
+    ++gReportCount;
+}
+
+
+// Returns nanoseconds per lock/unlock pair.
+template<typename MutexType>
+double run(unsigned inThreadCount)
+{
+    std::vector<std::unique_ptr<MutexType>> mutexes;
+    for (unsigned i = 0; i != cMutexCount; ++i)
+    {
+        mutexes.emplace_back(new MutexType);
+    }
+
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (unsigned t = 0; t != inThreadCount; ++t)
+    {
+        threads.push_back(std::thread([&, t]
+        {
+            for (unsigned i = 0; i != cIterations; ++i)
+            {
+                // Increasing indices => consistent lock order.
+                unsigned first = (i * 7 + t) % (cMutexCount - cChainLength);
+                for (unsigned j = 0; j != cChainLength; ++j)
+                {
+                    mutexes[first + j]->lock();
+                }
+                for (unsigned j = cChainLength; j != 0; --j)
+                {
+                    mutexes[first + j - 1]->unlock();
+                }
+            }
+        }));
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return elapsed / (double(inThreadCount) * cIterations * cChainLength);
+}
+
+
+void verify_detection()
+{
+    LockOrder::CheckedMutex a, b, c;
+    {
+        std::lock_guard<LockOrder::CheckedMutex> la(a);
+        std::lock_guard<LockOrder::CheckedMutex> lb(b);
+    }
+    {
+        std::lock_guard<LockOrder::CheckedMutex> lb(b);
+        std::lock_guard<LockOrder::CheckedMutex> lc(c);
+    }
+    {
+        std::lock_guard<LockOrder::CheckedMutex> lc(c);
+        std::lock_guard<LockOrder::CheckedMutex> la(a); // c -> a closes a -> b -> c
+    }
+    std::cout << "Inversions reported: " << gReportCount << " (expected 1)" << std::endl;
+}
+
+
+// A try_lock in the middle of a chain must not hide the order around it.
+void verify_try_lock()
+{
+    const unsigned reports = gReportCount;
+    LockOrder::CheckedMutex a, b, c;
+    {
+        std::lock_guard<LockOrder::CheckedMutex> la(a);
+        std::unique_lock<LockOrder::CheckedMutex> lb(b, std::try_to_lock);
+        std::lock_guard<LockOrder::CheckedMutex> lc(c);
+    }
+    {
+        std::lock_guard<LockOrder::CheckedMutex> lc(c);
+        std::lock_guard<LockOrder::CheckedMutex> la(a); // c -> a closes a -> b -> c
+    }
+    std::cout << "Inversions reported after try_lock: " << gReportCount - reports << " (expected 1)" << std::endl;
+}
+
+
+int main()
+{
+    LockOrder::Checker::Instance().set_report_handler(&CountReport);
+    verify_detection();
+    verify_try_lock();
+
+    const unsigned thread_counts[] = { 1, 2, 4 };
+    std::cout << std::fixed << std::setprecision(1)
+              << "ns per lock+unlock, chains of " << cChainLength << " nested locks" << std::endl
+              << std::setw(9) << "threads" << std::setw(14) << "std::mutex" << std::setw(14) << "CheckedMutex" << std::endl;
+    for (unsigned threads : thread_counts)
+    {
+        std::cout << std::setw(9) << threads
+                  << std::setw(14) << run<std::mutex>(threads)
+                  << std::setw(14) << run<LockOrder::CheckedMutex>(threads)
+                  << std::endl;
+    }
+    std::cout << "Distinct lock orderings: " << LockOrder::Checker::Instance().edge_count() << std::endl;
+}
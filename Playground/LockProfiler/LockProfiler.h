@@ -0,0 +1,336 @@
+#ifndef LOCKPROFILER_H_INCLUDED
+#define LOCKPROFILER_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <execinfo.h>
+
+
+/**
+ * Lock contention profiler.
+ *
+ * ProfiledMutex<M> wraps any mutex that offers lock(), try_lock() and
+ * unlock(): the Mutex from Threading.h, the Policy mutexes from
+ * Strategies/PosixMutex.h, LockOrder::CheckedMutex or std::mutex.
+ *
+ * The uncontended path is a plain lock() and a few relaxed loads and stores.
+ * The owner sets a held flag, and lock() only takes the slow path when it
+ * finds the flag set. So a thread that races another one into an unlocked
+ * mutex may block without the wait being counted. A try_lock() up front
+ * would catch that too, but with glibc pthread_mutex_trylock costs about
+ * twice as much as pthread_mutex_lock, which would double an uncontended
+ * lock+unlock.
+ *
+ * Measured with main.cpp, the profiled pthread mutexes and std::mutex stay
+ * within about 1.5 ns of the plain ones (7 ns); the spin lock pays about
+ * 4 ns on top of its 10 ns.
+ *
+ * All bookkeeping happens while the mutex is held, so the counters need no
+ * atomic read-modify-write. Only a contended acquisition reads the clock
+ * and captures a backtrace to attribute the wait to its call site. Nothing
+ * is allocated after the first mutex is constructed.
+ *
+ * Dump() prints all live profiled mutexes, hottest first.
+ */
+namespace LockProfiler {
+
+
+namespace Detail {
+
+
+// Counter that is only written while the profiled mutex is held.
+// Relaxed atomics make concurrent reads from Dump() well-defined.
+struct Counter
+{
+    Counter() : mValue(0) {}
+
+    void add(uint64_t n) { mValue.store(mValue.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    void set(uint64_t n) { mValue.store(n, std::memory_order_relaxed); }
+
+    uint64_t get() const { return mValue.load(std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> mValue;
+};
+
+
+struct CallSite
+{
+    enum { cDepth = 6 };
+
+    CallSite() : mFrames(), mFrameCount(0) {}
+
+    bool matches(void * const * inFrames, int inCount) const
+    {
+        return frame_count() == inCount && std::equal(inFrames, inFrames + inCount, mFrames);
+    }
+
+    // Zero means the slot is still free. The frames are written once,
+    // before the count is published.
+    int frame_count() const { return mFrameCount.load(std::memory_order_acquire); }
+
+    void * mFrames[cDepth];
+    std::atomic<int> mFrameCount;
+    Counter mCount;
+    Counter mWaitNs;
+};
+
+
+struct Stats
+{
+    // Histogram bucket i counts waits in [2^i, 2^(i+1)) nanoseconds.
+    enum { cBuckets = 32, cCallSites = 8 };
+
+    Counter mAcquisitions;
+    Counter mContended;
+    Counter mWaitNs;
+    Counter mMaxWaitNs;
+    Counter mHistogram[cBuckets];
+    CallSite mCallSites[cCallSites];
+    Counter mOtherCallSites;
+
+    void record_contention(uint64_t inWaitNs, void * const * inFrames, int inFrameCount)
+    {
+        mContended.add(1);
+        mWaitNs.add(inWaitNs);
+        if (inWaitNs > mMaxWaitNs.get())
+        {
+            mMaxWaitNs.set(inWaitNs);
+        }
+
+        unsigned bucket = inWaitNs ? 63 - __builtin_clzll(inWaitNs) : 0;
+        mHistogram[std::min<unsigned>(bucket, cBuckets - 1)].add(1);
+
+        for (auto & site : mCallSites)
+        {
+            if (site.frame_count() == 0)
+            {
+                std::copy(inFrames, inFrames + inFrameCount, site.mFrames);
+                site.mFrameCount.store(inFrameCount, std::memory_order_release);
+            }
+            if (site.matches(inFrames, inFrameCount))
+            {
+                site.mCount.add(1);
+                site.mWaitNs.add(inWaitNs);
+                return;
+            }
+        }
+        mOtherCallSites.add(1);
+    }
+};
+
+
+} // namespace Detail
+
+
+/**
+ * Base class that links every profiled mutex into a global registry.
+ * Registration only happens at construction and destruction.
+ */
+class Registered
+{
+public:
+    const std::string & name() const { return mName; }
+
+    const Detail::Stats & stats() const { return mStats; }
+
+protected:
+    explicit Registered(const std::string & inName) : mName(inName)
+    {
+        // The first backtrace() loads libgcc, which allocates.
+        static const bool fWarmedUp = WarmUpBacktrace();
+        (void)fWarmedUp;
+
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        Registry().push_back(this);
+    }
+
+    ~Registered()
+    {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        auto & registry = Registry();
+        registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    }
+
+    Registered(const Registered&) = delete;
+    Registered& operator=(const Registered&) = delete;
+
+    friend void Dump(std::ostream & os);
+
+    static bool WarmUpBacktrace()
+    {
+        void * frames[1];
+        return backtrace(frames, 1) >= 0;
+    }
+
+    static std::mutex & RegistryMutex()
+    {
+        static std::mutex fMutex;
+        return fMutex;
+    }
+
+    static std::vector<Registered*> & Registry()
+    {
+        static std::vector<Registered*> fRegistry;
+        return fRegistry;
+    }
+
+    std::string mName;
+    Detail::Stats mStats;
+};
+
+
+template<typename MutexT>
+class ProfiledMutex : public Registered
+{
+public:
+    typedef MutexT Mutex;
+
+    explicit ProfiledMutex(const std::string & inName = "<unnamed>") : Registered(inName), mMutex(), mHeld(false)
+    {
+    }
+
+    // Always inlined, so that the frame above lock_contended is the call site.
+    __attribute__((always_inline)) void lock()
+    {
+        if (!mHeld.load(std::memory_order_relaxed))
+        {
+            mMutex.lock();
+            acquired();
+            return;
+        }
+        lock_contended();
+    }
+
+    bool try_lock()
+    {
+        if (mMutex.try_lock())
+        {
+            acquired();
+            return true;
+        }
+        return false;
+    }
+
+    void unlock()
+    {
+        mHeld.store(false, std::memory_order_relaxed);
+        mMutex.unlock();
+    }
+
+    Mutex & native() { return mMutex; }
+
+private:
+    void acquired()
+    {
+        mHeld.store(true, std::memory_order_relaxed);
+        mStats.mAcquisitions.add(1);
+    }
+
+    // Kept out of line so that lock() stays small.
+    __attribute__((noinline)) void lock_contended()
+    {
+        // The holder may have left since the flag was read.
+        if (mMutex.try_lock())
+        {
+            acquired();
+            return;
+        }
+
+        // Captured before waiting: it is only useful if we are going to block
+        // anyway, and it would lengthen the critical section afterwards.
+        void * frames[Detail::CallSite::cDepth + 1];
+        int count = backtrace(frames, Detail::CallSite::cDepth + 1);
+
+        auto start = std::chrono::steady_clock::now();
+        mMutex.lock();
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        // Skip lock_contended; lock() was inlined into the caller.
+        int skip = std::min(count, 1);
+        acquired();
+        mStats.record_contention(static_cast<uint64_t>(wait), frames + skip, count - skip);
+    }
+
+    Mutex mMutex;
+    std::atomic<bool> mHeld; // set by the owner, a hint for lock()
+};
+
+
+/**
+ * Prints the statistics of all live profiled mutexes, sorted by total wait
+ * time. Counters are read without locking the mutexes, so a dump taken
+ * under load may be slightly inconsistent, but it never blocks them.
+ */
+inline void Dump(std::ostream & os)
+{
+    std::lock_guard<std::mutex> lock(Registered::RegistryMutex());
+    std::vector<Registered*> mutexes = Registered::Registry();
+    std::sort(mutexes.begin(), mutexes.end(), [](const Registered * lhs, const Registered * rhs)
+    {
+        return lhs->stats().mWaitNs.get() > rhs->stats().mWaitNs.get();
+    });
+
+    for (const Registered * mutex : mutexes)
+    {
+        const Detail::Stats & stats = mutex->stats();
+        uint64_t acquisitions = stats.mAcquisitions.get();
+        uint64_t contended = stats.mContended.get();
+        os << mutex->name() << ": acquisitions=" << acquisitions
+           << " contended=" << contended
+           << " (" << std::fixed << std::setprecision(2) << (acquisitions ? 100.0 * contended / acquisitions : 0.0) << "%)"
+           << " wait_total_us=" << stats.mWaitNs.get() / 1000
+           << " wait_max_us=" << stats.mMaxWaitNs.get() / 1000
+           << std::endl;
+
+        if (contended == 0)
+        {
+            continue;
+        }
+
+        os << "  wait histogram:";
+        for (unsigned i = 0; i != Detail::Stats::cBuckets; ++i)
+        {
+            if (uint64_t n = stats.mHistogram[i].get())
+            {
+                os << " <" << (uint64_t(2) << i) << "ns:" << n;
+            }
+        }
+        os << std::endl;
+
+        for (const auto & site : stats.mCallSites)
+        {
+            int frame_count = site.frame_count();
+            if (frame_count == 0)
+            {
+                break;
+            }
+            os << "  call site: contended=" << site.mCount.get() << " wait_us=" << site.mWaitNs.get() / 1000 << std::endl;
+            char ** symbols = backtrace_symbols(site.mFrames, frame_count);
+            for (int i = 0; i != frame_count; ++i)
+            {
+                os << "    " << (symbols ? symbols[i] : "?") << std::endl;
+            }
+            free(symbols);
+        }
+        if (uint64_t other = stats.mOtherCallSites.get())
+        {
+            os << "  other call sites: contended=" << other << std::endl;
+        }
+    }
+}
+
+
+} // namespace LockProfiler
+
+
+#endif // LOCKPROFILER_H_INCLUDED
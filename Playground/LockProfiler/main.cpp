@@ -0,0 +1,98 @@
+#include "LockProfiler.h"
+#include "PosixMutex.h"
+#include "Threading.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// 1. Overhead of the profiler on uncontended locks, for each mutex type.
+// 2. A small contended workload with a hot and a cold lock, followed by a dump.
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+enum { cIterations = 10 * 1000 * 1000 };
+
+
+template<typename MutexType>
+double uncontended(MutexType & inMutex)
+{
+    auto start = Clock::now();
+    for (unsigned i = 0; i != cIterations; ++i)
+    {
+        inMutex.lock();
+        inMutex.unlock();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cIterations;
+}
+
+
+template<typename MutexType>
+void compare(const char * inName)
+{
+    MutexType plain;
+    LockProfiler::ProfiledMutex<MutexType> profiled(inName);
+    double plain_ns = uncontended(plain);
+    double profiled_ns = uncontended(profiled);
+    std::cout << "  " << inName << ": plain " << plain_ns << " ns, profiled " << profiled_ns << " ns" << std::endl;
+}
+
+
+LockProfiler::ProfiledMutex<Mutex> gHotMutex("hot");
+LockProfiler::ProfiledMutex<Mutex> gColdMutex("cold");
+long gHotCounter = 0;
+long gColdCounter = 0;
+
+
+void update_hot()
+{
+    std::lock_guard<LockProfiler::ProfiledMutex<Mutex>> lock(gHotMutex);
+    for (int i = 0; i != 100; ++i)
+    {
+        ++gHotCounter;
+    }
+}
+
+
+void update_cold()
+{
+    std::lock_guard<LockProfiler::ProfiledMutex<Mutex>> lock(gColdMutex);
+    ++gColdCounter;
+}
+
+
+int main()
+{
+    std::cout << "Uncontended lock+unlock:" << std::endl;
+    compare<Mutex>("Threading.h Mutex");
+    compare<Policy::Mutex>("Policy::Mutex");
+    compare<Policy::SpinMutex>("Policy::SpinMutex");
+    compare<std::mutex>("std::mutex");
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+    {
+        threads.push_back(std::thread([]
+        {
+            for (int i = 0; i != 200 * 1000; ++i)
+            {
+                update_hot();
+                if (i % 100 == 0)
+                {
+                    update_cold();
+                }
+            }
+        }));
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    std::cout << std::endl << "Contention profile:" << std::endl;
+    LockProfiler::Dump(std::cout);
+}
@@ -0,0 +1,323 @@
+#ifndef MACTABLE_H_INCLUDED
+#define MACTABLE_H_INCLUDED
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+//! Packs a 6-byte MAC address into the low 48 bits of a 64-bit word.
+inline uint64_t PackMAC(const uint8_t * inBytes)
+{
+    uint64_t key = 0;
+    std::memcpy(&key, inBytes, 6);
+    return key;
+}
+
+
+/**
+ * Flat open-addressing hash table keyed by packed MAC addresses.
+ *
+ * Keys, values and one control byte per slot are kept in three separate
+ * arrays. Slots are probed in groups of 16: the 7-bit tags of a group are
+ * compared against the tag of the key in one SSE2 instruction, so a lookup
+ * usually touches one control-byte cache line and one key cache line.
+ *
+ * find_batch() looks up many keys at once and prefetches the groups of the
+ * keys that come next while probing the current one.
+ */
+template<typename Value>
+class MACTable
+{
+public:
+    enum { cGroupSize = 16 };
+
+    MACTable() : mControl(nullptr), mGroupMask(0), mSize(0), mDeleted(0)
+    {
+        allocate(1);
+    }
+
+    MACTable(const MACTable&) = delete;
+    MACTable& operator=(const MACTable&) = delete;
+
+    std::size_t size() const { return mSize; }
+
+    bool empty() const { return mSize == 0; }
+
+    std::size_t capacity() const { return (mGroupMask + 1) * cGroupSize; }
+
+    //! Returns a pointer to the value or nullptr if the key is absent.
+    const Value * find(uint64_t inKey) const
+    {
+        return find(inKey, Hash(inKey));
+    }
+
+    Value * find(uint64_t inKey)
+    {
+        return const_cast<Value*>(static_cast<const MACTable&>(*this).find(inKey, Hash(inKey)));
+    }
+
+    bool contains(uint64_t inKey) const
+    {
+        return find(inKey) != nullptr;
+    }
+
+    //! Inserts or overwrites. Returns true if the key was new.
+    bool insert(uint64_t inKey, const Value & inValue)
+    {
+        uint64_t hash = Hash(inKey);
+        if (Value * value = const_cast<Value*>(find(inKey, hash)))
+        {
+            *value = inValue;
+            return false;
+        }
+
+        if ((mSize + mDeleted + 1) * 8 > capacity() * 7)
+        {
+            // Grow, unless most of the load is made up of tombstones.
+            rehash(mSize * 2 >= capacity() / 2 ? 2 * (mGroupMask + 1) : mGroupMask + 1);
+        }
+
+        std::size_t slot = find_free_slot(hash);
+        if (mControl[slot] == cDeleted)
+        {
+            --mDeleted;
+        }
+        mControl[slot] = Tag(hash);
+        mKeys[slot] = inKey;
+        mValues[slot] = inValue;
+        ++mSize;
+        return true;
+    }
+
+    bool erase(uint64_t inKey)
+    {
+        const Value * value = find(inKey);
+        if (!value)
+        {
+            return false;
+        }
+        std::size_t slot = value - mValues.get();
+
+        // A group that still has an empty slot never made a probe sequence
+        // continue past it, so the slot can become empty again.
+        std::size_t group_begin = slot & ~std::size_t(cGroupSize - 1);
+        if (MatchEmpty(&mControl[group_begin]))
+        {
+            mControl[slot] = cEmpty;
+        }
+        else
+        {
+            mControl[slot] = cDeleted;
+            ++mDeleted;
+        }
+        --mSize;
+        return true;
+    }
+
+    /**
+     * Looks up inCount keys. outResults[i] receives the value pointer for
+     * inKeys[i], or nullptr. Returns the number of keys that were found.
+     */
+    std::size_t find_batch(const uint64_t * inKeys, std::size_t inCount, const Value ** outResults) const
+    {
+        enum { cPrefetchDistance = 8 };
+
+        uint64_t hashes[cPrefetchDistance];
+        std::size_t ahead = std::min<std::size_t>(inCount, cPrefetchDistance);
+        for (std::size_t i = 0; i != ahead; ++i)
+        {
+            hashes[i] = Hash(inKeys[i]);
+            prefetch(hashes[i]);
+        }
+
+        std::size_t found = 0;
+        for (std::size_t i = 0; i != inCount; ++i)
+        {
+            uint64_t hash = hashes[i % cPrefetchDistance];
+            if (i + cPrefetchDistance < inCount)
+            {
+                uint64_t next = Hash(inKeys[i + cPrefetchDistance]);
+                hashes[i % cPrefetchDistance] = next;
+                prefetch(next);
+            }
+            outResults[i] = find(inKeys[i], hash);
+            found += outResults[i] != nullptr;
+        }
+        return found;
+    }
+
+    template<typename F>
+    void for_each(F f) const
+    {
+        for (std::size_t i = 0; i != capacity(); ++i)
+        {
+            if (mControl[i] >= 0)
+            {
+                f(mKeys[i], mValues[i]);
+            }
+        }
+    }
+
+private:
+    static const int8_t cEmpty = -128; // 0b10000000
+    static const int8_t cDeleted = -2; // 0b11111110
+
+    static uint64_t Hash(uint64_t inKey)
+    {
+        uint64_t h = inKey * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    static int8_t Tag(uint64_t inHash)
+    {
+        return static_cast<int8_t>(inHash & 0x7F);
+    }
+
+    std::size_t first_group(uint64_t inHash) const
+    {
+        return static_cast<std::size_t>(inHash >> 7) & mGroupMask;
+    }
+
+#ifdef __SSE2__
+    static unsigned Match(const int8_t * inGroup, int8_t inTag)
+    {
+        __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(inGroup));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(inTag)));
+    }
+
+    static unsigned MatchEmpty(const int8_t * inGroup)
+    {
+        return Match(inGroup, cEmpty);
+    }
+
+    // Empty and deleted are the only control values with the high bit set.
+    static unsigned MatchEmptyOrDeleted(const int8_t * inGroup)
+    {
+        __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(inGroup));
+        return _mm_movemask_epi8(ctrl);
+    }
+#else
+    static unsigned Match(const int8_t * inGroup, int8_t inTag)
+    {
+        unsigned mask = 0;
+        for (unsigned i = 0; i != cGroupSize; ++i)
+        {
+            mask |= unsigned(inGroup[i] == inTag) << i;
+        }
+        return mask;
+    }
+
+    static unsigned MatchEmpty(const int8_t * inGroup)
+    {
+        return Match(inGroup, cEmpty);
+    }
+
+    static unsigned MatchEmptyOrDeleted(const int8_t * inGroup)
+    {
+        unsigned mask = 0;
+        for (unsigned i = 0; i != cGroupSize; ++i)
+        {
+            mask |= unsigned(inGroup[i] < 0) << i;
+        }
+        return mask;
+    }
+#endif
+
+    const Value * find(uint64_t inKey, uint64_t inHash) const
+    {
+        int8_t tag = Tag(inHash);
+        std::size_t group = first_group(inHash);
+        for (std::size_t step = 1; ; ++step)
+        {
+            const int8_t * ctrl = &mControl[group * cGroupSize];
+            for (unsigned match = Match(ctrl, tag); match; match &= match - 1)
+            {
+                std::size_t slot = group * cGroupSize + __builtin_ctz(match);
+                if (mKeys[slot] == inKey)
+                {
+                    return &mValues[slot];
+                }
+            }
+            if (MatchEmpty(ctrl))
+            {
+                return nullptr;
+            }
+            group = (group + step) & mGroupMask; // triangular probing visits every group
+        }
+    }
+
+    std::size_t find_free_slot(uint64_t inHash) const
+    {
+        std::size_t group = first_group(inHash);
+        for (std::size_t step = 1; ; ++step)
+        {
+            if (unsigned mask = MatchEmptyOrDeleted(&mControl[group * cGroupSize]))
+            {
+                return group * cGroupSize + __builtin_ctz(mask);
+            }
+            group = (group + step) & mGroupMask;
+        }
+    }
+
+    void prefetch(uint64_t inHash) const
+    {
+        std::size_t group = first_group(inHash);
+        __builtin_prefetch(&mControl[group * cGroupSize]);
+        __builtin_prefetch(&mKeys[group * cGroupSize]);
+    }
+
+    void allocate(std::size_t inGroupCount)
+    {
+        std::size_t capacity = inGroupCount * cGroupSize;
+        mGroupMask = inGroupCount - 1;
+        mControlStorage.reset(new int8_t[capacity + cGroupSize]);
+        // Groups are loaded with aligned SSE loads.
+        mControl = reinterpret_cast<int8_t*>((reinterpret_cast<uintptr_t>(mControlStorage.get()) + cGroupSize - 1) & ~uintptr_t(cGroupSize - 1));
+        std::fill(mControl, mControl + capacity, int8_t(cEmpty));
+        mKeys.reset(new uint64_t[capacity]);
+        mValues.reset(new Value[capacity]);
+        mSize = 0;
+        mDeleted = 0;
+    }
+
+    void rehash(std::size_t inGroupCount)
+    {
+        std::size_t old_capacity = capacity();
+        std::unique_ptr<int8_t[]> old_control_storage(std::move(mControlStorage));
+        int8_t * old_control = mControl;
+        std::unique_ptr<uint64_t[]> old_keys(std::move(mKeys));
+        std::unique_ptr<Value[]> old_values(std::move(mValues));
+
+        allocate(inGroupCount);
+        for (std::size_t i = 0; i != old_capacity; ++i)
+        {
+            if (old_control[i] >= 0)
+            {
+                uint64_t hash = Hash(old_keys[i]);
+                std::size_t slot = find_free_slot(hash);
+                mControl[slot] = Tag(hash);
+                mKeys[slot] = old_keys[i];
+                mValues[slot] = std::move(old_values[i]);
+                ++mSize;
+            }
+        }
+    }
+
+    std::unique_ptr<int8_t[]> mControlStorage;
+    int8_t * mControl;
+    std::unique_ptr<uint64_t[]> mKeys;
+    std::unique_ptr<Value[]> mValues;
+    std::size_t mGroupMask;
+    std::size_t mSize;
+    std::size_t mDeleted;
+};
+
+
+#endif // MACTABLE_H_INCLUDED
@@ -1,3 +1,5 @@
+#include "Benchmark.h"
+#include "MACTable.h"
 #include <boost/functional/hash.hpp>
 #include <algorithm>
 #include <array>
@@ -10,15 +12,6 @@
 #include <random>
 #include <string>
 #include <unordered_map>
-#include <sys/time.h>
-
-
-double GetCurrentTime()
-{
-    timeval tv;
-    gettimeofday(&tv, NULL);
-    return double (tv.tv_sec) + 0.000001 * tv.tv_usec;
-}
 
 
 uint8_t GetRandomByte()
@@ -84,56 +77,83 @@ struct Hash {
 typedef std::unordered_map<MAC, bool, Hash> HashMap;
 
 
+// The union already holds the packed 48-bit key that MACTable expects.
+typedef MACTable<bool> FlatMap;
+
+
+template<typename ContainerType>
+bool Contains(const ContainerType & container, const MAC & mac)
+{
+    return container.find(mac) != container.end();
+}
+
+
+bool Contains(const FlatMap & container, const MAC & mac)
+{
+    return container.contains(mac.data.key);
+}
+
+
 MAC GetRandomMAC()
 {
     return MAC(GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte());
 }
 
 
-template<typename ContainerType>
-std::tuple<unsigned, unsigned, unsigned> Benchmark(const ContainerType & container)
+//! Wrapper that marks a table for batched lookups in the benchmark.
+struct BatchedFlatMap
 {
+    FlatMap table;
+};
 
-    // Generate a list of random MAC addresses
-    std::size_t cNumIterations = 1000000;
 
+enum { cNumIterations = 1000000 };
 
-    static auto randomMacs = [=]() -> std::vector<MAC> {
-        std::vector<MAC> result;
-        for (unsigned i = 0; i < cNumIterations; ++i)
-        {
-            result.push_back(GetRandomMAC());
-        }
-        return result;
-    }();
-    // Search each random mac in the container and count the results.
-    // (The counter was introduced to prevent the compiler from optimizing everything away.)
-    double beginTime = GetCurrentTime();
-    unsigned found = 0;
-    for (std::size_t idx = 0; idx < cNumIterations; ++idx)
+
+// Search each MAC of inMacs in the container and count the results.
+template<typename ContainerType>
+void Benchmark(Bench::Runner & runner, const std::string & inName, const ContainerType & container, const std::vector<MAC> & inMacs)
+{
+    runner.run_batch(inName, inMacs.size(), [&]
     {
-        if (container.find(randomMacs[idx]) != container.end())
+        unsigned found = 0;
+        for (std::size_t idx = 0; idx < inMacs.size(); ++idx)
         {
-            found++;
+            if (Contains(container, inMacs[idx]))
+            {
+                found++;
+            }
         }
-    }
-
-    return std::tuple<unsigned, unsigned, unsigned>(unsigned(0.5 + 1000 * (GetCurrentTime() - beginTime)),
-                                                    found,
-                                                    cNumIterations);
+        Bench::DoNotOptimize(found);
+    });
 }
 
 
-std::ostream & operator<<(std::ostream & os, const std::tuple<unsigned, unsigned, unsigned> & result)
+void Benchmark(Bench::Runner & runner, const std::string & inName, const BatchedFlatMap & container, const std::vector<uint64_t> & inKeys)
 {
-    os << std::right << std::setw(10) << (std::to_string(std::get<0>(result)) + " ms") << std::flush;
-    os << std::left << std::setw(20) << std::string(" (" + std::to_string(std::get<1>(result)) + "/" + std::to_string(std::get<2>(result)) + ").");
-    return os;
+    enum { cBatchSize = 64 };
+
+    runner.run_batch(inName, inKeys.size(), [&]
+    {
+        unsigned found = 0;
+        const bool * results[cBatchSize];
+        for (std::size_t idx = 0; idx < inKeys.size(); idx += cBatchSize)
+        {
+            std::size_t count = std::min<std::size_t>(cBatchSize, inKeys.size() - idx);
+            found += container.table.find_batch(&inKeys[idx], count, results);
+        }
+        Bench::DoNotOptimize(found);
+    });
 }
 
 
-int main()
+int main(int argc, char ** argv)
 {
+    // Every repetition does a million lookups.
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
     unsigned cMAX = 1000000;
     auto randomMacs = [&]() -> std::vector<MAC> {
         std::vector<MAC> macs;
@@ -143,7 +163,26 @@ int main()
         return macs;
     }();
 
+    // The MAC addresses that every column looks up, generated once so that
+    // the found counts and times compare. The batched column gets them
+    // packed up front: a forwarding path would read the key straight from
+    // the frame.
+    const std::vector<MAC> lookupMacs = [&]() -> std::vector<MAC> {
+        std::vector<MAC> macs;
+        for (std::size_t idx = 0; idx != cNumIterations; ++idx) {
+            macs.push_back(GetRandomMAC());
+        }
+        return macs;
+    }();
+    std::vector<uint64_t> lookupKeys;
+    for (const MAC & mac : lookupMacs)
+    {
+        lookupKeys.push_back(mac.data.key);
+    }
+
+    // Building the containers is measured as regions, reported at the end.
     auto GetMap = [&](std::size_t inSize) -> Map {
+        Bench::Scope scope(Bench::Region::Get("build/map"));
         Map result;
         for (std::size_t idx = 0; idx != inSize; ++idx)
         {
@@ -153,6 +192,7 @@ int main()
     };
 
     auto GetHashMap = [&](std::size_t inSize) -> HashMap {
+        Bench::Scope scope(Bench::Region::Get("build/hash"));
         HashMap result;
         for (std::size_t idx = 0; idx != inSize; ++idx)
         {
@@ -161,16 +201,25 @@ int main()
         return result;
     };
 
-    std::cout << "size, map/hash" << std::endl;
-
-    std::cout << std::right << std::setw(10) << std::setfill(' ') << "Size" << std::flush
-              << std::right << std::setw(10) << "Map" << std::setw(20) << " " << std::flush
-              << std::right << std::setw(10) << "Hash" << std::setw(20) << " " << std::endl;
+    auto GetFlatMap = [&](std::size_t inSize, FlatMap & result) {
+        Bench::Scope scope(Bench::Region::Get("build/flat"));
+        for (std::size_t idx = 0; idx != inSize; ++idx)
+        {
+            result.insert(randomMacs[idx % randomMacs.size()].data.key, false);
+        }
+    };
 
     for (unsigned i = 1; i <= cMAX; i *= 2)
     {
-        std::cout << std::right << std::setw(10) << std::setfill(' ') << i << std::flush
-                  << std::right << Benchmark(GetMap(i)) << std::flush
-                  << std::right << Benchmark(GetHashMap(i)) << std::endl;
+        FlatMap flatMap;
+        GetFlatMap(i, flatMap);
+        BatchedFlatMap batchedFlatMap;
+        GetFlatMap(i, batchedFlatMap.table);
+
+        const std::string size = "/size:" + std::to_string(i);
+        Benchmark(runner, "map" + size, GetMap(i), lookupMacs);
+        Benchmark(runner, "hash" + size, GetHashMap(i), lookupMacs);
+        Benchmark(runner, "flat" + size, flatMap, lookupMacs);
+        Benchmark(runner, "flat_batched" + size, batchedFlatMap, lookupKeys);
     }
 }
@@ -1,3 +1,5 @@
+#include "Benchmark.h"
+#include "MACTable.h"
 #include <boost/functional/hash.hpp>
 #include <algorithm>
 #include <array>
@@ -10,15 +12,6 @@
 #include <random>
 #include <string>
 #include <unordered_map>
-#include <sys/time.h>
-
-
-double GetCurrentTime()
-{
-    timeval tv;
-    gettimeofday(&tv, NULL);
-    return double (tv.tv_sec) + 0.000001 * tv.tv_usec;
-}
 
 
 uint8_t GetRandomByte()
@@ -45,9 +38,13 @@ struct Hash {
         static_assert(sizeof(std::size_t) >= 6, "MAC address doesn't fit in std::size_t!");
         std::size_t key = 0;
 
-        // Possibly UB?
-        boost::hash_combine(key, reinterpret_cast<const uint32_t&>(mac[0]));
-        boost::hash_combine(key, reinterpret_cast<const uint16_t&>(mac[4]));
+        // memcpy instead of reinterpret_cast: the array has no alignment guarantees.
+        uint32_t high;
+        uint16_t low;
+        std::memcpy(&high, &mac[0], sizeof(high));
+        std::memcpy(&low, &mac[4], sizeof(low));
+        boost::hash_combine(key, high);
+        boost::hash_combine(key, low);
         return key;
     }
 };
@@ -56,21 +53,43 @@ struct Hash {
 typedef std::unordered_map<MAC, bool, Hash> HashMap;
 
 
-MAC GetRandomMAC()
+typedef MACTable<bool> FlatMap;
+
+
+//! Wrapper that marks a table for batched lookups in the benchmark.
+struct BatchedFlatMap
 {
-    return MAC({{ GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte() }});
-}
+    FlatMap table;
+};
 
 
 template<typename ContainerType>
-std::tuple<unsigned, unsigned, unsigned> Benchmark(const ContainerType & container)
+bool Contains(const ContainerType & container, const MAC & mac)
 {
+    return container.find(mac) != container.end();
+}
 
-    // Generate a list of random MAC addresses
-    std::size_t cNumIterations = 1000000;
+
+bool Contains(const FlatMap & container, const MAC & mac)
+{
+    return container.contains(PackMAC(mac.data()));
+}
 
 
-    static auto randomMacs = [=]() -> std::vector<MAC> {
+MAC GetRandomMAC()
+{
+    return MAC({{ GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte(), GetRandomByte() }});
+}
+
+
+enum { cNumIterations = 1000000 };
+
+
+// The MAC addresses that every column looks up, generated once so that the
+// found counts and times compare.
+const std::vector<MAC> & GetLookupMACs()
+{
+    static const std::vector<MAC> fMacs = []() -> std::vector<MAC> {
         std::vector<MAC> result;
         for (unsigned i = 0; i < cNumIterations; ++i)
         {
@@ -78,34 +97,66 @@ std::tuple<unsigned, unsigned, unsigned> Benchmark(const ContainerType & contain
         }
         return result;
     }();
+    return fMacs;
+}
+
+
+template<typename ContainerType>
+void Benchmark(Bench::Runner & runner, const std::string & inName, const ContainerType & container)
+{
+    const std::vector<MAC> & randomMacs = GetLookupMACs();
+
     // Search each random mac in the container and count the results.
-    // (The counter was introduced to prevent the compiler from optimizing everything away.)
-    double beginTime = GetCurrentTime();
-    unsigned found = 0;
-    for (std::size_t idx = 0; idx < cNumIterations; ++idx)
+    runner.run_batch(inName, cNumIterations, [&]
     {
-        if (container.find(randomMacs[idx]) != container.end())
+        unsigned found = 0;
+        for (std::size_t idx = 0; idx < cNumIterations; ++idx)
         {
-            found++;
+            if (Contains(container, randomMacs[idx]))
+            {
+                found++;
+            }
         }
-    }
-
-    return std::tuple<unsigned, unsigned, unsigned>(unsigned(0.5 + 1000 * (GetCurrentTime() - beginTime)),
-                                                    found,
-                                                    cNumIterations);
+        Bench::DoNotOptimize(found);
+    });
 }
 
 
-std::ostream & operator<<(std::ostream & os, const std::tuple<unsigned, unsigned, unsigned> & result)
+void Benchmark(Bench::Runner & runner, const std::string & inName, const BatchedFlatMap & container)
 {
-    os << std::right << std::setw(10) << (std::to_string(std::get<0>(result)) + " ms") << std::flush;
-    os << std::left << std::setw(20) << std::string(" (" + std::to_string(std::get<1>(result)) + "/" + std::to_string(std::get<2>(result)) + ").");
-    return os;
+    enum { cBatchSize = 64 };
+
+    // Packing is done up front: a forwarding path would read the key straight from the frame.
+    static const std::vector<uint64_t> randomKeys = []() -> std::vector<uint64_t> {
+        std::vector<uint64_t> result;
+        for (const MAC & mac : GetLookupMACs())
+        {
+            result.push_back(PackMAC(mac.data()));
+        }
+        return result;
+    }();
+
+    runner.run_batch(inName, cNumIterations, [&]
+    {
+        unsigned found = 0;
+        const bool * results[cBatchSize];
+        for (std::size_t idx = 0; idx < cNumIterations; idx += cBatchSize)
+        {
+            std::size_t count = std::min<std::size_t>(cBatchSize, cNumIterations - idx);
+            found += container.table.find_batch(&randomKeys[idx], count, results);
+        }
+        Bench::DoNotOptimize(found);
+    });
 }
 
 
-int main()
+int main(int argc, char ** argv)
 {
+    // Every repetition does a million lookups.
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
     unsigned cMAX = 512;
     auto randomMacs = [&]() -> std::vector<MAC> {
         std::vector<MAC> macs;
@@ -115,7 +166,9 @@ int main()
         return macs;
     }();
 
+    // Building the containers is measured as regions, reported at the end.
     auto GetMap = [&](std::size_t inSize) -> Map {
+        Bench::Scope scope(Bench::Region::Get("build/map"));
         Map result;
         for (std::size_t idx = 0; idx != inSize; ++idx)
         {
@@ -125,6 +178,7 @@ int main()
     };
 
     auto GetHashMap = [&](std::size_t inSize) -> HashMap {
+        Bench::Scope scope(Bench::Region::Get("build/hash"));
         HashMap result;
         for (std::size_t idx = 0; idx != inSize; ++idx)
         {
@@ -133,16 +187,25 @@ int main()
         return result;
     };
 
-    std::cout << "size, map/hash" << std::endl;
-
-    std::cout << std::right << std::setw(10) << std::setfill(' ') << "Size" << std::flush
-              << std::right << std::setw(10) << "Map" << std::setw(20) << " " << std::flush
-              << std::right << std::setw(10) << "Hash" << std::setw(20) << " " << std::endl;
+    auto GetFlatMap = [&](std::size_t inSize, FlatMap & result) {
+        Bench::Scope scope(Bench::Region::Get("build/flat"));
+        for (std::size_t idx = 0; idx != inSize; ++idx)
+        {
+            result.insert(PackMAC(randomMacs[idx % randomMacs.size()].data()), false);
+        }
+    };
 
     for (unsigned i = 1; i <= cMAX; i *= 2)
     {
-        std::cout << std::right << std::setw(10) << std::setfill(' ') << i << std::flush
-                  << std::right << Benchmark(GetMap(i)) << std::flush
-                  << std::right << Benchmark(GetHashMap(i)) << std::endl;
+        FlatMap flatMap;
+        GetFlatMap(i, flatMap);
+        BatchedFlatMap batchedFlatMap;
+        GetFlatMap(i, batchedFlatMap.table);
+
+        const std::string size = "/size:" + std::to_string(i);
+        Benchmark(runner, "map" + size, GetMap(i));
+        Benchmark(runner, "hash" + size, GetHashMap(i));
+        Benchmark(runner, "flat" + size, flatMap);
+        Benchmark(runner, "flat_batched" + size, batchedFlatMap);
     }
 }
@@ -0,0 +1,181 @@
+#ifndef PERMUTATIONS_H_INCLUDED
+#define PERMUTATIONS_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+
+
+namespace Permutations {
+
+
+/**
+ * Generates all permutations of a vector in place, with Heap's algorithm:
+ * every permutation differs from the previous one by a single swap, and
+ * nothing is allocated after construction.
+ *
+ * The permutations are views on the one vector inside the generator; copy
+ * one to keep it. A generator is also a single pass range:
+ *
+ *     for (const std::vector<int> & p : Permutations::Generator<int>(items)) { ... }
+ */
+template<class T>
+class Generator
+{
+public:
+	class Iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef std::vector<T> value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const std::vector<T> * pointer;
+		typedef const std::vector<T> & reference;
+
+		explicit Iterator(Generator * inGenerator = 0) : mGenerator(inGenerator) {}
+
+		const std::vector<T> & operator*() const { return mGenerator->current(); }
+		const std::vector<T> * operator->() const { return &mGenerator->current(); }
+
+		Iterator & operator++()
+		{
+			if (!mGenerator->next())
+			{
+				mGenerator = 0;
+			}
+			return *this;
+		}
+
+		bool operator==(const Iterator & inOther) const { return mGenerator == inOther.mGenerator; }
+		bool operator!=(const Iterator & inOther) const { return mGenerator != inOther.mGenerator; }
+
+	private:
+		Generator * mGenerator;
+	};
+
+	//! Starts with inItems as they are, and keeps the first inFixed of them in place.
+	explicit Generator(std::vector<T> inItems, size_t inFixed = 0) :
+		mItems(std::move(inItems)),
+		mFixed(std::min(inFixed, mItems.size())),
+		mCounters(mItems.size() - mFixed, 0),
+		mLevel(1)
+	{
+	}
+
+	const std::vector<T> & current() const { return mItems; }
+
+	//! Moves on to the next permutation, false after the last one.
+	bool next()
+	{
+		T * items = mItems.data() + mFixed;
+		while (mLevel < mCounters.size())
+		{
+			if (mCounters[mLevel] < mLevel)
+			{
+				using std::swap;
+				swap(items[mLevel % 2 == 0 ? 0 : mCounters[mLevel]], items[mLevel]);
+				mCounters[mLevel]++;
+				mLevel = 1;
+				return true;
+			}
+			mCounters[mLevel] = 0;
+			mLevel++;
+		}
+		return false;
+	}
+
+	Iterator begin() { return Iterator(this); }
+	Iterator end() { return Iterator(); }
+
+private:
+	std::vector<T> mItems;
+	size_t mFixed;
+	std::vector<size_t> mCounters;
+	size_t mLevel;
+};
+
+
+//! Calls inFunction(permutation) for every permutation of inItems.
+template<class T, class F>
+void forEachPermutation(std::vector<T> inItems, F inFunction)
+{
+	Generator<T> generator(std::move(inItems));
+	do
+	{
+		inFunction(generator.current());
+	}
+	while (generator.next());
+}
+
+
+/**
+ * forEachPermutation() on inThreadCount threads, so inFunction is called
+ * concurrently and in no particular order, as inFunction(thread, permutation)
+ * with the thread in [0, inThreadCount), for per-thread results.
+ *
+ * The permutations are split by prefix: a task fixes the first few items
+ * and generates the permutations of the rest. The prefixes are just long
+ * enough to give every thread several tasks, which the threads claim one
+ * by one from a shared counter.
+ */
+template<class T, class F>
+void forEachPermutation_MultiThreaded(const std::vector<T> & inItems, unsigned inThreadCount, F inFunction)
+{
+	const size_t n = inItems.size();
+	const size_t cTasksPerThread = 8;
+	inThreadCount = std::max(1u, inThreadCount);
+
+	size_t prefix_length = 0;
+	size_t task_count = 1;
+	while (task_count < cTasksPerThread * inThreadCount && prefix_length + 1 < n)
+	{
+		task_count *= n - prefix_length;
+		prefix_length++;
+	}
+	const unsigned thread_count = static_cast<unsigned>(std::min<size_t>(inThreadCount, task_count));
+
+	std::atomic<size_t> next(0);
+	auto worker = [&](unsigned inThread)
+	{
+		for (size_t task; (task = next.fetch_add(1, std::memory_order_relaxed)) < task_count; )
+		{
+			// The task number in the mixed radix n, n-1, ... picks the prefix.
+			std::vector<T> items = inItems;
+			for (size_t i = 0; i != prefix_length; ++i)
+			{
+				using std::swap;
+				swap(items[i], items[i + task % (n - i)]);
+				task /= n - i;
+			}
+
+			Generator<T> generator(std::move(items), prefix_length);
+			do
+			{
+				inFunction(inThread, generator.current());
+			}
+			while (generator.next());
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 1; t < thread_count; ++t)
+	{
+		threads.push_back(std::thread(worker, t));
+	}
+	worker(0);
+	for (auto & thread : threads)
+	{
+		thread.join();
+	}
+}
+
+
+} // namespace Permutations
+
+
+#endif // PERMUTATIONS_H_INCLUDED
@@ -0,0 +1,230 @@
+#include "Benchmark.h"
+#include "Permutations.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// All permutations of 1..n: the recursive getPermutations() that main.cpp
+// used before, std::next_permutation, the generator, and the generator on
+// 1, 2, 4, ... threads. One operation is one permutation.
+//
+//   benchmark [n]      (default 11)
+//
+// The old version materialises all of them, so it only runs for n = 9.
+// Every run is checked by the number of permutations and a checksum over
+// the first and last items.
+
+
+namespace Original {
+
+
+// Concatenates a value and a vector
+template<class T>
+void concat(const T & inFirst,
+			const std::vector<T> & inItems,
+			std::vector<T> & outItems)
+{
+	outItems.push_back(inFirst);
+	std::copy(inItems.begin(), inItems.end(), std::back_inserter(outItems));
+			
+}
+
+
+template<class T>
+void getPermutations(const std::vector<T> & inItems,
+	   				 std::vector<std::vector<T> > & outPermutations)
+{
+	if (inItems.size() <= 1)
+	{
+		outPermutations.push_back(inItems);
+	}
+	else if (inItems.size() == 2)
+	{
+		outPermutations.push_back(inItems);
+
+		std::vector<T> swapped = inItems;
+		std::swap(swapped[0], swapped[1]);
+		outPermutations.push_back(swapped);
+	}
+	else
+	{
+		for (size_t masterIdx = 0; masterIdx != inItems.size(); ++masterIdx)
+		{
+			// Select a master element
+			const T & master = inItems[masterIdx];
+
+			// Select the subjects
+			std::vector<T> subjects;
+			for (size_t subjectIdx = 0; subjectIdx != inItems.size(); ++subjectIdx)
+			{
+				if (subjectIdx != masterIdx)
+				{
+					subjects.push_back(inItems[subjectIdx]);
+				}
+			}
+			
+			std::vector<std::vector<T> > permutedSubjects;
+			getPermutations(subjects, permutedSubjects);
+			for (size_t i = 0; i != permutedSubjects.size(); ++i)
+			{
+				std::vector<T> permutation;
+				concat(master, permutedSubjects[i], permutation);
+				outPermutations.push_back(permutation);
+			}
+		}
+	}
+}
+
+
+void getIntPermutations(int n, std::vector<std::vector<int> > & outPermutations)
+{
+	std::vector<int> items;
+	for (int i = 1; i <= n; ++i)
+	{
+		items.push_back(i);
+	}
+	getPermutations(items, outPermutations);
+}
+
+
+
+} // namespace Original
+
+
+namespace {
+
+
+struct Checksum
+{
+	Checksum() : count(0), sum(0) {}
+
+	void add(const std::vector<int> & p)
+	{
+		count++;
+		sum += 31 * p.front() + p.back();
+	}
+
+	uint64_t count;
+	uint64_t sum;
+	char padding[64 - 2 * sizeof(uint64_t)]; // one cache line per thread
+};
+
+
+std::vector<int> items(int n)
+{
+	std::vector<int> result;
+	for (int i = 1; i <= n; ++i)
+	{
+		result.push_back(i);
+	}
+	return result;
+}
+
+
+uint64_t factorial(int n)
+{
+	return n <= 1 ? 1 : n * factorial(n - 1);
+}
+
+
+// Every item is first (n-1)! times, and last as often.
+void check(const std::string & name, int n, const Checksum & checksum)
+{
+	const uint64_t count = factorial(n);
+	const uint64_t sum = count / n * 32 * (uint64_t(n) * (n + 1) / 2);
+	if (checksum.count != count || checksum.sum != sum)
+	{
+		throw std::runtime_error(name + ": " + std::to_string(checksum.count) + " permutations with checksum " + std::to_string(checksum.sum)
+		                         + " instead of " + std::to_string(count) + " with " + std::to_string(sum));
+	}
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+	Bench::Options defaults;
+	defaults.repetitions = 5;
+	Bench::Runner runner(argc, argv, defaults);
+
+	int n = 11;
+	if (!runner.options().arguments.empty())
+	{
+		n = std::atoi(runner.options().arguments[0].c_str());
+		if (n < 2 || n > 14)
+		{
+			throw std::invalid_argument("n must be in [2, 14]: " + runner.options().arguments[0]);
+		}
+	}
+
+	runner.run_batch("9/original", factorial(9), []
+	{
+		std::vector<std::vector<int> > permutations;
+		Original::getPermutations(items(9), permutations);
+		Checksum checksum;
+		for (const std::vector<int> & p : permutations)
+		{
+			checksum.add(p);
+		}
+		check("9/original", 9, checksum);
+	});
+
+	std::vector<int> sizes(1, 9);
+	if (n != 9)
+	{
+		sizes.push_back(n);
+	}
+	for (int size : sizes)
+	{
+		const std::string prefix = std::to_string(size) + "/";
+		runner.run_batch(prefix + "next_permutation", factorial(size), [&]
+		{
+			std::vector<int> p = items(size);
+			Checksum checksum;
+			do
+			{
+				checksum.add(p);
+			}
+			while (std::next_permutation(p.begin(), p.end()));
+			check(prefix + "next_permutation", size, checksum);
+		});
+		runner.run_batch(prefix + "generator", factorial(size), [&]
+		{
+			Checksum checksum;
+			for (const std::vector<int> & p : Permutations::Generator<int>(items(size)))
+			{
+				checksum.add(p);
+			}
+			check(prefix + "generator", size, checksum);
+		});
+		runner.run_batch(prefix + "forEachPermutation", factorial(size), [&]
+		{
+			Checksum checksum;
+			Permutations::forEachPermutation(items(size), [&](const std::vector<int> & p) { checksum.add(p); });
+			check(prefix + "forEachPermutation", size, checksum);
+		});
+		for (unsigned threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+		{
+			const std::string name = prefix + "threads:" + std::to_string(threads);
+			runner.run_batch(name, factorial(size), [&]
+			{
+				std::vector<Checksum> checksums(threads);
+				Permutations::forEachPermutation_MultiThreaded(items(size), threads, [&](unsigned t, const std::vector<int> & p) { checksums[t].add(p); });
+				Checksum total;
+				for (const Checksum & c : checksums)
+				{
+					total.count += c.count;
+					total.sum += c.sum;
+				}
+				check(name, size, total);
+			});
+		}
+	}
+}
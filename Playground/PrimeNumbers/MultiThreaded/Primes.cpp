@@ -1,6 +1,9 @@
 #include "Primes.h"
-#include "Poco/Runnable.h"
-#include "Poco/Thread.h"
+#include "RangeScheduler.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <thread>
 
 
 namespace Primes
@@ -74,7 +77,15 @@ namespace Primes
                               std::vector<UInt32> & outPrimes)
     {
         size_t begin = inInterval.first;
-        if (begin % 2 == 0)
+        if (begin <= 2)
+        {
+            if (inInterval.second > 2)
+            {
+                outPrimes.push_back(2);
+            }
+            begin = 3;
+        }
+        else if (begin % 2 == 0)
         {
             begin++;
         }
@@ -97,28 +108,24 @@ namespace Primes
         {
             inNumberOfParts = intervalWidth;
         }
+        if (inNumberOfParts == 0)
+        {
+            return;
+        }
 
         size_t partitionWidth = intervalWidth / inNumberOfParts;
 
         size_t begin = inInterval.first;
         for (size_t idx = 0; idx < inNumberOfParts; ++idx)
         {
-            size_t end = begin + partitionWidth;
-            outIntervals.push_back(std::make_pair(begin, end));            
-            if (idx < (inNumberOfParts - 1))
-            {
-                begin = end;
-            }
-            else // last interval
-            {
-                outIntervals.push_back(std::make_pair(end + 1, inInterval.second));
-                break;
-            }
-
+            // The last interval takes the remainder.
+            size_t end = idx < (inNumberOfParts - 1) ? begin + partitionWidth : inInterval.second;
+            outIntervals.push_back(std::make_pair(begin, end));
+            begin = end;
         }
     }
 
-    class Runner : public Poco::Runnable
+    class Runner
     {
     public:
         Runner(const Interval & inInterval,
@@ -128,7 +135,7 @@ namespace Primes
         {
         }
 
-        virtual void run()
+        void run()
         {
             FindPrimesInInterval(mInterval, mPrecedingPrimes, mFoundPrimes);
         }
@@ -144,32 +151,143 @@ namespace Primes
         std::vector<UInt32> mFoundPrimes;
     };
     
-    void FindPrimesInInterval_MultiThreaded(size_t inNumberOfThreads,
-                                            const Interval & inInterval,
-                                            const std::vector<UInt32> & inPrecedingPrimes,
-                                            std::vector<UInt32> & outPrimes)
+    void FindPrimesInInterval_StaticPartition(size_t inNumberOfThreads,
+                                              const Interval & inInterval,
+                                              const std::vector<UInt32> & inPrecedingPrimes,
+                                              std::vector<UInt32> & outPrimes)
     {
         std::vector<Interval> intervals;
         Partition(inNumberOfThreads, inInterval, intervals);
 
-        std::vector<Poco::Thread *> mThreads;
-        std::vector<Runner*> runners;
+        std::vector<Runner> runners;
+        runners.reserve(intervals.size());
+        std::vector<std::thread> threads;
         for (size_t idx = 0; idx < intervals.size(); ++idx)
         {            
-            const Interval & interval = intervals[idx];
-            mThreads.push_back(new Poco::Thread);
-            runners.push_back(new Runner(interval, inPrecedingPrimes));
-            mThreads.back()->start(*runners[idx]);
+            runners.emplace_back(intervals[idx], inPrecedingPrimes);
+            threads.push_back(std::thread(&Runner::run, &runners.back()));
         }
 
 
-        for (size_t idx = 0; idx != mThreads.size(); ++idx)
+        for (size_t idx = 0; idx != threads.size(); ++idx)
         {
-            mThreads[idx]->join();
-            const std::vector<UInt32> & primes = runners[idx]->foundPrimes();
+            threads[idx].join();
+            const std::vector<UInt32> & primes = runners[idx].foundPrimes();
             outPrimes.insert(outPrimes.end(), primes.begin(), primes.end());
-            delete runners[idx];
-            delete mThreads[idx];            
+        }
+    }
+
+    /**
+     * Finds the primes of the chunks it claims and keeps them in one buffer,
+     * remembering where the primes of each chunk start.
+     */
+    class Worker
+    {
+    public:
+        Worker(RangeScheduler & inScheduler,
+               const std::vector<UInt32> & inPrecedingPrimes) :
+            mScheduler(inScheduler),
+            mPrecedingPrimes(inPrecedingPrimes)
+        {
+        }
+
+        void run()
+        {
+            size_t chunk;
+            while (mScheduler.next(chunk))
+            {
+                Segment segment;
+                segment.chunk = chunk;
+                segment.begin = mFoundPrimes.size();
+                FindPrimesInInterval(mScheduler.chunk(chunk), mPrecedingPrimes, mFoundPrimes);
+                segment.end = mFoundPrimes.size();
+                mSegments.push_back(segment);
+            }
+        }
+
+        //! Adds the number of primes of every claimed chunk to ioChunkSizes.
+        void getChunkSizes(std::vector<size_t> & ioChunkSizes) const
+        {
+            for (size_t idx = 0; idx != mSegments.size(); ++idx)
+            {
+                const Segment & segment = mSegments[idx];
+                ioChunkSizes[segment.chunk] = segment.end - segment.begin;
+            }
+        }
+
+        //! Copies the primes of every claimed chunk to outPrimes + inChunkOffsets[chunk].
+        void copy(const std::vector<size_t> & inChunkOffsets, UInt32 * outPrimes) const
+        {
+            for (size_t idx = 0; idx != mSegments.size(); ++idx)
+            {
+                const Segment & segment = mSegments[idx];
+                std::copy(mFoundPrimes.begin() + segment.begin,
+                          mFoundPrimes.begin() + segment.end,
+                          outPrimes + inChunkOffsets[segment.chunk]);
+            }
+        }
+
+    private:
+        struct Segment
+        {
+            size_t chunk;
+            size_t begin; // range in mFoundPrimes
+            size_t end;
+        };
+
+        RangeScheduler & mScheduler;
+        const std::vector<UInt32> & mPrecedingPrimes;
+        std::vector<UInt32> mFoundPrimes;
+        std::vector<Segment> mSegments;
+    };
+
+    void FindPrimesInInterval_MultiThreaded(size_t inNumberOfThreads,
+                                            const Interval & inInterval,
+                                            const std::vector<UInt32> & inPrecedingPrimes,
+                                            std::vector<UInt32> & outPrimes,
+                                            size_t inChunkSize)
+    {
+        RangeScheduler scheduler(inInterval, inChunkSize);
+        size_t threadCount = std::min(std::max<size_t>(inNumberOfThreads, 1), scheduler.chunkCount());
+        if (threadCount == 0)
+        {
+            return;
+        }
+
+        std::vector<Worker> workers(threadCount, Worker(scheduler, inPrecedingPrimes));
+        std::vector<std::thread> threads;
+        for (size_t idx = 0; idx != threadCount; ++idx)
+        {
+            threads.push_back(std::thread(&Worker::run, &workers[idx]));
+        }
+        for (size_t idx = 0; idx != threadCount; ++idx)
+        {
+            threads[idx].join();
+        }
+
+        // Exclusive prefix sum over the chunks gives every chunk its place in the output.
+        std::vector<size_t> offsets(scheduler.chunkCount(), 0);
+        for (size_t idx = 0; idx != threadCount; ++idx)
+        {
+            workers[idx].getChunkSizes(offsets);
+        }
+        size_t total = outPrimes.size();
+        for (size_t idx = 0; idx != offsets.size(); ++idx)
+        {
+            size_t size = offsets[idx];
+            offsets[idx] = total;
+            total += size;
+        }
+        outPrimes.resize(total);
+
+        threads.clear();
+        for (size_t idx = 0; idx != threadCount; ++idx)
+        {
+            threads.push_back(std::thread(&Worker::copy, &workers[idx], std::cref(offsets), outPrimes.data()));
+        }
+        for (size_t idx = 0; idx != threadCount; ++idx)
+        {
+            threads[idx].join();
         }
     }
 
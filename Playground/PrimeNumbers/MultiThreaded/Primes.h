@@ -1,7 +1,8 @@
 #ifndef PRIMES_H_INCLUDED
 #define PRIMES_H_INCLUDED
 
-#include "Poco/Foundation.h"
+#include <cstddef>
+#include <utility>
 #include <vector>
 typedef unsigned int UInt32;
 
@@ -25,11 +26,36 @@ namespace Primes
     void FindPrimesInInterval(const Interval & inInterval,
                               const std::vector<UInt32> & inPrecedingPrimes,
                               std::vector<UInt32> & outPrimes);
-    
+
+    enum
+    {
+        cDefaultChunkSize = 64 * 1024
+    };
+
+    /**
+     * Appends the prime numbers in the interval [begin, end[ to outPrimes,
+     * in increasing order, using inNumberOfThreads threads.
+     *
+     * The threads claim chunks of inChunkSize numbers until none are left
+     * (see RangeScheduler.h) and all read the same preceding primes. Each
+     * collects its primes in its own buffer; once all are done, every thread
+     * copies its buffer to the offsets given by a prefix sum over the chunks.
+     */
     void FindPrimesInInterval_MultiThreaded(size_t inNumberOfThreads,
                                             const Interval & inInterval,
                                             const std::vector<UInt32> & inPrecedingPrimes,
-                                            std::vector<UInt32> & outPrimes);
+                                            std::vector<UInt32> & outPrimes,
+                                            size_t inChunkSize = cDefaultChunkSize);
+
+    /**
+     * The original scheme, kept for comparison: one interval of equal width
+     * per thread, each thread with its own copy of the preceding primes, and
+     * the results concatenated after joining.
+     */
+    void FindPrimesInInterval_StaticPartition(size_t inNumberOfThreads,
+                                              const Interval & inInterval,
+                                              const std::vector<UInt32> & inPrecedingPrimes,
+                                              std::vector<UInt32> & outPrimes);
 } // namespace Primes
 
 
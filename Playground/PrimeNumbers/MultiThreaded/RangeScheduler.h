@@ -0,0 +1,73 @@
+#ifndef RANGESCHEDULER_H_INCLUDED
+#define RANGESCHEDULER_H_INCLUDED
+
+#include "Primes.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace Primes
+{
+
+    /**
+     * Hands out an interval in chunks of equal width, in increasing order, to
+     * whichever thread asks first. A thread that drew cheap chunks simply
+     * comes back sooner, so the work evens out even though testing a number
+     * gets slower towards the end of the interval.
+     *
+     * Claiming a chunk is one atomic increment. The chunks should be wide
+     * enough that this stays negligible, and narrow enough that there are
+     * many more chunks than threads.
+     */
+    class RangeScheduler
+    {
+    public:
+        RangeScheduler(const Interval & inInterval, size_t inChunkSize) :
+            mInterval(inInterval),
+            mChunkSize(inChunkSize),
+            mChunkCount(0),
+            mCursor(0)
+        {
+            if (inChunkSize == 0)
+            {
+                throw std::invalid_argument("Chunk size must be positive");
+            }
+            if (inInterval.first < inInterval.second)
+            {
+                mChunkCount = (inInterval.second - inInterval.first + inChunkSize - 1) / inChunkSize;
+            }
+        }
+
+        size_t chunkCount() const
+        {
+            return mChunkCount;
+        }
+
+        //! The interval of chunk number inIndex.
+        Interval chunk(size_t inIndex) const
+        {
+            size_t begin = mInterval.first + inIndex * mChunkSize;
+            return std::make_pair(begin, std::min(begin + mChunkSize, mInterval.second));
+        }
+
+        //! Claims the next chunk. Returns false when all chunks are taken.
+        bool next(size_t & outIndex)
+        {
+            outIndex = mCursor.fetch_add(1, std::memory_order_relaxed);
+            return outIndex < mChunkCount;
+        }
+
+    private:
+        RangeScheduler(const RangeScheduler&);
+        RangeScheduler& operator=(const RangeScheduler&);
+
+        Interval mInterval;
+        size_t mChunkSize;
+        size_t mChunkCount;
+        std::atomic<size_t> mCursor;
+    };
+
+} // namespace Primes
+
+
+#endif // RANGESCHEDULER_H_INCLUDED
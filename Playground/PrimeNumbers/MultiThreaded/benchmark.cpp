@@ -0,0 +1,130 @@
+#include "Benchmark.h"
+#include "Primes.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Thread scaling of the parallel prime search: the static partition against
+// the chunk scheduler, for 1, 2, 4, ... threads. One operation is one number
+// of the interval [2, limit).
+//
+//   benchmark [limit]      (default 10000000)
+//
+// Every run is checked against the single threaded result.
+
+
+using namespace Primes;
+
+
+static const size_t cChunkSizes[] = { 4 * 1024, cDefaultChunkSize, 1024 * 1024 };
+
+
+// Speedup over the same variant with one thread, one row per variant.
+void PrintScaling(std::ostream & os, const Bench::Runner & runner, const std::vector<unsigned> & inThreadCounts)
+{
+    std::vector<std::string> variants;
+    std::map<std::string, double> ns;
+    for (const Bench::Result & result : runner.results())
+    {
+        std::string variant = result.name.substr(0, result.name.rfind("/threads:"));
+        if (std::find(variants.begin(), variants.end(), variant) == variants.end())
+        {
+            variants.push_back(variant);
+        }
+        ns[result.name] = result.median;
+    }
+
+    os << std::endl << "speedup over 1 thread (median)" << std::endl << std::left << std::setw(24) << "variant" << std::right;
+    for (unsigned threads : inThreadCounts)
+    {
+        os << std::setw(12) << ("threads:" + std::to_string(threads));
+    }
+    os << std::endl;
+
+    for (const std::string & variant : variants)
+    {
+        os << std::left << std::setw(24) << variant << std::right << std::fixed << std::setprecision(2);
+        auto base = ns.find(variant + "/threads:1");
+        for (unsigned threads : inThreadCounts)
+        {
+            auto it = ns.find(variant + "/threads:" + std::to_string(threads));
+            if (it != ns.end() && base != ns.end() && it->second > 0)
+            {
+                os << std::setw(12) << base->second / it->second;
+            }
+            else
+            {
+                os << std::setw(12) << "-";
+            }
+        }
+        os << std::endl;
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 3;
+    Bench::Runner runner(argc, argv, defaults);
+
+    size_t limit = 10 * 1000 * 1000;
+    if (!runner.options().arguments.empty())
+    {
+        limit = std::strtoul(runner.options().arguments[0].c_str(), 0, 10);
+        if (limit < 2 || limit > 0xFFFFFFFFul)
+        {
+            throw std::invalid_argument("Limit must be in [2, 2^32): " + runner.options().arguments[0]);
+        }
+    }
+
+    std::vector<UInt32> preceding;
+    GetPrimes(FastSqrt(static_cast<UInt32>(limit - 1)) + 1, preceding);
+    std::vector<UInt32> expected;
+    GetPrimes(limit, expected);
+
+    const Interval interval = std::make_pair(size_t(2), limit);
+    auto check = [&](const std::string & inName, const std::vector<UInt32> & inPrimes)
+    {
+        if (inPrimes != expected)
+        {
+            throw std::runtime_error(inName + ": found " + std::to_string(inPrimes.size()) + " primes, expected " + std::to_string(expected.size()));
+        }
+    };
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads <= std::max(4u, std::thread::hardware_concurrency()); threads *= 2)
+    {
+        thread_counts.push_back(threads);
+        const std::string suffix = "/threads:" + std::to_string(threads);
+
+        std::string name = "static" + suffix;
+        runner.run_batch(name, limit - 2, [&]
+        {
+            std::vector<UInt32> primes;
+            FindPrimesInInterval_StaticPartition(threads, interval, preceding, primes);
+            check(name, primes);
+        });
+
+        for (size_t chunk_size : cChunkSizes)
+        {
+            name = "dynamic:" + std::to_string(chunk_size / 1024) + "K" + suffix;
+            runner.run_batch(name, limit - 2, [&]
+            {
+                std::vector<UInt32> primes;
+                FindPrimesInInterval_MultiThreaded(threads, interval, preceding, primes, chunk_size);
+                check(name, primes);
+            });
+        }
+    }
+
+    bool text = runner.options().format == Bench::Options::cText || !runner.options().out.empty();
+    PrintScaling(text ? std::cout : std::cerr, runner, thread_counts);
+}
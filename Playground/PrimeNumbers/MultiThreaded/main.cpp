@@ -1,27 +1,33 @@
 #include "Primes.h"
-#include "Poco/Stopwatch.h"
-#include "Poco/Thread.h"
-#include <ctime>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 
 using namespace Primes;
 
 
+static long long ElapsedMs(std::chrono::steady_clock::time_point inStart)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - inStart).count();
+}
+
+
 void SelfTest()
 {
     std::vector<UInt32> primes;
     GetPrimes(100, primes);
-    if (primes.size() != 25 && primes.back() != 97)
+    if (primes.size() != 25 || primes.back() != 97)
     {
         throw std::runtime_error("SelfTest failed for GetPrimes.");
     }
 
     std::vector<UInt32> newPrimes;
     FindPrimesInInterval(std::make_pair(100, 200), primes, newPrimes);
-    if (newPrimes.size() != 21 && newPrimes.back() != 199)
+    if (newPrimes.size() != 21 || newPrimes.back() != 199)
     {
         throw std::runtime_error("SelfTest failed for FindPrimesInInterval.");
     }
@@ -30,27 +36,25 @@ void SelfTest()
 
 void TestMultiThreaded(UInt32 inNumberOfPrimes)
 {
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     std::vector<UInt32> primes1;
     GetPrimes(10000, primes1);
-    const size_t cNumberOfThreads = 4;
+    const size_t cNumberOfThreads = std::max(4u, std::thread::hardware_concurrency());
     std::vector<UInt32> primes2;
     FindPrimesInInterval_MultiThreaded(cNumberOfThreads,
                                        std::make_pair(10001, inNumberOfPrimes),
                                        primes1,
                                        primes2);
-    std::cout << "Multi-threaded (3 threads): " << (stopwatch.elapsed() / 1000) << "ms." << std::endl;
+    std::cout << "Multi-threaded (" << cNumberOfThreads << " threads): " << ElapsedMs(start) << "ms." << std::endl;
 }
 
 
 void TestSingleThreaded(UInt32 inNumberOfPrimes)
 {
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     std::vector<UInt32> primes;
     GetPrimes(inNumberOfPrimes, primes);
-    std::cout << "Single threaded: " << (stopwatch.elapsed() / 1000) << "ms." << std::endl;
+    std::cout << "Single threaded: " << ElapsedMs(start) << "ms." << std::endl;
 }
 
 
@@ -62,8 +66,5 @@ int main()
     TestSingleThreaded(cNumberOfPrimes);    
     TestMultiThreaded(cNumberOfPrimes);
 
-    std::cout << "Ok. Press any character + ENTER to quit." << std::endl;
-    char c;
-    std::cin >> c;
     return 0;
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "Primes.h"
-#include "Poco/Runnable.h"
-#include "Poco/Thread.h"
+#include "Sieve.h"
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <stdexcept>
+#include <thread>
 
 
 namespace Primes
@@ -55,6 +56,17 @@ namespace Primes
             throw std::invalid_argument("outPrimes must be empty");
         }
 
+        Sieve(n).get(0, n, outPrimes);
+    }
+
+
+    void GetPrimes_TrialDivision(size_t n, std::vector<UInt32> & outPrimes)
+    {
+        if (!outPrimes.empty())
+        {
+            throw std::invalid_argument("outPrimes must be empty");
+        }
+
         if (n < 1)
         {
             return;
@@ -73,8 +85,19 @@ namespace Primes
 
 
     void FindPrimesInInterval(const Interval & inInterval,
-                              const std::vector<UInt32> & inPrecedingPrimes,
+                              const std::vector<UInt32> & /*inPrecedingPrimes*/,
                               std::vector<UInt32> & outPrimes)
+    {
+        if (inInterval.first < inInterval.second)
+        {
+            Sieve(inInterval.second).get(inInterval.first, inInterval.second, outPrimes);
+        }
+    }
+
+
+    void FindPrimesInInterval_TrialDivision(const Interval & inInterval,
+                                            const std::vector<UInt32> & inPrecedingPrimes,
+                                            std::vector<UInt32> & outPrimes)
     {
         size_t begin = inInterval.first;
         if (begin % 2 == 0)
@@ -113,7 +136,7 @@ namespace Primes
             if (idx < inNumberOfParts - 1)
             {
                 outIntervals.push_back(std::make_pair(beginValue, beginValue + partSize));
-                beginValue += partSize + 1;
+                beginValue += partSize;
             }
             else
             {
@@ -133,19 +156,19 @@ namespace Primes
         //}
     }
 
-    class Runner : public Poco::Runnable
+    class Runner
     {
     public:
         Runner(const Interval & inInterval,
-               const std::vector<UInt32> & inPrecedingPrimes) :
+               const Sieve & inSieve) :
             mInterval(inInterval),
-            mPrecedingPrimes(inPrecedingPrimes)
+            mSieve(inSieve)
         {
         }
 
-        virtual void run()
+        void run()
         {
-            FindPrimesInInterval(mInterval, mPrecedingPrimes, mFoundPrimes);
+            mSieve.get(mInterval.first, mInterval.second, mFoundPrimes);
         }
 
         const std::vector<UInt32> & foundPrimes() const
@@ -155,26 +178,28 @@ namespace Primes
 
     private:
         Interval mInterval;
-        std::vector<UInt32> mPrecedingPrimes;
+        const Sieve & mSieve;
         std::vector<UInt32> mFoundPrimes;
     };
     
     void FindPrimesInInterval_MultiThreaded(size_t inNumberOfThreads,
                                             const Interval & inInterval,
-                                            const std::vector<UInt32> & inPrecedingPrimes,
+                                            const std::vector<UInt32> & /*inPrecedingPrimes*/,
                                             std::vector<UInt32> & outPrimes)
     {
         std::vector<Interval> intervals;
         Partition(inNumberOfThreads, inInterval, intervals);
 
-        std::vector<Poco::Thread *> mThreads;
-        std::vector<Runner*> runners;
+        // The threads share the sieving primes.
+        const Sieve sieve(inInterval.second);
+
+        std::vector<std::thread> mThreads;
+        std::vector<std::unique_ptr<Runner>> runners;
         for (size_t idx = 0; idx < intervals.size(); ++idx)
         {            
             const Interval & interval = intervals[idx];
-            mThreads.push_back(new Poco::Thread);
-            runners.push_back(new Runner(interval, inPrecedingPrimes));
-            mThreads.back()->start(*runners[idx]);
+            runners.emplace_back(new Runner(interval, sieve));
+            mThreads.push_back(std::thread(&Runner::run, runners[idx].get()));
         }
 
         std::cout << "There are " << mThreads.size() << " threads running now." << std::endl;
@@ -182,11 +207,9 @@ namespace Primes
 
         for (size_t idx = 0; idx != mThreads.size(); ++idx)
         {
-            mThreads[idx]->join();
+            mThreads[idx].join();
             const std::vector<UInt32> & primes = runners[idx]->foundPrimes();
             outPrimes.insert(outPrimes.end(), primes.begin(), primes.end());
-            delete runners[idx];
-            delete mThreads[idx];            
         }
     }
 
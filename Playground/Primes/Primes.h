@@ -1,15 +1,25 @@
 #ifndef PRIMES_H_INCLUDED
 #define PRIMES_H_INCLUDED
 
-#include "Poco/Foundation.h"
+#include <cstddef>
+#include <utility>
 #include <vector>
 typedef unsigned int UInt32;
 
 namespace Primes
 {
 
+    /**
+     * Finds the prime numbers below n with a segmented sieve (see Sieve.h).
+     */
     void GetPrimes(size_t n, std::vector<UInt32> & outPrimes);
 
+    /**
+     * The original implementation: trial division of every odd number by the
+     * primes found so far. Kept as the reference for the benchmark.
+     */
+    void GetPrimes_TrialDivision(size_t n, std::vector<UInt32> & outPrimes);
+
     bool IsPrime(UInt32 inNumber, const std::vector<UInt32> & inPrecedingPrimes);
 
     UInt32 FastSqrt(UInt32 n);
@@ -18,13 +28,17 @@ namespace Primes
 
     /**
      * Finds for prime number in the interval [begin, end[
-     * The preceding primes argument is assumed to contain all
-     * prime numbers from 2 up until at least the square root
-     * of 'end'.
+     * The sieve finds its own sieving primes; the preceding primes argument
+     * is only used by the trial division version, which assumes it contains
+     * all prime numbers from 2 up until at least the square root of 'end'.
      */
     void FindPrimesInInterval(const Interval & inInterval,
                               const std::vector<UInt32> & inPrecedingPrimes,
                               std::vector<UInt32> & outPrimes);
+
+    void FindPrimesInInterval_TrialDivision(const Interval & inInterval,
+                                            const std::vector<UInt32> & inPrecedingPrimes,
+                                            std::vector<UInt32> & outPrimes);
     
     void FindPrimesInInterval_MultiThreaded(size_t inNumberOfThreads,
                                             const Interval & inInterval,
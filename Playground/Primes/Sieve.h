@@ -0,0 +1,229 @@
+#ifndef SIEVE_H_INCLUDED
+#define SIEVE_H_INCLUDED
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <stdint.h>
+
+
+namespace Primes
+{
+
+    /**
+     * Segmented sieve of Eratosthenes.
+     *
+     * - Only odd numbers are stored, one bit each: bit i of a segment that
+     *   starts at 'low' stands for low + 2i + 1.
+     * - A segment is 32 KB, so crossing off stays inside the L1 cache. Every
+     *   sieving prime remembers its next multiple from one segment to the next.
+     * - Wheel: the multiples of 3, 5, 7, 11 and 13 are not crossed off but
+     *   copied in from a pattern that repeats every 3*5*7*11*13 bytes.
+     *
+     * The object only holds the sieving primes up to sqrt(limit) and is not
+     * modified by for_each() and count(), so several threads can share one.
+     * Memory use is about sqrt(limit) / 2 bytes while constructing, and
+     * 4 bytes per sieving prime after that.
+     *
+     * The bit layout assumes a little-endian CPU.
+     */
+    class Sieve
+    {
+    public:
+        //! Prepares sieving of numbers below inLimit.
+        explicit Sieve(uint64_t inLimit) :
+            mLimit(inLimit)
+        {
+            uint64_t root = static_cast<uint64_t>(std::sqrt(static_cast<double>(inLimit)));
+            while (root * root > inLimit) --root;
+            while ((root + 1) * (root + 1) <= inLimit) ++root;
+
+            // Simple sieve of the odd numbers up to the square root.
+            std::vector<char> composite(root / 2 + 1, 0);
+            for (uint64_t p = 3; p * p <= root; p += 2)
+            {
+                if (!composite[p / 2])
+                {
+                    for (uint64_t m = p * p; m <= root; m += 2 * p)
+                    {
+                        composite[m / 2] = 1;
+                    }
+                }
+            }
+            for (uint64_t p = cFirstSievingPrime; p <= root; p += 2)
+            {
+                if (!composite[p / 2])
+                {
+                    mSievingPrimes.push_back(static_cast<uint32_t>(p));
+                }
+            }
+        }
+
+        uint64_t limit() const { return mLimit; }
+
+        //! Calls f(p) for every prime p in [inBegin, inEnd), in increasing order.
+        template<typename F>
+        void for_each(uint64_t inBegin, uint64_t inEnd, F f) const
+        {
+            if (inBegin <= 2 && 2 < inEnd)
+            {
+                f(uint64_t(2));
+            }
+            for_each_segment(inBegin, inEnd, [&](uint64_t inLow, const uint64_t * inWords, uint64_t inFirstBit, uint64_t inEndBit)
+            {
+                for (uint64_t w = inFirstBit / 64; w * 64 < inEndBit; ++w)
+                {
+                    uint64_t bits = inWords[w] & Mask(w, inFirstBit, inEndBit);
+                    while (bits)
+                    {
+                        f(inLow + 2 * (w * 64 + __builtin_ctzll(bits)) + 1);
+                        bits &= bits - 1;
+                    }
+                }
+            });
+        }
+
+        //! Number of primes in [inBegin, inEnd).
+        uint64_t count(uint64_t inBegin, uint64_t inEnd) const
+        {
+            uint64_t result = inBegin <= 2 && 2 < inEnd ? 1 : 0;
+            for_each_segment(inBegin, inEnd, [&](uint64_t, const uint64_t * inWords, uint64_t inFirstBit, uint64_t inEndBit)
+            {
+                for (uint64_t w = inFirstBit / 64; w * 64 < inEndBit; ++w)
+                {
+                    result += __builtin_popcountll(inWords[w] & Mask(w, inFirstBit, inEndBit));
+                }
+            });
+            return result;
+        }
+
+        //! Appends the primes in [inBegin, inEnd) to ioPrimes.
+        template<typename T>
+        void get(uint64_t inBegin, uint64_t inEnd, std::vector<T> & ioPrimes) const
+        {
+            for_each(inBegin, inEnd, [&](uint64_t p) { ioPrimes.push_back(static_cast<T>(p)); });
+        }
+
+    private:
+        enum
+        {
+            cSegmentBytes = 32 * 1024,
+            cSegmentWords = cSegmentBytes / 8,
+            cSegmentBits = cSegmentBytes * 8,
+            cSegmentSpan = cSegmentBits * 2,    // numbers per segment
+            cWheelBytes = 3 * 5 * 7 * 11 * 13,  // period of the pattern in bytes
+            cFirstSievingPrime = 17
+        };
+
+        // Bits [inFirstBit, inEndBit) of word inWord.
+        static uint64_t Mask(uint64_t inWord, uint64_t inFirstBit, uint64_t inEndBit)
+        {
+            uint64_t mask = ~uint64_t(0);
+            if (inFirstBit > inWord * 64)
+            {
+                mask &= ~uint64_t(0) << (inFirstBit - inWord * 64);
+            }
+            if (inEndBit < (inWord + 1) * 64)
+            {
+                mask &= ~(~uint64_t(0) << (inEndBit - inWord * 64));
+            }
+            return mask;
+        }
+
+        // Odd numbers from 1 on, with the multiples of the wheel primes
+        // cleared, long enough to copy a whole segment from any phase.
+        static const std::vector<uint8_t> & WheelPattern()
+        {
+            static const std::vector<uint8_t> fPattern = []
+            {
+                std::vector<uint8_t> pattern(cWheelBytes + cSegmentBytes, 0xFF);
+                const unsigned wheel[] = { 3, 5, 7, 11, 13 };
+                for (unsigned p : wheel)
+                {
+                    // Bit i stands for 2i + 1; odd multiples of p are p bits apart.
+                    for (uint64_t i = p / 2; i < pattern.size() * 8; i += p)
+                    {
+                        pattern[i / 8] &= static_cast<uint8_t>(~(1u << (i % 8)));
+                    }
+                }
+                return pattern;
+            }();
+            return fPattern;
+        }
+
+        // Sieves the segments that overlap [inBegin, inEnd) and calls
+        // f(low, words, firstBit, endBit) with the bits of each that are in range.
+        template<typename F>
+        void for_each_segment(uint64_t inBegin, uint64_t inEnd, F f) const
+        {
+            if (inEnd > mLimit)
+            {
+                throw std::invalid_argument("Sieve: range exceeds the limit");
+            }
+            if (inBegin >= inEnd)
+            {
+                return;
+            }
+
+            const std::vector<uint8_t> & pattern = WheelPattern();
+            uint64_t low = inBegin / cSegmentSpan * cSegmentSpan;
+            std::vector<uint64_t> words(std::min<uint64_t>(cSegmentWords, (inEnd - low + 127) / 128));
+            uint8_t * bytes = reinterpret_cast<uint8_t*>(words.data());
+
+            // Next odd multiple of every sieving prime, for the current segment.
+            std::vector<uint64_t> next(mSievingPrimes.size());
+            for (std::size_t i = 0; i != mSievingPrimes.size(); ++i)
+            {
+                uint64_t p = mSievingPrimes[i];
+                uint64_t m = std::max(p * p, (low + p - 1) / p * p);
+                next[i] = m % 2 ? m : m + p;
+            }
+
+            for (; low < inEnd; low += cSegmentSpan)
+            {
+                // The last segment is only sieved up to the word that holds inEnd.
+                const uint64_t segment_bits = std::min<uint64_t>(cSegmentBits, (inEnd - low + 127) / 128 * 64);
+                const uint64_t high = low + 2 * segment_bits;
+
+                std::memcpy(bytes, &pattern[(low / 16) % cWheelBytes], segment_bits / 8);
+                if (low == 0)
+                {
+                    bytes[0] &= ~1u;        // 1 is not prime
+                    bytes[0] |= 0x6E;       // 3, 5, 7, 11 and 13 are: bits 1, 2, 3, 5, 6
+                }
+
+                for (std::size_t i = 0; i != mSievingPrimes.size(); ++i)
+                {
+                    const uint64_t p = mSievingPrimes[i];
+                    if (p * p >= high)
+                    {
+                        break;
+                    }
+                    uint64_t bit = (next[i] - low) / 2;
+                    for (; bit < segment_bits; bit += p)
+                    {
+                        bytes[bit / 8] &= static_cast<uint8_t>(~(1u << (bit % 8)));
+                    }
+                    next[i] = low + 2 * bit + 1;
+                }
+
+                uint64_t first_bit = inBegin > low ? (inBegin - low) / 2 : 0;
+                uint64_t end_bit = std::min(segment_bits, (std::min(inEnd, high) - low) / 2);
+                if (first_bit < end_bit)
+                {
+                    f(low, words.data(), first_bit, end_bit);
+                }
+            }
+        }
+
+        uint64_t mLimit;
+        std::vector<uint32_t> mSievingPrimes; // from 17 up to sqrt(limit)
+    };
+
+} // namespace Primes
+
+
+#endif // SIEVE_H_INCLUDED
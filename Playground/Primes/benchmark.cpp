@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include "Primes.h"
+#include "Sieve.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Trial division against the segmented sieve, for the numbers below 10^N.
+// One operation is one number of the range, so the columns are comparable
+// across sizes.
+//
+//   benchmark [max-sieve-exponent [max-trial-division-exponent]]
+//
+// The defaults are 10 and 7: trial division of 10^8 numbers takes a minute,
+// the sieve does 10^10 in about the same time. Every run checks the number of
+// primes it found against pi(10^N).
+
+
+using namespace Primes;
+
+
+static const uint64_t cPi[] = // pi(10^N)
+{
+    0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534,
+    455052511, 4118054813ull, 37607912018ull
+};
+
+
+static const unsigned cMaxExponent = sizeof(cPi) / sizeof(cPi[0]) - 1;
+
+
+static void Check(const std::string & inName, uint64_t inFound, unsigned inExponent)
+{
+    if (inFound != cPi[inExponent])
+    {
+        throw std::runtime_error(inName + ": found " + std::to_string(inFound) + " primes, expected " + std::to_string(cPi[inExponent]));
+    }
+}
+
+
+static unsigned Exponent(const std::vector<std::string> & inArguments, std::size_t inIndex, unsigned inDefault)
+{
+    if (inArguments.size() <= inIndex)
+    {
+        return inDefault;
+    }
+    int exponent = std::atoi(inArguments[inIndex].c_str());
+    if (exponent < 1 || exponent > int(cMaxExponent))
+    {
+        throw std::invalid_argument("Exponent must be in [1, " + std::to_string(cMaxExponent) + "]: " + inArguments[inIndex]);
+    }
+    return exponent;
+}
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 3;
+    defaults.warmup = 0;
+    Bench::Runner runner(argc, argv, defaults);
+
+    const unsigned max_sieve = Exponent(runner.options().arguments, 0, 10);
+    const unsigned max_trial = Exponent(runner.options().arguments, 1, 7);
+
+    uint64_t limit = 1;
+    for (unsigned exponent = 1; exponent <= max_sieve; ++exponent)
+    {
+        limit *= 10;
+        const std::string suffix = "/10^" + std::to_string(exponent);
+
+        if (exponent <= max_trial)
+        {
+            const std::string name = "GetPrimes_TrialDivision" + suffix;
+            runner.run_batch(name, limit, [&]
+            {
+                std::vector<UInt32> primes;
+                GetPrimes_TrialDivision(limit, primes);
+                Check(name, primes.size(), exponent);
+            });
+        }
+
+        // Primes from 2^32 on don't fit the UInt32 interface.
+        if (limit <= 0xFFFFFFFFull)
+        {
+            const std::string name = "GetPrimes" + suffix;
+            runner.run_batch(name, limit, [&]
+            {
+                std::vector<UInt32> primes;
+                GetPrimes(limit, primes);
+                Check(name, primes.size(), exponent);
+            });
+        }
+
+        const std::string name = "Sieve::count" + suffix;
+        runner.run_batch(name, limit, [&]
+        {
+            Check(name, Sieve(limit).count(0, limit), exponent);
+        });
+    }
+}
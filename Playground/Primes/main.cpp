@@ -1,7 +1,5 @@
 #include "Primes.h"
-#include "Poco/Stopwatch.h"
-#include "Poco/Thread.h"
-#include <ctime>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
@@ -10,18 +8,24 @@
 using namespace Primes;
 
 
+static long long ElapsedMs(std::chrono::steady_clock::time_point inStart)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - inStart).count();
+}
+
+
 void SelfTest()
 {
     std::vector<UInt32> primes;
     GetPrimes(100, primes);
-    if (primes.size() != 25 && primes.back() != 97)
+    if (primes.size() != 25 || primes.back() != 97)
     {
         throw std::runtime_error("SelfTest failed for GetPrimes.");
     }
 
     std::vector<UInt32> newPrimes;
     FindPrimesInInterval(std::make_pair(100, 200), primes, newPrimes);
-    if (newPrimes.size() != 21 && newPrimes.back() != 199)
+    if (newPrimes.size() != 21 || newPrimes.back() != 199)
     {
         throw std::runtime_error("SelfTest failed for FindPrimesInInterval.");
     }
@@ -30,8 +34,7 @@ void SelfTest()
 
 void TestMultiThreaded(UInt32 inNumberOfPrimes, int inNumberOfThreads)
 {
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     std::vector<UInt32> primes1;
     GetPrimes(10000, primes1);
     std::vector<UInt32> primes2;
@@ -39,18 +42,17 @@ void TestMultiThreaded(UInt32 inNumberOfPrimes, int inNumberOfThreads)
                                        std::make_pair(10001, inNumberOfPrimes),
                                        primes1,
                                        primes2);
-    std::cout << "Multi-threaded (" << inNumberOfThreads << " threads): " << (stopwatch.elapsed() / 1000) << "ms." << std::endl;
+    std::cout << "Multi-threaded (" << inNumberOfThreads << " threads): " << ElapsedMs(start) << "ms." << std::endl;
 }
 
 
 void TestSingleThreaded(UInt32 inNumberOfPrimes)
 {
     std::cout << "Now calculating the first " << inNumberOfPrimes << " prime numbers single threaded." << std::endl;
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     std::vector<UInt32> primes;
     GetPrimes(inNumberOfPrimes, primes);
-    std::cout << "Single threaded: " << (stopwatch.elapsed() / 1000) << "ms." << std::endl;
+    std::cout << "Single threaded: " << ElapsedMs(start) << "ms." << std::endl;
 }
 
 
@@ -65,7 +67,6 @@ int main()
         TestMultiThreaded(cNumberOfPrimes, i + 1);    
     }
 
-    std::cout << "Press ENTER to quit.";
-    std::cin.get();
+    TestSingleThreaded(cNumberOfPrimes);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,398 @@
+#ifndef INTRUSIVEPTR_H_INCLUDED
+#define INTRUSIVEPTR_H_INCLUDED
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Intrusive smart pointer whose reference counting is a policy.
+ *
+ * Objects derive from Refcounted<Policy> and start without references; the
+ * first IntrusivePtr adopts them:
+ *
+ *     class Packet : public Refcounted<Refcount::Atomic> { ... };
+ *     IntrusivePtr<Packet, Refcount::Atomic> packet(new Packet);
+ *
+ * A policy provides the counter type and two operations:
+ *
+ *     typedef ... Counter;
+ *     template<typename T> static void AddRef(Counter &);
+ *     template<typename T> static void Release(Counter &, T * object); // deletes the object after the last release
+ */
+namespace Refcount {
+
+
+//! Plain counter. Only for objects that never leave their thread.
+struct SingleThreaded
+{
+    typedef std::size_t Counter;
+
+    template<typename T>
+    static void AddRef(Counter & ioCounter)
+    {
+        ++ioCounter;
+    }
+
+    template<typename T>
+    static void Release(Counter & ioCounter, T * inObject)
+    {
+        if (--ioCounter == 0)
+        {
+            delete inObject;
+        }
+    }
+};
+
+
+/**
+ * Atomic counter. Increments can be relaxed: a thread can only add a
+ * reference if it already has one. The last release must see every write
+ * that other threads made to the object before they released it, hence the
+ * release decrement followed by an acquire fence on the last one.
+ */
+struct Atomic
+{
+    typedef std::atomic<std::size_t> Counter;
+
+    template<typename T>
+    static void AddRef(Counter & ioCounter)
+    {
+        ioCounter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template<typename T>
+    static void Release(Counter & ioCounter, T * inObject)
+    {
+        if (ioCounter.fetch_sub(1, std::memory_order_release) == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            delete inObject;
+        }
+    }
+};
+
+
+/**
+ * Biased reference counting (Choi, Shull, Torrellas, PACT 2018).
+ *
+ * Most objects are only ever touched by the thread that created them. That
+ * thread, the owner, counts with plain loads and stores on a biased counter;
+ * all other threads count atomically on a shared counter. The object is
+ * dead when the sum of both is zero.
+ *
+ * The two counters are merged into the shared one
+ *  - when the owner drops its last biased reference, or
+ *  - when the shared counter becomes negative, which happens when another
+ *    thread releases a reference that the owner handed to it. Such an object
+ *    is queued to its owner, which merges it in Collect().
+ *
+ * After the merge, every thread uses the shared counter. The first
+ * IntrusivePtr to an object must be made by the thread that created it.
+ *
+ * Freeing an object of the second kind is deferred until the owner calls
+ * Collect() or exits. Long-lived threads that hand objects to other threads
+ * should call Collect() periodically, e.g. once per event loop iteration.
+ */
+class Biased
+{
+    struct Queue;
+
+public:
+    class Counter
+    {
+    public:
+        Counter() : mOwner(LocalQueue()), mBiased(0), mShared(0) {}
+
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+    private:
+        friend class Biased;
+
+        std::atomic<Queue*> mOwner;         // null after the merge
+        std::atomic<std::size_t> mBiased;   // only written by the owner
+        std::atomic<std::intptr_t> mShared; // count * 4 | cMerged | cQueued
+    };
+
+    template<typename T>
+    static void AddRef(Counter & ioCounter)
+    {
+        if (ioCounter.mOwner.load(std::memory_order_relaxed) == LocalQueue())
+        {
+            ioCounter.mBiased.store(ioCounter.mBiased.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            ioCounter.mShared.fetch_add(cOne, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename T>
+    static void Release(Counter & ioCounter, T * inObject)
+    {
+        Queue * owner = ioCounter.mOwner.load(std::memory_order_relaxed);
+        if (owner == LocalQueue())
+        {
+            std::size_t biased = ioCounter.mBiased.load(std::memory_order_relaxed) - 1;
+            ioCounter.mBiased.store(biased, std::memory_order_relaxed);
+            if (biased == 0)
+            {
+                std::intptr_t shared = ioCounter.mShared.fetch_or(cMerged, std::memory_order_acq_rel);
+                ioCounter.mOwner.store(nullptr, std::memory_order_relaxed);
+                if (Count(shared) == 0 && !(shared & cQueued))
+                {
+                    delete inObject;
+                }
+            }
+            return;
+        }
+
+        std::intptr_t shared = ioCounter.mShared.fetch_sub(cOne, std::memory_order_acq_rel) - cOne;
+        for (;;)
+        {
+            if (shared & cMerged)
+            {
+                // A queued object is freed by the queue.
+                if (Count(shared) == 0 && !(shared & cQueued))
+                {
+                    delete inObject;
+                }
+                return;
+            }
+            if (Count(shared) >= 0 || (shared & cQueued))
+            {
+                return;
+            }
+            if (ioCounter.mShared.compare_exchange_weak(shared, shared | cQueued, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                // The owner can't have merged: its biased count still holds
+                // the reference that was just released here.
+                Entry entry = { &ioCounter, inObject, &Delete<T> };
+                Enqueue(*owner, entry);
+                return;
+            }
+        }
+    }
+
+    //! Merges the objects that other threads queued to the calling thread, freeing the dead ones.
+    static void Collect()
+    {
+        Drain(*LocalQueue(), false);
+    }
+
+private:
+    enum : std::intptr_t
+    {
+        cMerged = 1,
+        cQueued = 2,
+        cOne = 4
+    };
+
+    static std::intptr_t Count(std::intptr_t inShared)
+    {
+        return (inShared & ~std::intptr_t(3)) / cOne;
+    }
+
+    struct Entry
+    {
+        Counter * counter;
+        void * object;
+        void (*destroy)(void *);
+    };
+
+    // Queues outlive their threads: other threads may still find them in
+    // the counters of objects that the thread owned. A dead queue is never
+    // filled again; whoever would queue an object merges it right away.
+    struct Queue
+    {
+        Queue() : mDead(false) {}
+
+        std::mutex mMutex;
+        std::vector<Entry> mEntries;
+        bool mDead;
+    };
+
+    struct LocalHolder
+    {
+        LocalHolder() : mQueue(new Queue) {}
+        ~LocalHolder() { Drain(*mQueue, true); }
+
+        Queue * mQueue;
+    };
+
+    static Queue * LocalQueue()
+    {
+        static thread_local LocalHolder fHolder;
+        return fHolder.mQueue;
+    }
+
+    template<typename T>
+    static void Delete(void * inObject)
+    {
+        delete static_cast<T*>(inObject);
+    }
+
+    static void Enqueue(Queue & ioQueue, const Entry & inEntry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ioQueue.mMutex);
+            if (!ioQueue.mDead)
+            {
+                ioQueue.mEntries.push_back(inEntry);
+                return;
+            }
+        }
+        // The owner has exited, so its biased count can no longer change.
+        Merge(inEntry);
+    }
+
+    static void Drain(Queue & ioQueue, bool inExiting)
+    {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock(ioQueue.mMutex);
+            entries.swap(ioQueue.mEntries);
+            ioQueue.mDead = inExiting;
+        }
+        for (const Entry & entry : entries)
+        {
+            Merge(entry);
+        }
+    }
+
+    // Called by the owner, or by any thread once the owner has exited.
+    static void Merge(const Entry & inEntry)
+    {
+        Counter & counter = *inEntry.counter;
+        std::intptr_t shared = counter.mShared.load(std::memory_order_acquire);
+        std::intptr_t biased = 0;
+        if (!(shared & cMerged))
+        {
+            biased = static_cast<std::intptr_t>(counter.mBiased.load(std::memory_order_relaxed)) * cOne | cMerged;
+            counter.mBiased.store(0, std::memory_order_relaxed);
+            counter.mOwner.store(nullptr, std::memory_order_relaxed);
+        }
+
+        std::intptr_t merged;
+        do
+        {
+            merged = (shared + biased) & ~std::intptr_t(cQueued);
+        }
+        while (!counter.mShared.compare_exchange_weak(shared, merged, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        if (Count(merged) == 0)
+        {
+            inEntry.destroy(inEntry.object);
+        }
+    }
+};
+
+
+} // namespace Refcount
+
+
+//! Base class that holds the counter of the policy.
+template<typename RefcountPolicy>
+class Refcounted
+{
+public:
+    typename RefcountPolicy::Counter & refcount() const { return mRefCount; }
+
+protected:
+    Refcounted() : mRefCount() {}
+    ~Refcounted() {}
+
+private:
+    Refcounted(const Refcounted&) = delete;
+    Refcounted& operator=(const Refcounted&) = delete;
+
+    mutable typename RefcountPolicy::Counter mRefCount;
+};
+
+
+template<typename T, typename RefcountPolicy>
+class IntrusivePtr
+{
+public:
+    IntrusivePtr() : mObject(nullptr) {}
+
+    IntrusivePtr(T * inObject) : mObject(inObject)
+    {
+        add_ref();
+    }
+
+    IntrusivePtr(const IntrusivePtr & rhs) : mObject(rhs.mObject)
+    {
+        add_ref();
+    }
+
+    // noexcept, or std::vector would copy on reallocation and pay for the
+    // extra reference counting.
+    IntrusivePtr(IntrusivePtr && rhs) noexcept : mObject(rhs.mObject)
+    {
+        rhs.mObject = nullptr;
+    }
+
+    IntrusivePtr& operator=(const IntrusivePtr & rhs)
+    {
+        IntrusivePtr(rhs).swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr && rhs) noexcept
+    {
+        IntrusivePtr(std::move(rhs)).swap(*this);
+        return *this;
+    }
+
+    ~IntrusivePtr()
+    {
+        if (mObject)
+        {
+            RefcountPolicy::Release(mObject->refcount(), mObject);
+        }
+    }
+
+    void reset()
+    {
+        IntrusivePtr().swap(*this);
+    }
+
+    void swap(IntrusivePtr & rhs) noexcept
+    {
+        std::swap(mObject, rhs.mObject);
+    }
+
+    T * get() const { return mObject; }
+
+    T & operator*() const { return *mObject; }
+
+    T * operator->() const { return mObject; }
+
+    explicit operator bool() const { return mObject != nullptr; }
+
+    friend bool operator==(const IntrusivePtr & lhs, const IntrusivePtr & rhs) { return lhs.mObject == rhs.mObject; }
+    friend bool operator!=(const IntrusivePtr & lhs, const IntrusivePtr & rhs) { return lhs.mObject != rhs.mObject; }
+    friend bool operator<(const IntrusivePtr & lhs, const IntrusivePtr & rhs) { return std::less<T*>()(lhs.mObject, rhs.mObject); }
+
+private:
+    void add_ref()
+    {
+        if (mObject)
+        {
+            RefcountPolicy::template AddRef<T>(mObject->refcount());
+        }
+    }
+
+    T * mObject;
+};
+
+
+#endif // INTRUSIVEPTR_H_INCLUDED
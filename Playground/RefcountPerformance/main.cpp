@@ -1,11 +1,12 @@
-#include "Poco/Stopwatch.h"
+#include "Benchmark.h"
+#include "IntrusivePtr.h"
 #include <boost/intrusive_ptr.hpp>
-#include <boost/lexical_cast.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
-#include <ctime>
+#include <atomic>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -13,7 +14,7 @@
 class RefcountedObject : boost::noncopyable
 {
 public:
-    RefcountedObject() : mRefCount(1) { }
+    RefcountedObject() : mRefCount(0) { }
 
     friend void intrusive_ptr_add_ref(RefcountedObject *);
     friend void intrusive_ptr_release(RefcountedObject *);
@@ -49,11 +50,11 @@ public:
 
 private:
     std::size_t mIdentifier;
-    static std::size_t sInstanceCount;
+    static std::atomic<std::size_t> sInstanceCount;
 };
 
 
-std::size_t MyClass::sInstanceCount = 0;
+std::atomic<std::size_t> MyClass::sInstanceCount(0);
 
 
 class MyClassWithRefcount : public RefcountedObject
@@ -70,90 +71,246 @@ public:
     }
 
     std::size_t mIdentifier;
-    static std::size_t sInstanceCount;
+    static std::atomic<std::size_t> sInstanceCount;
 };
 
 
-std::size_t MyClassWithRefcount::sInstanceCount = 0;
-std::size_t gNumCopies = 0;
+std::atomic<std::size_t> MyClassWithRefcount::sInstanceCount(0);
 
 
-template<class Container>
-time_t TestCopy(const Container & inContainer, std::size_t n)
+template<typename RefcountPolicy>
+class Object : public Refcounted<RefcountPolicy>
+{
+public:
+    Object() { ++sLiveCount; }
+    ~Object() { --sLiveCount; }
+
+    static std::atomic<long> sLiveCount;
+};
+
+
+template<typename RefcountPolicy>
+std::atomic<long> Object<RefcountPolicy>::sLiveCount(0);
+
+
+typedef boost::shared_ptr<MyClass> SharedPtr;
+typedef boost::intrusive_ptr<MyClassWithRefcount> BoostIntrusivePtr;
+typedef IntrusivePtr<Object<Refcount::SingleThreaded>, Refcount::SingleThreaded> SingleThreadedPtr;
+typedef IntrusivePtr<Object<Refcount::Atomic>, Refcount::Atomic> AtomicPtr;
+typedef IntrusivePtr<Object<Refcount::Biased>, Refcount::Biased> BiasedPtr;
+
+
+void Create(SharedPtr & outPointer) { outPointer.reset(new MyClass); }
+void Create(BoostIntrusivePtr & outPointer) { outPointer = new MyClassWithRefcount; }
+
+template<typename T, typename RefcountPolicy>
+void Create(IntrusivePtr<T, RefcountPolicy> & outPointer) { outPointer = new T; }
+
+
+enum
+{
+    cObjectCount = 256,
+    cCopiesPerThread = 1024, // copies of all objects
+    cHandoffsPerThread = 64 * 1024
+};
+
+
+template<typename Pointer>
+std::vector<Pointer> CreateObjects(std::size_t inCount)
 {
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
-    for (std::size_t idx = 0; idx < n; ++idx)
+    std::vector<Pointer> result(inCount);
+    for (Pointer & pointer : result)
     {
-        volatile Container copy = inContainer;
-        gNumCopies += const_cast<const Container&>(copy).size();
+        Create(pointer);
     }
-    return static_cast<time_t>(0.5 + (double(stopwatch.elapsed()) / 1000.0));
+    return result;
 }
 
 
-void TestSet(std::size_t n)
+// One operation is one copy of the container.
+template<class Container>
+void TestCopy(Bench::Runner & runner, const std::string & inName, const Container & inContainer)
 {
-    std::cout << std::endl << "Set" << std::endl;
+    runner.run(inName, [&]
+    {
+        Container copy = inContainer;
+        Bench::DoNotOptimize(copy);
+    });
+}
 
+
+template<typename Pointer>
+void TestVector(Bench::Runner & runner, const std::string & inName)
+{
+    TestCopy(runner, "vector/" + inName, CreateObjects<Pointer>(cObjectCount));
+}
+
+
+template<typename Pointer>
+void TestSet(Bench::Runner & runner, const std::string & inName)
+{
+    std::vector<Pointer> objects = CreateObjects<Pointer>(cObjectCount);
+    TestCopy(runner, "set/" + inName, std::set<Pointer>(objects.begin(), objects.end()));
+}
+
+
+// Every worker is measured in the region of the benchmark.
+template<typename Worker>
+void RunThreads(Bench::Region & region, unsigned inThreadCount, Worker worker)
+{
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t != inThreadCount; ++t)
     {
-        std::set< boost::shared_ptr< MyClass > > theSet;
-        for (std::size_t idx = 0; idx < 256; ++idx)
+        threads.push_back(std::thread([&, t]
         {
-            boost::shared_ptr<MyClass> obj(new MyClass);
-            theSet.insert(obj);
-        }
-        std::cout << "shared_ptr: " << TestCopy(theSet, n) << "ms" << std::endl;
+            Bench::Scope scope(region);
+            worker(t);
+        }));
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
     }
+}
 
+
+template<typename Pointer>
+void CopyRepeatedly(const std::vector<Pointer> & inObjects)
+{
+    for (unsigned i = 0; i != cCopiesPerThread; ++i)
     {
-        std::set< boost::intrusive_ptr< MyClassWithRefcount > > theSet;
-        for (std::size_t idx = 0; idx < 256; ++idx)
-        {
-            theSet.insert(new MyClassWithRefcount);
-        }
-        std::cout << "intrusive_ptr: " << TestCopy(theSet, n) << "ms" << std::endl;
+        std::vector<Pointer> copy(inObjects);
+        Bench::DoNotOptimize(copy.data());
     }
 }
 
 
-void TestVector(std::size_t n)
+// Every thread copies and destroys pointers to objects that it created
+// itself. One operation is one copy and one destruction of a pointer.
+template<typename Pointer>
+void TestLocal(Bench::Runner & runner, const std::string & inName, unsigned inThreadCount)
 {
-    std::cout << std::endl << "Vector" << std::endl;
+    const std::string name = "threads/local/" + inName + "/threads:" + std::to_string(inThreadCount);
+    Bench::Region & region = Bench::Region::Get(name);
+    runner.run_batch(name, uint64_t(inThreadCount) * cCopiesPerThread * cObjectCount, [&]
+    {
+        RunThreads(region, inThreadCount, [](unsigned)
+        {
+            CopyRepeatedly(CreateObjects<Pointer>(cObjectCount));
+        });
+    });
+}
+
+
+// All threads copy and destroy pointers to the same objects, which the main
+// thread created.
+template<typename Pointer>
+void TestShared(Bench::Runner & runner, const std::string & inName, unsigned inThreadCount)
+{
+    std::vector<Pointer> objects = CreateObjects<Pointer>(cObjectCount);
+    const std::string name = "threads/shared/" + inName + "/threads:" + std::to_string(inThreadCount);
+    Bench::Region & region = Bench::Region::Get(name);
+    runner.run_batch(name, uint64_t(inThreadCount) * cCopiesPerThread * cObjectCount, [&]
+    {
+        RunThreads(region, inThreadCount, [&](unsigned)
+        {
+            CopyRepeatedly(objects);
+        });
+    });
+}
+
+
+class Barrier
+{
+public:
+    explicit Barrier(unsigned inCount) : mCount(inCount), mArrived(0) {}
 
+    void wait()
     {
-        std::vector< boost::shared_ptr< MyClass > > theVector;
-        for (std::size_t idx = 0; idx < 256; ++idx)
+        mArrived.fetch_add(1);
+        while (mArrived.load() < mCount)
         {
-            boost::shared_ptr< MyClass > obj(new MyClass);
-            theVector.push_back(obj);
+            std::this_thread::yield();
         }
-        std::cout << "shared_ptr: " << TestCopy(theVector, n) << "ms" << std::endl;
     }
 
+private:
+    unsigned mCount;
+    std::atomic<unsigned> mArrived;
+};
+
+
+// Every thread creates objects, then releases the objects that its neighbour
+// created. One operation is one object.
+template<typename Pointer>
+void TestHandoff(Bench::Runner & runner, const std::string & inName, unsigned inThreadCount)
+{
+    const std::string name = "threads/handoff/" + inName + "/threads:" + std::to_string(inThreadCount);
+    Bench::Region & region = Bench::Region::Get(name);
+    runner.run_batch(name, uint64_t(inThreadCount) * cHandoffsPerThread, [&]
     {
-        std::vector< boost::intrusive_ptr< MyClassWithRefcount > > theVector;
-        for (std::size_t idx = 0; idx < 256; ++idx)
+        std::vector<std::vector<Pointer>> slots(inThreadCount);
+        Barrier created(inThreadCount);
+        RunThreads(region, inThreadCount, [&](unsigned t)
         {
-            theVector.push_back(new MyClassWithRefcount);
-        }
-        std::cout << "intrusive_ptr: " << TestCopy(theVector, n) << "ms" << std::endl;
+            slots[t] = CreateObjects<Pointer>(cHandoffsPerThread);
+            created.wait();
+            slots[(t + 1) % inThreadCount].clear();
+        });
+    });
+}
+
+
+template<typename Pointer>
+void TestThreads(Bench::Runner & runner, const std::string & inName, unsigned inThreadCount)
+{
+    TestLocal<Pointer>(runner, inName, inThreadCount);
+    TestShared<Pointer>(runner, inName, inThreadCount);
+    TestHandoff<Pointer>(runner, inName, inThreadCount);
+}
+
+
+template<typename RefcountPolicy>
+bool CheckLeaks(const char * inName)
+{
+    // Objects that other threads released are freed when the owner collects.
+    Refcount::Biased::Collect();
+    long live = Object<RefcountPolicy>::sLiveCount.load();
+    if (live != 0)
+    {
+        std::cerr << inName << ": " << live << " objects were not freed." << std::endl;
     }
+    return live == 0;
 }
 
 
 int main(int argc, char ** argv)
 {
-    std::size_t n = 10000;
-    if (argc == 2)
+    Bench::Runner runner(argc, argv);
+
+    TestVector<SharedPtr>(runner, "shared_ptr");
+    TestVector<BoostIntrusivePtr>(runner, "intrusive_ptr");
+    TestVector<SingleThreadedPtr>(runner, "IntrusivePtr:single");
+    TestVector<AtomicPtr>(runner, "IntrusivePtr:atomic");
+    TestVector<BiasedPtr>(runner, "IntrusivePtr:biased");
+
+    TestSet<SharedPtr>(runner, "shared_ptr");
+    TestSet<BoostIntrusivePtr>(runner, "intrusive_ptr");
+    TestSet<SingleThreadedPtr>(runner, "IntrusivePtr:single");
+    TestSet<AtomicPtr>(runner, "IntrusivePtr:atomic");
+    TestSet<BiasedPtr>(runner, "IntrusivePtr:biased");
+
+    // The single-threaded counters are only safe when objects stay in their thread.
+    for (unsigned threads = 1; threads <= std::max(4u, std::thread::hardware_concurrency()); threads *= 2)
     {
-        n = boost::lexical_cast< std::size_t >(argv[1]);
+        TestLocal<SingleThreadedPtr>(runner, "IntrusivePtr:single", threads);
+        TestThreads<SharedPtr>(runner, "shared_ptr", threads);
+        TestThreads<AtomicPtr>(runner, "IntrusivePtr:atomic", threads);
+        TestThreads<BiasedPtr>(runner, "IntrusivePtr:biased", threads);
     }
 
-    TestVector(n);
-    TestSet(n);
-
-    std::cout << "Total number of copies: " << gNumCopies << std::endl;
-    return 0;
+    bool ok = CheckLeaks<Refcount::SingleThreaded>("IntrusivePtr:single");
+    ok = CheckLeaks<Refcount::Atomic>("IntrusivePtr:atomic") && ok;
+    ok = CheckLeaks<Refcount::Biased>("IntrusivePtr:biased") && ok;
+    return ok ? 0 : 1;
 }
-
@@ -1,4 +1,5 @@
-﻿#include <chrono>
+﻿#include "InplaceFunction.h"
+#include <chrono>
 #include <future>
 #include <iostream>
 #include <mutex>
@@ -246,7 +247,7 @@ private:
         template<typename F>
         Task(Clock::time_point inFutureTime, F&& inFunction) :
             mFutureTime(inFutureTime),
-            mFunction(std::move(inFunction))
+            mFunction(std::forward<F>(inFunction))
         {
         }
 
@@ -270,7 +271,7 @@ private:
         }
 
         Clock::time_point mFutureTime;
-        mutable std::function<void(Internal)> mFunction;
+        InplaceFunction<void(Internal)> mFunction;
     };
 
     void schedulerThread()
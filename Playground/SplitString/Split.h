@@ -0,0 +1,254 @@
+#ifndef SPLIT_H_INCLUDED
+#define SPLIT_H_INCLUDED
+
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Splits text on a delimiter without copying: the fields are StringRefs
+ * into the text, produced one at a time as the range is iterated.
+ *
+ *     for (Split::StringRef field : Split::split(text, ",")) { ... }
+ *
+ * Like the split() it replaces, n delimiters give n + 1 fields, empty ones
+ * included. The text must outlive the fields.
+ *
+ * With AVX2 the delimiter is searched 32 bytes at a time. The candidates of
+ * a block are kept as a bit mask, so a short field costs a bit scan rather
+ * than a call to memchr.
+ */
+namespace Split {
+
+
+//! A view on characters owned by someone else.
+class StringRef
+{
+public:
+    StringRef() : mData(0), mSize(0) {}
+
+    StringRef(const char * inData, size_t inSize) : mData(inData), mSize(inSize) {}
+
+    const char * data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    const char * begin() const { return mData; }
+    const char * end() const { return mData + mSize; }
+
+    char operator[](size_t i) const { return mData[i]; }
+
+    std::string str() const { return std::string(mData, mSize); }
+
+    bool operator==(const StringRef & inOther) const
+    {
+        return mSize == inOther.mSize && std::memcmp(mData, inOther.mData, mSize) == 0;
+    }
+
+    bool operator!=(const StringRef & inOther) const { return !(*this == inOther); }
+
+private:
+    const char * mData;
+    size_t mSize;
+};
+
+
+inline std::ostream & operator<<(std::ostream & os, const StringRef & inRef)
+{
+    return os.write(inRef.data(), inRef.size());
+}
+
+
+//! The fields of a text, as a single pass range.
+class Splitter
+{
+public:
+    class Iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef StringRef value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const StringRef * pointer;
+        typedef const StringRef & reference;
+
+        explicit Iterator(Splitter * inSplitter = 0) : mSplitter(inSplitter)
+        {
+            ++*this;
+        }
+
+        const StringRef & operator*() const { return mField; }
+        const StringRef * operator->() const { return &mField; }
+
+        Iterator & operator++()
+        {
+            if (mSplitter && !mSplitter->next(mField))
+            {
+                mSplitter = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator & inOther) const { return mSplitter == inOther.mSplitter; }
+        bool operator!=(const Iterator & inOther) const { return mSplitter != inOther.mSplitter; }
+
+    private:
+        Splitter * mSplitter;
+        StringRef mField;
+    };
+
+    //! Splits [inBegin, inEnd) on inDelimiter, which must not be empty.
+    Splitter(const char * inBegin, const char * inEnd, const std::string & inDelimiter, bool inVectorized = true) :
+        mDelimiter(inDelimiter),
+        mField(inBegin),
+        mEnd(inEnd),
+        mBlock(inBegin),
+        mCandidates(0),
+        mDone(false),
+        mTail(true)
+    {
+        if (mDelimiter.empty())
+        {
+            throw std::invalid_argument("Split: empty delimiter");
+        }
+#ifdef __AVX2__
+        if (inVectorized && mEnd - inBegin >= static_cast<ptrdiff_t>(cBlockSize + mDelimiter.size() - 1))
+        {
+            mCandidates = candidates(inBegin);
+            mTail = false;
+        }
+#else
+        (void)inVectorized;
+#endif
+    }
+
+    //! Stores the next field in outField, false after the last one.
+    bool next(StringRef & outField)
+    {
+        if (mDone)
+        {
+            return false;
+        }
+        const char * delimiter = find(mField);
+        if (delimiter == mEnd)
+        {
+            outField = StringRef(mField, mEnd - mField);
+            mDone = true;
+            return true;
+        }
+        outField = StringRef(mField, delimiter - mField);
+        mField = delimiter + mDelimiter.size();
+        return true;
+    }
+
+    Iterator begin() { return Iterator(this); }
+    Iterator end() { return Iterator(); }
+
+private:
+    enum { cBlockSize = 32 };
+
+    // The first delimiter at or after inFrom, or mEnd.
+    const char * find(const char * inFrom)
+    {
+#ifdef __AVX2__
+        const size_t n = mDelimiter.size();
+        while (!mTail)
+        {
+            for (; mCandidates != 0; mCandidates &= mCandidates - 1)
+            {
+                // A candidate below inFrom overlaps the previous delimiter.
+                const char * candidate = mBlock + __builtin_ctz(mCandidates);
+                if (candidate >= inFrom && (n == 1 || std::memcmp(candidate + 1, mDelimiter.data() + 1, n - 1) == 0))
+                {
+                    mCandidates &= mCandidates - 1;
+                    return candidate;
+                }
+            }
+            mBlock += cBlockSize;
+            if (mEnd - mBlock < static_cast<ptrdiff_t>(cBlockSize + n - 1))
+            {
+                mTail = true;
+                break;
+            }
+            mCandidates = candidates(mBlock);
+        }
+        inFrom = std::max(inFrom, mBlock);
+#endif
+        return find_scalar(inFrom);
+    }
+
+#ifdef __AVX2__
+    // Bit k is set if inBlock[k] is the first character of the delimiter
+    // and inBlock[k + n - 1] the last one.
+    uint32_t candidates(const char * inBlock) const
+    {
+        const size_t n = mDelimiter.size();
+        __m256i first = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(inBlock)), _mm256_set1_epi8(mDelimiter[0]));
+        __m256i last = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(inBlock + n - 1)), _mm256_set1_epi8(mDelimiter[n - 1]));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(first, last)));
+    }
+#endif
+
+    const char * find_scalar(const char * p) const
+    {
+        const size_t n = mDelimiter.size();
+        while (static_cast<size_t>(mEnd - p) >= n)
+        {
+            const char * first = static_cast<const char*>(std::memchr(p, mDelimiter[0], (mEnd - p) - (n - 1)));
+            if (first == 0)
+            {
+                break;
+            }
+            if (std::memcmp(first + 1, mDelimiter.data() + 1, n - 1) == 0)
+            {
+                return first;
+            }
+            p = first + 1;
+        }
+        return mEnd;
+    }
+
+    std::string mDelimiter;
+    const char * mField;      // start of the next field
+    const char * mEnd;
+    const char * mBlock;      // the block that mCandidates belong to
+    uint32_t mCandidates;     // delimiter candidates in mBlock not looked at yet
+    bool mDone;
+    bool mTail;               // too close to the end for a block, searching with memchr
+};
+
+
+inline Splitter split(const char * inBegin, const char * inEnd, const std::string & inDelimiter)
+{
+    return Splitter(inBegin, inEnd, inDelimiter);
+}
+
+
+//! The fields of inText, which must outlive them.
+inline Splitter split(const std::string & inText, const std::string & inDelimiter)
+{
+    return Splitter(inText.data(), inText.data() + inText.size(), inDelimiter);
+}
+
+
+//! split() with memchr only, for comparison.
+inline Splitter split_scalar(const std::string & inText, const std::string & inDelimiter)
+{
+    return Splitter(inText.data(), inText.data() + inText.size(), inDelimiter, false);
+}
+
+
+} // namespace Split
+
+
+#endif // SPLIT_H_INCLUDED
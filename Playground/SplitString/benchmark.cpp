@@ -0,0 +1,150 @@
+#include "Benchmark.h"
+#include "Split.h"
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Splitting throughput: the split() that returned a vector of copies,
+// against the Split.h range with memchr and with the vector search. One
+// operation is one input byte.
+//
+//   benchmark [size]      (default 16777216)
+//
+// The inputs are short comma separated fields, lines, lines with "\r\n",
+// and runs of 'a' split on "aa", where delimiter candidates overlap.
+// Every splitter must see the same fields as the original.
+
+
+namespace Original {
+
+
+std::vector<std::string> split(const std::string & text, const std::string & delim)
+{
+    std::vector<std::string> result;
+    std::string::size_type begin = 0;
+    while (true)
+    {
+        std::string::size_type end = text.find(delim, begin);
+        if (end == std::string::npos)
+        {
+            result.push_back(text.substr(begin, std::string::npos));
+            break;
+        }
+
+        result.push_back(text.substr(begin, end - begin));
+        begin = end + delim.size();
+    }
+    return result;
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+struct Input
+{
+    std::string name;
+    std::string text;
+    std::string delimiter;
+};
+
+
+std::vector<Input> generate(size_t inSize)
+{
+    std::mt19937 random(7);
+    const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    auto fields = [&](size_t inMaxLength, const std::string & inDelimiter)
+    {
+        std::string text;
+        while (text.size() < inSize)
+        {
+            for (size_t length = random() % (inMaxLength + 1); length != 0; --length)
+            {
+                text += letters[random() % letters.size()];
+            }
+            text += inDelimiter;
+        }
+        text.resize(inSize);
+        return text;
+    };
+
+    std::vector<Input> result;
+    result.push_back(Input{ "csv", fields(12, ","), "," });
+    result.push_back(Input{ "lines", fields(120, "\n"), "\n" });
+    result.push_back(Input{ "crlf", fields(120, "\r\n"), "\r\n" });
+
+    std::string runs;
+    while (runs.size() < inSize)
+    {
+        runs.append(1 + random() % 7, 'a');
+        runs += 'b';
+    }
+    runs.resize(inSize);
+    result.push_back(Input{ "overlap", runs, "aa" });
+    return result;
+}
+
+
+// Sensitive to the number, the lengths and the order of the fields.
+template<class Range>
+uint64_t checksum(Range && inFields)
+{
+    uint64_t result = 0;
+    uint64_t index = 0;
+    for (const auto & field : inFields)
+    {
+        result = result * 31 + field.size() * ++index + static_cast<uint8_t>(field.empty() ? 0 : field[0]);
+    }
+    return result;
+}
+
+
+void check(const std::string & inName, uint64_t inValue, uint64_t inExpected)
+{
+    if (inValue != inExpected)
+    {
+        throw std::runtime_error(inName + ": got checksum " + std::to_string(inValue) + ", expected " + std::to_string(inExpected));
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
+    size_t size = 16 << 20;
+    if (!runner.options().arguments.empty())
+    {
+        size = std::strtoul(runner.options().arguments[0].c_str(), 0, 10);
+    }
+
+    for (const Input & input : generate(size))
+    {
+        const std::string prefix = input.name + "/";
+        const uint64_t expected = checksum(Original::split(input.text, input.delimiter));
+
+        runner.run_batch(prefix + "original", input.text.size(), [&]
+        {
+            check(prefix + "original", checksum(Original::split(input.text, input.delimiter)), expected);
+        }, 1);
+        runner.run_batch(prefix + "split_scalar", input.text.size(), [&]
+        {
+            check(prefix + "split_scalar", checksum(Split::split_scalar(input.text, input.delimiter)), expected);
+        }, 1);
+        runner.run_batch(prefix + "split", input.text.size(), [&]
+        {
+            check(prefix + "split", checksum(Split::split(input.text, input.delimiter)), expected);
+        }, 1);
+    }
+}
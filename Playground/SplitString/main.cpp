@@ -1,41 +1,22 @@
+#include "Split.h"
 #include <iostream>
 #include <string>
-#include <vector>
 
 
-std::vector<std::string> split(const std::string & text, const std::string & delim)
+void print(const std::string & text, const std::string & delim)
 {
-    std::vector<std::string> result;
-    std::string::size_type begin = 0;
-    while (true)
+    for (Split::StringRef item : Split::split(text, delim))
     {
-        std::string::size_type end = text.find(delim, begin);
-        if (end == std::string::npos)
-        {
-            result.push_back(text.substr(begin, std::string::npos));
-            break;
-        }
-
-        result.push_back(text.substr(begin, end - begin));
-        begin = end + delim.size();
-    }
-    return result;
-}
-
-
-std::ostream & operator<<(std::ostream & os, const std::vector<std::string> & items)
-{
-    for (auto item: items)
-    {
-        os << "\"" << item << "\" ";
+        std::cout << "\"" << item << "\" ";
     }
-    return os << std::endl;
+    std::cout << std::endl;
 }
 
 
 int main()
 {
-    std::string test = "a";
-    std::cout << split(test, ".") << std::endl;
+    print("a", ".");
+    print("a.b..c.", ".");
+    print("key := value := other", " := ");
     std::cout << "Done." << std::endl;
 }
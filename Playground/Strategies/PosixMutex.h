@@ -67,8 +67,9 @@ struct NativeMutex<rec, Spin::No> : Attribute<rec>
         pthread_mutex_destroy(&obj);
     }
 
-    void lock()    { pthread_mutex_lock (&obj); }
-    void unlock()  { pthread_mutex_unlock(&obj); }
+    void lock()     { pthread_mutex_lock (&obj); }
+    bool try_lock() { return pthread_mutex_trylock(&obj) == 0; }
+    void unlock()   { pthread_mutex_unlock(&obj); }
 
     Type obj;
 };
@@ -79,6 +80,7 @@ typedef int pthread_spinlock_t;
 template<typename ...Args> void pthread_spin_init(Args && ...)    {}
 template<typename ...Args> void pthread_spin_destroy(Args && ...) {}
 template<typename ...Args> void pthread_spin_lock(Args && ...)    {}
+template<typename ...Args> int  pthread_spin_trylock(Args && ...) { return 0; }
 template<typename ...Args> void pthread_spin_unlock(Args && ...)  {}
 #endif // __APPLE__
 
@@ -99,8 +101,9 @@ struct NativeMutex<Recursive::No, Spin::Yes>
         pthread_spin_destroy(&obj);
     }
 
-    void lock()    { pthread_spin_lock  (&obj); }
-    void unlock()  { pthread_spin_unlock(&obj); }
+    void lock()     { pthread_spin_lock  (&obj); }
+    bool try_lock() { return pthread_spin_trylock(&obj) == 0; }
+    void unlock()   { pthread_spin_unlock(&obj); }
 
     Type obj;
 };
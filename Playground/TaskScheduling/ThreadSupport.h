@@ -1,3 +1,4 @@
+#include "InplaceFunction.h"
 #include "tbb/concurrent_queue.h"
 #include <future>
 #include <thread>
@@ -10,13 +11,6 @@ namespace ThreadSupport {
 //
 // Helper functions
 //
-template<typename F>
-auto MakeSharedPromise(F f) -> std::shared_ptr<std::promise<decltype(f())>>
-{
-    return std::make_shared<std::promise<decltype(f())>>();
-}
-
-
 template<typename R, typename F>
 void SetPromise(std::promise<R>& p, F f)
 {
@@ -32,6 +26,22 @@ void SetPromise(std::promise<void>& p, F f)
 }
 
 
+//
+// Task that owns its promise. Because the task queue holds move-only
+// InplaceFunction objects the promise no longer needs to be shared.
+//
+template<typename R, typename F>
+struct PromiseTask
+{
+    PromiseTask(std::promise<R>&& p, F f) : mPromise(std::move(p)), mFunction(std::move(f)) {}
+
+    void operator()() { SetPromise(mPromise, mFunction); }
+
+    std::promise<R> mPromise;
+    F mFunction;
+};
+
+
 template<typename F, typename ...Args>
 auto Async(F f, Args&& ...args) -> std::future<decltype(f(std::declval<Args>()...))>
 {
@@ -54,7 +64,7 @@ struct Scheduler
         Async([=]{
             try {
                 while (!checker.expired()) {
-                    std::function<void()> f;
+                    Task f;
                     concurrent_queue.pop(f);
                     f();
                 }
@@ -79,11 +89,11 @@ struct Scheduler
     template<typename F>
     auto dispatch(F f) -> std::future<decltype(f())>
     {
-        auto p = MakeSharedPromise(f);
-        concurrent_queue.push([=]{
-            SetPromise(*p, f);
-        });
-        return p->get_future();
+        typedef decltype(f()) R;
+        std::promise<R> p;
+        std::future<R> future = p.get_future();
+        concurrent_queue.push(Task(PromiseTask<R, F>(std::move(p), std::move(f))));
+        return future;
     }
 
     template<typename F>
@@ -96,6 +106,7 @@ struct Scheduler
 
 private:
     typedef std::chrono::system_clock Clock;
+    typedef InplaceFunction<void()> Task;
     
     struct QuitException {};
     
@@ -117,7 +128,7 @@ private:
         return mLifetime;
     }
 
-    tbb::concurrent_bounded_queue<std::function<void()>> concurrent_queue;
+    tbb::concurrent_bounded_queue<Task> concurrent_queue;
     std::shared_ptr<void> mLifetime;
 };
 
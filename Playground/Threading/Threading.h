@@ -2,8 +2,13 @@
 #define THREADING_H_INCLUDED
 
 
+#include <boost/functional/hash.hpp>
 #include <boost/noncopyable.hpp>
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <pthread.h>
 
 
@@ -19,6 +24,8 @@ public:
 
     void lock() { pthread_mutex_lock(&mMutex); }
 
+    bool try_lock() { return pthread_mutex_trylock(&mMutex) == 0; }
+
     void unlock() { pthread_mutex_unlock(&mMutex); }
 
 private:
@@ -26,6 +33,57 @@ private:
 };
 
 
+/**
+ * Read/write lock for the posix platform.
+ * Any number of readers can hold the lock at the same time.
+ */
+class RWMutex : boost::noncopyable
+{
+public:
+    RWMutex() { pthread_rwlock_init(&mRWLock, NULL); }
+
+    ~RWMutex() { pthread_rwlock_destroy(&mRWLock); }
+
+    void lock() { pthread_rwlock_wrlock(&mRWLock); }
+
+    void unlock() { pthread_rwlock_unlock(&mRWLock); }
+
+    void lock_shared() { pthread_rwlock_rdlock(&mRWLock); }
+
+    void unlock_shared() { pthread_rwlock_unlock(&mRWLock); }
+
+private:
+    pthread_rwlock_t mRWLock;
+};
+
+
+/**
+ * Lock policies for ThreadSafe.
+ *
+ * ExclusiveLock serializes every access, reads included.
+ * ReadWriteLock lets ScopedReader objects run concurrently
+ * and is meant for read-mostly data.
+ */
+struct ExclusiveLock
+{
+    typedef Mutex MutexType;
+    static void lock(Mutex & inMutex) { inMutex.lock(); }
+    static void unlock(Mutex & inMutex) { inMutex.unlock(); }
+    static void lock_shared(Mutex & inMutex) { inMutex.lock(); }
+    static void unlock_shared(Mutex & inMutex) { inMutex.unlock(); }
+};
+
+
+struct ReadWriteLock
+{
+    typedef RWMutex MutexType;
+    static void lock(RWMutex & inMutex) { inMutex.lock(); }
+    static void unlock(RWMutex & inMutex) { inMutex.unlock(); }
+    static void lock_shared(RWMutex & inMutex) { inMutex.lock_shared(); }
+    static void unlock_shared(RWMutex & inMutex) { inMutex.unlock_shared(); }
+};
+
+
 /**
  * The ScopedLock keeps a Mutex object locked during its lifetime.
  */
@@ -48,19 +106,22 @@ private:
 };
 
 
-// Forward declaration.
-template<class> class ScopedAccessor;
+// Forward declarations.
+template<class, class> class ScopedAccessor;
+template<class, class> class ScopedReader;
 
 
 /**
  * ThreadSafe can be used to create a thread-safe object.
- * Access to the held object can be obtained by creating a ScopedAccessor object.
+ * Access to the held object can be obtained by creating a ScopedAccessor object,
+ * or a ScopedReader object for read-only access.
  */
-template<class VariableT>
+template<class VariableT, class LockPolicyT = ExclusiveLock>
 class ThreadSafe
 {
 public:
     typedef VariableT Variable;
+    typedef LockPolicyT LockPolicy;
 
     ThreadSafe() :
         mData(new Data(new Variable()))
@@ -72,16 +133,16 @@ public:
     {
     }
 
-    ThreadSafe(const ThreadSafe<Variable> & rhs) :
+    ThreadSafe(const ThreadSafe & rhs) :
         mData(rhs.mData)
     {
         ++mData->mRefCount;
     }
 
-    ThreadSafe<Variable> & operator=(const ThreadSafe<Variable> & rhs)
+    ThreadSafe & operator=(const ThreadSafe & rhs)
     {
         // Using the copy & swap idiom:
-        ThreadSafe<Variable> copy(rhs);
+        ThreadSafe copy(rhs);
         swap(copy);
         return *this;
     }
@@ -94,15 +155,18 @@ public:
         }
     }
 
-    void swap(ThreadSafe<Variable> & rhs)
+    void swap(ThreadSafe & rhs)
     {
         std::swap(mData, rhs.mData);
     }
 
 private:
-    friend class ScopedAccessor<Variable>;
+    friend class ScopedAccessor<Variable, LockPolicy>;
+    friend class ScopedReader<Variable, LockPolicy>;
+
+    typedef typename LockPolicy::MutexType MutexType;
 
-    Mutex & getMutex() { return mData->mMutex; }
+    MutexType & getMutex() { return mData->mMutex; }
 
     const Variable & getVariable() const { return *mData->mVariable; }
 
@@ -123,8 +187,8 @@ private:
         }
 
         Variable * mVariable;
-        Mutex mMutex;
-        unsigned mRefCount;
+        MutexType mMutex;
+        std::atomic<unsigned> mRefCount;
     };
 
     Data * mData;
@@ -135,14 +199,19 @@ private:
  * ScopedAccessor creates an atomic scope that allows access
  * to the variable held by the ThreadSafe wrapper.
  */
-template<typename Variable>
+template<typename Variable, typename LockPolicy = ExclusiveLock>
 class ScopedAccessor : boost::noncopyable
 {
 public:
-    ScopedAccessor(ThreadSafe<Variable> & inThreadSafeVariable) :
-        mThreadSafeVariable(inThreadSafeVariable),
-        mScopedLock(inThreadSafeVariable.getMutex())
+    ScopedAccessor(ThreadSafe<Variable, LockPolicy> & inThreadSafeVariable) :
+        mThreadSafeVariable(inThreadSafeVariable)
     {
+        LockPolicy::lock(mThreadSafeVariable.getMutex());
+    }
+
+    ~ScopedAccessor()
+    {
+        LockPolicy::unlock(mThreadSafeVariable.getMutex());
     }
 
     const Variable & get() const { return mThreadSafeVariable.getVariable(); }
@@ -154,8 +223,154 @@ public:
     Variable * operator->() { return &mThreadSafeVariable.getVariable(); }
 
 private:
-    ThreadSafe<Variable> & mThreadSafeVariable;
-    ScopedLock mScopedLock;
+    ThreadSafe<Variable, LockPolicy> & mThreadSafeVariable;
+};
+
+
+/**
+ * ScopedReader creates a read-only scope. With the ReadWriteLock
+ * policy multiple readers can be active at the same time.
+ */
+template<typename Variable, typename LockPolicy = ExclusiveLock>
+class ScopedReader : boost::noncopyable
+{
+public:
+    ScopedReader(ThreadSafe<Variable, LockPolicy> & inThreadSafeVariable) :
+        mThreadSafeVariable(inThreadSafeVariable)
+    {
+        LockPolicy::lock_shared(mThreadSafeVariable.getMutex());
+    }
+
+    ~ScopedReader()
+    {
+        LockPolicy::unlock_shared(mThreadSafeVariable.getMutex());
+    }
+
+    const Variable & get() const { return mThreadSafeVariable.getVariable(); }
+
+    const Variable * operator->() const { return &mThreadSafeVariable.getVariable(); }
+
+private:
+    ThreadSafe<Variable, LockPolicy> & mThreadSafeVariable;
+};
+
+
+/**
+ * ThreadSafeSnapshot is meant for read-heavy objects like configuration.
+ *
+ * Readers work on an immutable snapshot and never block writers. A writer
+ * copies the current value, modifies the copy and publishes it. Old
+ * snapshots stay alive until their last reader releases them (RCU style).
+ */
+template<class VariableT>
+class ThreadSafeSnapshot : boost::noncopyable
+{
+public:
+    typedef VariableT Variable;
+    typedef std::shared_ptr<const Variable> Snapshot;
+
+    ThreadSafeSnapshot() :
+        mCurrent(std::make_shared<const Variable>()),
+        mVersion(0),
+        mWriterMutex()
+    {
+    }
+
+    ThreadSafeSnapshot(const Variable & inVariable) :
+        mCurrent(std::make_shared<const Variable>(inVariable)),
+        mVersion(0),
+        mWriterMutex()
+    {
+    }
+
+    Snapshot snapshot() const
+    {
+        return std::atomic_load_explicit(&mCurrent, std::memory_order_acquire);
+    }
+
+    // Copy, modify and publish. Writers are serialized.
+    template<typename Function>
+    void update(Function inFunction)
+    {
+        ScopedLock lock(mWriterMutex);
+        std::shared_ptr<Variable> copy = std::make_shared<Variable>(*mCurrent);
+        inFunction(*copy);
+        std::atomic_store_explicit(&mCurrent, Snapshot(copy), std::memory_order_release);
+        mVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Reader caches the last snapshot. As long as nothing was published in
+     * the meantime get() only costs one atomic load of the version number.
+     * A Reader object must not be shared between threads.
+     */
+    class Reader
+    {
+    public:
+        Reader(const ThreadSafeSnapshot & inSource) :
+            mSource(&inSource),
+            mVersion(inSource.mVersion.load(std::memory_order_acquire)),
+            mSnapshot(inSource.snapshot())
+        {
+        }
+
+        const Variable & get()
+        {
+            uint64_t version = mSource->mVersion.load(std::memory_order_acquire);
+            if (version != mVersion)
+            {
+                mSnapshot = mSource->snapshot();
+                mVersion = version;
+            }
+            return *mSnapshot;
+        }
+
+        const Variable * operator->() { return &get(); }
+
+    private:
+        const ThreadSafeSnapshot * mSource;
+        uint64_t mVersion;
+        Snapshot mSnapshot;
+    };
+
+private:
+    Snapshot mCurrent;
+    std::atomic<uint64_t> mVersion;
+    Mutex mWriterMutex;
+};
+
+
+/**
+ * ShardedThreadSafe splits a container into N independently locked shards.
+ * A key is always mapped to the same shard, so operations on different keys
+ * usually don't contend. Usage example:
+ *
+ *   ShardedThreadSafe<std::map<int, Foo>, 16> foos;
+ *   ScopedAccessor<std::map<int, Foo> > accessor(foos.shard(key));
+ *   accessor->insert(std::make_pair(key, foo));
+ */
+template<class VariableT, std::size_t N, class LockPolicyT = ExclusiveLock, class HashT = boost::hash<typename VariableT::key_type> >
+class ShardedThreadSafe : boost::noncopyable
+{
+public:
+    typedef VariableT Variable;
+    typedef LockPolicyT LockPolicy;
+    typedef ThreadSafe<Variable, LockPolicy> Shard;
+
+    static std::size_t size() { return N; }
+
+    Shard & shard(const typename Variable::key_type & inKey)
+    {
+        return mShards[HashT()(inKey) % N];
+    }
+
+    Shard & shard_at(std::size_t inIndex)
+    {
+        return mShards[inIndex];
+    }
+
+private:
+    Shard mShards[N];
 };
 
 
@@ -175,5 +390,13 @@ private:
     FOR_BLOCK(ScopedAccessor<Type> accessor(name)) \
         FOR_BLOCK(Type & name = accessor.get())
 
+#define ATOMIC_SCOPE_POLICY(Type, LockPolicy, name) \
+    FOR_BLOCK(ScopedAccessor<Type, LockPolicy> accessor(name)) \
+        FOR_BLOCK(Type & name = accessor.get())
+
+#define READ_SCOPE(Type, LockPolicy, name) \
+    FOR_BLOCK(ScopedReader<Type, LockPolicy> reader(name)) \
+        FOR_BLOCK(const Type & name = reader.get())
+
 
 #endif // THREADING_H_INCLUDED
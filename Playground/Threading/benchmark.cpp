@@ -0,0 +1,216 @@
+#include "Threading.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+
+// Contention benchmark for the ThreadSafe variants.
+// Every thread does a fixed number of lookups/updates on a shared map.
+// The read/write ratio and the number of threads are swept.
+
+
+typedef std::map<int, int> Map;
+typedef std::chrono::steady_clock Clock;
+
+
+enum
+{
+    cKeyCount = 256,
+    cOperationsPerThread = 200 * 1000,
+    cShardCount = 16
+};
+
+
+Map make_map()
+{
+    Map result;
+    for (int i = 0; i != cKeyCount; ++i)
+    {
+        result[i] = i;
+    }
+    return result;
+}
+
+
+// Cheap per-thread random numbers (xorshift32).
+struct Random
+{
+    Random(uint32_t inSeed) : mState(inSeed * 2654435761u + 1) {}
+
+    uint32_t operator()()
+    {
+        mState ^= mState << 13;
+        mState ^= mState >> 17;
+        mState ^= mState << 5;
+        return mState;
+    }
+
+    uint32_t mState;
+};
+
+
+template<typename LockPolicy>
+struct Locked
+{
+    Locked() : mData(new Map(make_map())) {}
+
+    struct Worker
+    {
+        Worker(Locked & inParent) : mParent(inParent) {}
+
+        int read(int key)
+        {
+            ScopedReader<Map, LockPolicy> reader(mParent.mData);
+            return reader->find(key)->second;
+        }
+
+        void write(int key)
+        {
+            ScopedAccessor<Map, LockPolicy> accessor(mParent.mData);
+            ++accessor.get()[key];
+        }
+
+        Locked & mParent;
+    };
+
+    ThreadSafe<Map, LockPolicy> mData;
+};
+
+
+struct Snapshot
+{
+    Snapshot() : mData(make_map()) {}
+
+    struct Worker
+    {
+        Worker(Snapshot & inParent) : mParent(inParent), mReader(inParent.mData) {}
+
+        int read(int key)
+        {
+            return mReader->find(key)->second;
+        }
+
+        void write(int key)
+        {
+            mParent.mData.update([=](Map & map) { ++map[key]; });
+        }
+
+        Snapshot & mParent;
+        ThreadSafeSnapshot<Map>::Reader mReader;
+    };
+
+    ThreadSafeSnapshot<Map> mData;
+};
+
+
+struct Sharded
+{
+    Sharded()
+    {
+        Map map = make_map();
+        for (Map::const_iterator it = map.begin(); it != map.end(); ++it)
+        {
+            ScopedAccessor<Map> accessor(mData.shard(it->first));
+            accessor->insert(*it);
+        }
+    }
+
+    struct Worker
+    {
+        Worker(Sharded & inParent) : mParent(inParent) {}
+
+        int read(int key)
+        {
+            ScopedReader<Map> reader(mParent.mData.shard(key));
+            return reader->find(key)->second;
+        }
+
+        void write(int key)
+        {
+            ScopedAccessor<Map> accessor(mParent.mData.shard(key));
+            ++accessor.get()[key];
+        }
+
+        Sharded & mParent;
+    };
+
+    ShardedThreadSafe<Map, cShardCount> mData;
+};
+
+
+// Returns million operations per second over all threads.
+template<typename Subject>
+double run(unsigned inThreadCount, unsigned inReadPercentage)
+{
+    Subject subject;
+    std::vector<std::thread> threads;
+    std::atomic<bool> go(false);
+    std::atomic<long> sink(0);
+
+    for (unsigned t = 0; t != inThreadCount; ++t)
+    {
+        threads.push_back(std::thread([&, t]
+        {
+            typename Subject::Worker worker(subject);
+            Random random(t);
+            long sum = 0;
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            for (unsigned i = 0; i != cOperationsPerThread; ++i)
+            {
+                uint32_t r = random();
+                int key = r % cKeyCount;
+                if ((r >> 16) % 100 < inReadPercentage)
+                {
+                    sum += worker.read(key);
+                }
+                else
+                {
+                    worker.write(key);
+                }
+            }
+            sink += sum;
+        }));
+    }
+
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    return inThreadCount * double(cOperationsPerThread) / elapsed / 1e6;
+}
+
+
+int main()
+{
+    const unsigned read_percentages[] = { 50, 90, 99, 100 };
+    const unsigned thread_counts[] = { 1, 2, 4, 8 };
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Million operations per second, " << cKeyCount << " keys, "
+              << cShardCount << " shards" << std::endl
+              << std::setw(8) << "reads%" << std::setw(9) << "threads"
+              << std::setw(12) << "Exclusive" << std::setw(12) << "ReadWrite"
+              << std::setw(12) << "Snapshot" << std::setw(12) << "Sharded" << std::endl;
+
+    for (unsigned reads : read_percentages)
+    {
+        for (unsigned threads : thread_counts)
+        {
+            std::cout << std::setw(8) << reads << std::setw(9) << threads
+                      << std::setw(12) << run<Locked<ExclusiveLock> >(threads, reads)
+                      << std::setw(12) << run<Locked<ReadWriteLock> >(threads, reads)
+                      << std::setw(12) << run<Snapshot>(threads, reads)
+                      << std::setw(12) << run<Sharded>(threads, reads)
+                      << std::endl;
+        }
+    }
+}
@@ -1,38 +1,24 @@
-#include "Poco/Stopwatch.h"
-#include "Poco/Types.h"
+#include "Benchmark.h"
 #include <iostream>
 
-static const long long cMicrosecond = 1000 * 1000;
 
-int main()
+// Measures the duration of one print statement. Use --out=FILE to keep
+// the results apart from the printed lines.
+int main(int argc, char ** argv)
 {
-	Poco::Stopwatch stopwatch;
-	stopwatch.start();
-	
+	Bench::Options defaults;
+	defaults.repetitions = 3;
+	defaults.warmup = 0;
+	Bench::Runner runner(argc, argv, defaults);
+
 	std::string message(75, '=');
 	long long cIterationCount = 100000;
-	for (size_t idx = 0; idx < cIterationCount; idx++)
+	runner.run_batch("print_line", cIterationCount, [&]
 	{
-		std::cout << idx << message << std::endl;
-	}
-
-	stopwatch.stop();
-
-	std::cout << "Number of iterations: " << cIterationCount << std::endl;
-
-	long long elapsed = stopwatch.elapsed();
-	std::cout << "Elapsed microseconds: " << elapsed  << std::endl;
-
-	double elapsedSeconds = double(elapsed) / double(cMicrosecond);
-	std::cout << "Elapsed seconds: " << elapsedSeconds << std::endl;
-
-
-	std::cout << "Number of print statements per second: " << int(0.5 + (double(cIterationCount) / elapsedSeconds)) << std::endl;
-	std::cout << "Duration of one print statement: " << (double(1000) * elapsedSeconds) / cIterationCount << " ms (milliseconds)" << std::endl;
-
-
-	//double duration = double(elapsed) / (double(cIterationCount) * double(cMicrosecond));
-	//std::cout << "Duration: " << duration << std::endl;
+		for (long long idx = 0; idx < cIterationCount; idx++)
+		{
+			std::cout << idx << message << std::endl;
+		}
+	});
 	return 0;
 }
-
@@ -0,0 +1,320 @@
+#ifndef URI_H_INCLUDED
+#define URI_H_INCLUDED
+
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Percent-encoding (RFC 3986, section 2.1) for uriencode and the HTTP server.
+ *
+ * Which bytes get encoded is a ByteSet: a 256 entry table, plus the same
+ * set in nibble tables for the vector code. Text is mostly made of bytes
+ * that stay as they are, so both directions classify 32 bytes at a time
+ * and copy the blocks that need no work in one go.
+ */
+namespace URI {
+
+
+class ByteSet
+{
+public:
+    //! The bytes of inChars, and with inHighHalf all bytes from 0x80 up.
+    explicit ByteSet(const std::string & inChars, bool inHighHalf = false) :
+        mHighHalf(inHighHalf),
+        mHighBytes(false)
+    {
+        for (unsigned i = 0; i != 256; ++i)
+        {
+            mTable[i] = inHighHalf && i >= 0x80;
+        }
+        for (unsigned i = 0; i != 16; ++i)
+        {
+            mLow[i] = 0;
+            mHigh[i] = i < 8 ? static_cast<uint8_t>(1 << i) : 0;
+            mLowUpper[i] = 0;
+            mHighUpper[i] = i < 8 ? 0 : static_cast<uint8_t>(1 << (i - 8));
+        }
+        for (char ch : inChars)
+        {
+            uint8_t c = static_cast<uint8_t>(ch);
+            mTable[c] = true;
+            if (c < 0x80)
+            {
+                mLow[c & 0x0F] |= static_cast<uint8_t>(1 << (c >> 4));
+            }
+            else if (!inHighHalf)
+            {
+                mLowUpper[c & 0x0F] |= static_cast<uint8_t>(1 << ((c >> 4) - 8));
+                mHighBytes = true;
+            }
+        }
+    }
+
+    //! The reserved characters and '%', which is what uriencode has always encoded.
+    static const ByteSet & reserved()
+    {
+        static const ByteSet result("%!#$&'()*+,/:;=?@[]");
+        return result;
+    }
+
+    //! Everything except the unreserved characters ALPHA, DIGIT, '-', '.', '_' and '~'.
+    static const ByteSet & not_unreserved()
+    {
+        static const ByteSet result(not_unreserved_chars(), true);
+        return result;
+    }
+
+    bool contains(uint8_t inByte) const { return mTable[inByte]; }
+
+#ifdef __AVX2__
+    //! Bit k is set if byte inData[k] is in the set, for k in [0, 32).
+    uint32_t match(const char * inData) const
+    {
+        // Byte c is in the set if bit (c >> 4) of mLow[c & 15] is set, for c
+        // below 0x80. The shuffles look up all 32 bytes at once.
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inData));
+        __m256i low_nibbles = _mm256_and_si256(bytes, nibble);
+        __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        uint32_t result = lookup(mLow, mHigh, low_nibbles, high_nibbles);
+        if (mHighHalf)
+        {
+            result |= static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+        }
+        else if (mHighBytes)
+        {
+            // The same from 0x80 up, with bit (c >> 4) - 8 of mLowUpper.
+            result |= lookup(mLowUpper, mHighUpper, low_nibbles, high_nibbles);
+        }
+        return result;
+    }
+#endif
+
+private:
+#ifdef __AVX2__
+    static uint32_t lookup(const uint8_t * inLow, const uint8_t * inHigh, __m256i inLowNibbles, __m256i inHighNibbles)
+    {
+        const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inLow)));
+        const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inHigh)));
+        __m256i low_bits = _mm256_shuffle_epi8(low, inLowNibbles);
+        __m256i high_bits = _mm256_shuffle_epi8(high, inHighNibbles);
+        __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(low_bits, high_bits), _mm256_setzero_si256());
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(miss));
+    }
+#endif
+
+    static std::string not_unreserved_chars()
+    {
+        std::string result;
+        for (int c = 0; c != 0x80; ++c)
+        {
+            bool unreserved = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+            if (!unreserved)
+            {
+                result += static_cast<char>(c);
+            }
+        }
+        return result;
+    }
+
+    bool mTable[256];
+    uint8_t mLow[16];       // bit h of mLow[l]: byte h * 16 + l is in the set, for h < 8
+    uint8_t mHigh[16];      // 1 << h for h < 8
+    uint8_t mLowUpper[16];  // bit h - 8 of mLowUpper[l]: byte h * 16 + l is in the set, for h >= 8
+    uint8_t mHighUpper[16]; // 1 << (h - 8) for h >= 8
+    bool mHighHalf;         // all bytes from 0x80 up
+    bool mHighBytes;        // some bytes from 0x80 up
+};
+
+
+namespace Detail {
+
+
+const char cHexDigits[] = "0123456789ABCDEF";
+
+
+// 0 to 15 for the hexadecimal digits, -1 otherwise.
+struct HexTable
+{
+    HexTable()
+    {
+        for (unsigned i = 0; i != 256; ++i)
+        {
+            value[i] = -1;
+        }
+        for (int i = 0; i != 10; ++i)
+        {
+            value['0' + i] = static_cast<int8_t>(i);
+        }
+        for (int i = 0; i != 6; ++i)
+        {
+            value['a' + i] = value['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+
+    int8_t value[256];
+};
+
+
+inline const HexTable & hex_table()
+{
+    static const HexTable result;
+    return result;
+}
+
+
+// Always writes three bytes, and keeps one or three. No branch to mispredict.
+inline char * put_encoded(char * outData, char inChar, const ByteSet & inEncode)
+{
+    uint8_t c = static_cast<uint8_t>(inChar);
+    bool encode = inEncode.contains(c);
+    outData[0] = encode ? '%' : inChar;
+    outData[1] = cHexDigits[c >> 4];
+    outData[2] = cHexDigits[c & 0x0F];
+    return outData + (encode ? 3 : 1);
+}
+
+
+inline bool put_decoded(const char * & ioData, const char * inEnd, char * & ioOutput, bool inPlusIsSpace)
+{
+    char c = *ioData;
+    if (c == '%')
+    {
+        const int8_t * hex = hex_table().value;
+        if (inEnd - ioData < 3 || hex[static_cast<uint8_t>(ioData[1])] < 0 || hex[static_cast<uint8_t>(ioData[2])] < 0)
+        {
+            return false;
+        }
+        *ioOutput++ = static_cast<char>(hex[static_cast<uint8_t>(ioData[1])] * 16 + hex[static_cast<uint8_t>(ioData[2])]);
+        ioData += 3;
+        return true;
+    }
+    *ioOutput++ = c == '+' && inPlusIsSpace ? ' ' : c;
+    ioData++;
+    return true;
+}
+
+
+} // namespace Detail
+
+
+/**
+ * Appends [inBegin, inEnd) to ioOutput, with the bytes in inEncode as %XX.
+ *
+ * With AVX2, blocks of 32 bytes without any byte to encode are copied as
+ * they are, and only the others go through the table byte by byte.
+ */
+inline void encode(const char * inBegin, const char * inEnd, std::string & ioOutput, const ByteSet & inEncode = ByteSet::reserved())
+{
+    const size_t size = ioOutput.size();
+    ioOutput.resize(size + 3 * (inEnd - inBegin));
+    char * out = &ioOutput[0] + size;
+    const char * p = inBegin;
+#ifdef __AVX2__
+    for (; inEnd - p >= 32; p += 32)
+    {
+        if (inEncode.match(p) == 0)
+        {
+            std::memcpy(out, p, 32);
+            out += 32;
+            continue;
+        }
+        for (unsigned i = 0; i != 32; ++i)
+        {
+            out = Detail::put_encoded(out, p[i], inEncode);
+        }
+    }
+#endif
+    for (; p != inEnd; ++p)
+    {
+        out = Detail::put_encoded(out, *p, inEncode);
+    }
+    ioOutput.resize(out - ioOutput.data());
+}
+
+
+inline std::string encode(const std::string & inText, const ByteSet & inEncode = ByteSet::reserved())
+{
+    std::string result;
+    encode(inText.data(), inText.data() + inText.size(), result, inEncode);
+    return result;
+}
+
+
+/**
+ * Appends [inBegin, inEnd) to ioOutput with every %XX decoded, and with
+ * inPlusIsSpace every '+' as a space, as in form data. Returns false if a
+ * '%' is not followed by two hexadecimal digits; ioOutput then holds the
+ * part before it.
+ */
+inline bool decode(const char * inBegin, const char * inEnd, std::string & ioOutput, bool inPlusIsSpace = true)
+{
+    const size_t size = ioOutput.size();
+    ioOutput.resize(size + (inEnd - inBegin));
+    char * out = &ioOutput[0] + size;
+    const char * p = inBegin;
+    bool ok = true;
+#ifdef __AVX2__
+    static const ByteSet percent("%");
+    static const ByteSet percent_or_plus("%+");
+    const ByteSet & specials = inPlusIsSpace ? percent_or_plus : percent;
+    while (ok && inEnd - p >= 32)
+    {
+        if (specials.match(p) == 0)
+        {
+            std::memcpy(out, p, 32);
+            out += 32;
+            p += 32;
+            continue;
+        }
+        // An escape at the end can reach into the next block.
+        for (const char * block_end = p + 32; ok && p < block_end; )
+        {
+            ok = Detail::put_decoded(p, inEnd, out, inPlusIsSpace);
+        }
+    }
+#endif
+    while (ok && p != inEnd)
+    {
+        ok = Detail::put_decoded(p, inEnd, out, inPlusIsSpace);
+    }
+    ioOutput.resize(out - ioOutput.data());
+    return ok;
+}
+
+
+inline bool decode(const std::string & inText, std::string & outText, bool inPlusIsSpace = true)
+{
+    outText.clear();
+    return decode(inText.data(), inText.data() + inText.size(), outText, inPlusIsSpace);
+}
+
+
+//! Encodes inInput to outOutput, a block at a time.
+inline void encode(std::istream & inInput, std::ostream & outOutput, const ByteSet & inEncode = ByteSet::reserved())
+{
+    std::vector<char> block(1 << 16);
+    std::string encoded;
+    while (inInput.read(block.data(), block.size()) || inInput.gcount() != 0)
+    {
+        encoded.clear();
+        encode(block.data(), block.data() + inInput.gcount(), encoded, inEncode);
+        outOutput.write(encoded.data(), encoded.size());
+    }
+}
+
+
+} // namespace URI
+
+
+#endif // URI_H_INCLUDED
@@ -0,0 +1,252 @@
+#include "Benchmark.h"
+#include "URI.h"
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Percent-encoding throughput: the switch per character that uriencode
+// used before, and the istringstream per %XX that the HTTP server's
+// url_decode used, against URI.h. One operation is one input byte.
+//
+//   benchmark [size]      (default 16777216)
+//
+// The inputs are URL paths, text full of reserved characters, and random
+// bytes. Every decoded result is checked against the original input.
+
+
+namespace Original {
+
+
+void encode(std::ostream& os, char c)
+{
+    switch (c)
+    {
+        case '%' : os.write("%25", 3u); return;
+        case '!' : os.write("%21", 3u); return;
+        case '#' : os.write("%23", 3u); return;
+        case '$' : os.write("%24", 3u); return;
+        case '&' : os.write("%26", 3u); return;
+        case '\'': os.write("%27", 3u); return;
+        case '(' : os.write("%28", 3u); return;
+        case ')' : os.write("%29", 3u); return;
+        case '*' : os.write("%2A", 3u); return;
+        case '+' : os.write("%2B", 3u); return;
+        case ',' : os.write("%2C", 3u); return;
+        case '/' : os.write("%2F", 3u); return;
+        case ':' : os.write("%3A", 3u); return;
+        case ';' : os.write("%3B", 3u); return;
+        case '=' : os.write("%3D", 3u); return;
+        case '?' : os.write("%3F", 3u); return;
+        case '@' : os.write("%40", 3u); return;
+        case '[' : os.write("%5B", 3u); return;
+        case ']' : os.write("%5D", 3u); return;
+        default  :
+        {
+            uint8_t* u = reinterpret_cast<uint8_t*>(&c);
+            os.put(*u);
+            return;
+        }
+    }
+}
+
+
+// http::server3::request_handler::url_decode before URI.h.
+bool url_decode(const std::string& in, std::string& out)
+{
+  out.clear();
+  out.reserve(in.size());
+  for (std::size_t i = 0; i < in.size(); ++i)
+  {
+    if (in[i] == '%')
+    {
+      if (i + 3 <= in.size())
+      {
+        int value = 0;
+        std::istringstream is(in.substr(i + 1, 2));
+        if (is >> std::hex >> value)
+        {
+          out += static_cast<char>(value);
+          i += 2;
+        }
+        else
+        {
+          return false;
+        }
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else if (in[i] == '+')
+    {
+      out += ' ';
+    }
+    else
+    {
+      out += in[i];
+    }
+  }
+  return true;
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+std::vector<std::pair<std::string, std::string> > generate(size_t inSize)
+{
+    std::mt19937 random(7);
+    std::vector<std::pair<std::string, std::string> > result;
+    const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~";
+
+    // Paths of words, with the odd query.
+    std::string text;
+    while (text.size() < inSize)
+    {
+        text += '/';
+        for (size_t length = 3 + random() % 12; length != 0; --length)
+        {
+            text += letters[random() % letters.size()];
+        }
+        if (random() % 8 == 0)
+        {
+            text += "?q=a+b&n=1";
+        }
+    }
+    text.resize(inSize);
+    result.push_back(std::make_pair("paths", text));
+
+    // One reserved character in four.
+    const std::string reserved = "!#$&'()*+,/:;=?@[]%";
+    for (char & c : text)
+    {
+        c = random() % 4 == 0 ? reserved[random() % reserved.size()] : letters[random() % letters.size()];
+    }
+    result.push_back(std::make_pair("reserved", text));
+
+    for (char & c : text)
+    {
+        c = static_cast<char>(random());
+    }
+    result.push_back(std::make_pair("random", text));
+    return result;
+}
+
+
+// The encoding byte by byte, with the table alone.
+std::string encode_reference(const std::string & inText, const URI::ByteSet & inEncode)
+{
+    std::string result;
+    for (char c : inText)
+    {
+        if (inEncode.contains(static_cast<uint8_t>(c)))
+        {
+            result += '%';
+            result += "0123456789ABCDEF"[static_cast<uint8_t>(c) >> 4];
+            result += "0123456789ABCDEF"[static_cast<uint8_t>(c) & 0x0F];
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+
+// The vector path must agree with the table for every set, non-ASCII bytes
+// included, wherever in a block the bytes are.
+void verify_vector_path()
+{
+    const URI::ByteSet sets[] = {
+        URI::ByteSet::reserved(),
+        URI::ByteSet::not_unreserved(),
+        URI::ByteSet("\xA7"),
+        URI::ByteSet(std::string("\x00\x80\xFF,%", 5)),
+        URI::ByteSet("\x7F\x80", true)
+    };
+    std::mt19937 random(11);
+    for (const URI::ByteSet & set : sets)
+    {
+        for (size_t size = 0; size != 200; ++size)
+        {
+            std::string text(size, 'a');
+            for (char & c : text)
+            {
+                c = static_cast<char>(random());
+            }
+            if (URI::encode(text, set) != encode_reference(text, set))
+            {
+                throw std::runtime_error("encode differs from the byte by byte reference for size " + std::to_string(size));
+            }
+        }
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+    verify_vector_path();
+
+    size_t size = 16 << 20;
+    if (!runner.options().arguments.empty())
+    {
+        size = std::strtoul(runner.options().arguments[0].c_str(), 0, 10);
+    }
+
+    for (const auto & input : generate(size))
+    {
+        const std::string prefix = input.first + "/";
+        const std::string & text = input.second;
+        const std::string encoded = URI::encode(text, URI::ByteSet::not_unreserved());
+        auto check = [&](const std::string & inName, bool inOk, const std::string & inDecoded)
+        {
+            if (!inOk || inDecoded != text)
+            {
+                throw std::runtime_error(inName + ": decoded text differs from the input");
+            }
+        };
+
+        runner.run_batch(prefix + "original_encode", text.size(), [&]
+        {
+            std::ostringstream out;
+            for (char c : text)
+            {
+                Original::encode(out, c);
+            }
+            Bench::DoNotOptimize(out.str().size());
+        }, 1);
+        runner.run_batch(prefix + "encode", text.size(), [&]
+        {
+            Bench::DoNotOptimize(URI::encode(text).size());
+        }, 1);
+        runner.run_batch(prefix + "encode_all", text.size(), [&]
+        {
+            Bench::DoNotOptimize(URI::encode(text, URI::ByteSet::not_unreserved()).size());
+        }, 1);
+        runner.run_batch(prefix + "original_decode", text.size(), [&]
+        {
+            std::string decoded;
+            check(prefix + "original_decode", Original::url_decode(encoded, decoded), decoded);
+        }, 1);
+        runner.run_batch(prefix + "decode", text.size(), [&]
+        {
+            std::string decoded;
+            check(prefix + "decode", URI::decode(encoded, decoded), decoded);
+        }, 1);
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef COPYKERNELS_H_INCLUDED
+#define COPYKERNELS_H_INCLUDED
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+
+/**
+ * Copy kernels for the bandwidth suite. All have the signature of memcpy
+ * minus the return value.
+ *
+ * The AVX2 and AVX-512 kernels are compiled with target attributes, so the
+ * file builds without -mavx2. Call them only if Supported() says so.
+ */
+namespace Copy {
+
+
+typedef void (*Kernel)(void * dst, const void * src, std::size_t n);
+
+
+inline void Memcpy(void * dst, const void * src, std::size_t n)
+{
+    std::memcpy(dst, src, n);
+}
+
+
+//! The microcoded string copy. Fast on CPUs with ERMSB, for large copies.
+inline void RepMovsb(void * dst, const void * src, std::size_t n)
+{
+    asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+
+/**
+ * Non-temporal stores: the destination bypasses the caches, which saves
+ * the read-for-ownership of every destination line. Only pays off when the
+ * destination would not fit into the cache anyway.
+ */
+inline void Stream(void * dst, const void * src, std::size_t n)
+{
+    char * d = static_cast<char*>(dst);
+    const char * s = static_cast<const char*>(src);
+
+    // Streaming stores must be aligned.
+    std::size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+    if (head > n)
+    {
+        head = n;
+    }
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+    }
+    _mm_sfence(); // make the streamed data visible before the tail and to other threads
+    std::memcpy(d, s, n);
+}
+
+
+__attribute__((target("avx2")))
+inline void AVX2(void * dst, const void * src, std::size_t n)
+{
+    char * d = static_cast<char*>(dst);
+    const char * s = static_cast<const char*>(src);
+    for (; n >= 128; n -= 128, d += 128, s += 128)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 64));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 32), b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 64), c);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + 96), e);
+    }
+    for (; n >= 32; n -= 32, d += 32, s += 32)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)));
+    }
+    std::memcpy(d, s, n);
+}
+
+
+__attribute__((target("avx512f")))
+inline void AVX512(void * dst, const void * src, std::size_t n)
+{
+    char * d = static_cast<char*>(dst);
+    const char * s = static_cast<const char*>(src);
+    for (; n >= 256; n -= 256, d += 256, s += 256)
+    {
+        __m512i a = _mm512_loadu_si512(s);
+        __m512i b = _mm512_loadu_si512(s + 64);
+        __m512i c = _mm512_loadu_si512(s + 128);
+        __m512i e = _mm512_loadu_si512(s + 192);
+        _mm512_storeu_si512(d, a);
+        _mm512_storeu_si512(d + 64, b);
+        _mm512_storeu_si512(d + 128, c);
+        _mm512_storeu_si512(d + 192, e);
+    }
+    for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+        _mm512_storeu_si512(d, _mm512_loadu_si512(s));
+    }
+    std::memcpy(d, s, n);
+}
+
+
+struct Entry
+{
+    const char * name;
+    Kernel kernel;
+    bool (*supported)();
+};
+
+
+inline bool Always() { return true; }
+inline bool HasAVX2() { return __builtin_cpu_supports("avx2"); }
+inline bool HasAVX512() { return __builtin_cpu_supports("avx512f"); }
+
+
+inline const Entry * Kernels(std::size_t & outCount)
+{
+    static const Entry cKernels[] = {
+        { "memcpy", &Memcpy, &Always },
+        { "rep_movsb", &RepMovsb, &Always },
+        { "stream", &Stream, &Always },
+        { "avx2", &AVX2, &HasAVX2 },
+        { "avx512", &AVX512, &HasAVX512 }
+    };
+    outCount = sizeof(cKernels) / sizeof(cKernels[0]);
+    return cKernels;
+}
+
+
+} // namespace Copy
+
+
+#endif // COPYKERNELS_H_INCLUDED
@@ -0,0 +1,508 @@
+#include "Benchmark.h"
+#include "CopyKernels.h"
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+
+// Copy bandwidth over copy sizes, thread counts and copy kernels.
+//
+// Every thread copies between its own source and destination buffer, so the
+// working set of one thread is twice the copy size, and the sizes in the
+// names and tables are per thread. One operation is one copy; the MB/s column
+// is the bandwidth of all threads together.
+//
+// The threads of a run are started before it is timed and wait on a barrier,
+// so a measurement covers the copies and not the thread creation.
+//
+// Extra options:
+//   --max-size=N      largest copy size in bytes (default 256 MB)
+//   --threads=1,2,4   thread counts (default: powers of two up to the core count)
+//   --kernels=a,b     subset of memcpy, rep_movsb, stream, avx2, avx512
+
+
+enum
+{
+    cMinSize = 16,
+    cBytesPerRepetition = 64 * 1024 * 1024 // per thread
+};
+
+
+std::string FormatSize(std::size_t inBytes)
+{
+    static const char * cUnits[] = { "B", "KB", "MB", "GB" };
+    unsigned unit = 0;
+    while (unit != 3 && inBytes >= 1024 && inBytes % 1024 == 0)
+    {
+        inBytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(inBytes) + cUnits[unit];
+}
+
+
+std::vector<std::string> Split(const std::string & inText)
+{
+    std::vector<std::string> result;
+    std::stringstream ss(inText);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        result.push_back(item);
+    }
+    return result;
+}
+
+
+struct Settings
+{
+    Settings() : max_size(256 * 1024 * 1024)
+    {
+        for (unsigned t = 1; t <= std::max(1u, std::thread::hardware_concurrency()); t *= 2)
+        {
+            threads.push_back(t);
+        }
+    }
+
+    void parse(const std::vector<std::string> & inArguments)
+    {
+        for (const std::string & arg : inArguments)
+        {
+            std::string::size_type eq = arg.find('=');
+            std::string key = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+            if (key == "--max-size")
+            {
+                max_size = std::strtoull(value.c_str(), 0, 10);
+            }
+            else if (key == "--threads")
+            {
+                threads.clear();
+                for (const std::string & t : Split(value))
+                {
+                    threads.push_back(std::max(1, std::atoi(t.c_str())));
+                }
+            }
+            else if (key == "--kernels")
+            {
+                kernels = Split(value);
+            }
+            else
+            {
+                throw std::runtime_error("Unknown argument: " + arg);
+            }
+        }
+    }
+
+    bool selected(const std::string & inKernel) const
+    {
+        return kernels.empty() || std::find(kernels.begin(), kernels.end(), inKernel) != kernels.end();
+    }
+
+    std::size_t max_size;
+    std::vector<unsigned> threads;
+    std::vector<std::string> kernels;
+};
+
+
+// Page-aligned buffer whose pages are touched up front, so that page faults
+// don't end up in the first measurement.
+struct Buffer
+{
+    explicit Buffer(std::size_t inSize) : mData(0)
+    {
+        if (posix_memalign(reinterpret_cast<void**>(&mData), 4096, std::max<std::size_t>(inSize, 1)) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        std::memset(mData, 1, inSize);
+    }
+
+    ~Buffer() { free(mData); }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    char * mData;
+};
+
+
+// Threads that are started once and then run jobs together. The caller is
+// thread 0. Between jobs the others spin, yielding, so that a job starts
+// with a store to an atomic rather than a wake-up.
+class Team
+{
+public:
+    explicit Team(unsigned inSize) :
+        mSize(inSize),
+        mJob(0),
+        mGeneration(0),
+        mArrived(0),
+        mDone(0),
+        mStop(false)
+    {
+        for (unsigned t = 1; t < inSize; ++t)
+        {
+            mThreads.push_back(std::thread([this, t] { work(t); }));
+        }
+    }
+
+    ~Team()
+    {
+        mStop.store(true);
+        for (auto & thread : mThreads)
+        {
+            thread.join();
+        }
+    }
+
+    Team(const Team&) = delete;
+    Team& operator=(const Team&) = delete;
+
+    //! Calls inJob(t) on every thread t once all of them are there, and
+    //! returns when all calls have returned.
+    void run(const std::function<void(unsigned)> & inJob)
+    {
+        mJob = &inJob;
+        const uint64_t generation = mGeneration.load(std::memory_order_relaxed) + 1;
+        mGeneration.store(generation, std::memory_order_release);
+        join(0, generation);
+        while (mDone.load(std::memory_order_acquire) != generation * mSize)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void work(unsigned inIndex)
+    {
+        for (uint64_t seen = 0; ; )
+        {
+            uint64_t generation;
+            while ((generation = mGeneration.load(std::memory_order_acquire)) == seen)
+            {
+                if (mStop.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            join(inIndex, generation);
+            seen = generation;
+        }
+    }
+
+    // The start barrier, then the job. The counters only grow, by mSize per
+    // job, so they need no reset between jobs.
+    void join(unsigned inIndex, uint64_t inGeneration)
+    {
+        mArrived.fetch_add(1, std::memory_order_acq_rel);
+        while (mArrived.load(std::memory_order_acquire) < inGeneration * mSize)
+        {
+            std::this_thread::yield();
+        }
+        (*mJob)(inIndex);
+        mDone.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    const unsigned mSize;
+    const std::function<void(unsigned)> * mJob;
+    std::atomic<uint64_t> mGeneration;
+    std::atomic<uint64_t> mArrived;
+    std::atomic<uint64_t> mDone;
+    std::atomic<bool> mStop;
+    std::vector<std::thread> mThreads;
+};
+
+
+struct CacheLevel
+{
+    std::string name;
+    std::size_t size;
+    unsigned sharing; // CPUs that share it
+};
+
+
+// The number of CPUs in a list like "0-3,8".
+unsigned CountCPUs(const std::string & inList)
+{
+    unsigned result = 0;
+    for (const std::string & range : Split(inList))
+    {
+        std::string::size_type dash = range.find('-');
+        unsigned first = std::atoi(range.c_str());
+        unsigned last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        result += last >= first ? last - first + 1 : 0;
+    }
+    return result;
+}
+
+
+// Data and unified caches of CPU 0, from sysfs.
+std::vector<CacheLevel> GetCaches()
+{
+    std::vector<CacheLevel> result;
+    for (unsigned index = 0; ; ++index)
+    {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(dir + "level"), type_file(dir + "type"), size_file(dir + "size"), shared_file(dir + "shared_cpu_list");
+        std::string level, type, size, shared;
+        if (!(level_file >> level) || !(type_file >> type) || !(size_file >> size))
+        {
+            break;
+        }
+        shared_file >> shared;
+        if (type == "Instruction")
+        {
+            continue;
+        }
+        std::size_t bytes = std::strtoull(size.c_str(), 0, 10);
+        char unit = size.empty() ? 0 : size[size.size() - 1];
+        bytes *= unit == 'K' ? 1024 : unit == 'M' ? 1024 * 1024 : 1;
+        CacheLevel cache = { "L" + level, bytes, std::max(1u, CountCPUs(shared)) };
+        result.push_back(cache);
+    }
+    return result;
+}
+
+
+std::string Name(const char * inKernel, std::size_t inSize, unsigned inThreads)
+{
+    return std::string("copy/") + inKernel + "/size:" + FormatSize(inSize) + "/threads:" + std::to_string(inThreads);
+}
+
+
+void RunSuite(Bench::Runner & runner, const Settings & settings, const std::vector<std::size_t> & sizes)
+{
+    std::size_t kernel_count;
+    const Copy::Entry * kernels = Copy::Kernels(kernel_count);
+
+    const std::size_t memory = std::size_t(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+
+    for (unsigned threads : settings.threads)
+    {
+        // Source and destination per thread, limited to half of the RAM.
+        std::size_t max_size = settings.max_size;
+        while (max_size > cMinSize && 2 * max_size * threads > memory / 2)
+        {
+            max_size /= 2;
+        }
+        if (max_size < settings.max_size)
+        {
+            std::cerr << "threads:" << threads << " is limited to " << FormatSize(max_size) << " by the amount of RAM." << std::endl;
+        }
+
+        std::vector<std::unique_ptr<Buffer>> src, dst;
+        for (unsigned t = 0; t != threads; ++t)
+        {
+            src.emplace_back(new Buffer(max_size));
+            dst.emplace_back(new Buffer(max_size));
+        }
+        Team team(threads);
+
+        for (std::size_t size : sizes)
+        {
+            if (size > max_size)
+            {
+                break;
+            }
+
+            const std::size_t iterations = std::max<std::size_t>(1, cBytesPerRepetition / size);
+            for (std::size_t k = 0; k != kernel_count; ++k)
+            {
+                const Copy::Entry & entry = kernels[k];
+                if (!settings.selected(entry.name) || !entry.supported())
+                {
+                    continue;
+                }
+
+                // Per thread time and counters, which --perf alone only gives for one thread.
+                const std::string name = Name(entry.name, size, threads);
+                Bench::Region & region = Bench::Region::Get(name);
+                std::function<void(unsigned)> copy = [&](unsigned t)
+                {
+                    Bench::Scope scope(region);
+                    void * d = dst[t]->mData;
+                    const void * s = src[t]->mData;
+                    for (std::size_t i = 0; i != iterations; ++i)
+                    {
+                        entry.kernel(d, s, size);
+                        Bench::ClobberMemory();
+                    }
+                };
+
+                // Thread 0 is this one, which stays on the pinned CPU, if any.
+                runner.run_batch(name, iterations * threads, [&] { team.run(copy); }, double(size));
+            }
+        }
+    }
+}
+
+
+struct Transition
+{
+    std::size_t fast; // index of the last size before the drop
+    std::size_t slow; // index of the first size after it
+};
+
+
+// Drops of more than a quarter compared to the plateau before. A drop that
+// is spread over consecutive sizes counts as one. Only looks past the peak:
+// below it, the call overhead dominates.
+std::vector<Transition> FindTransitions(const std::vector<double> & inBandwidth)
+{
+    std::vector<Transition> result;
+    std::size_t peak = std::max_element(inBandwidth.begin(), inBandwidth.end()) - inBandwidth.begin();
+    double plateau = inBandwidth[peak];
+    for (std::size_t i = peak + 1; i < inBandwidth.size(); ++i)
+    {
+        if (inBandwidth[i] < 0.75 * plateau)
+        {
+            if (!result.empty() && result.back().slow == i - 1)
+            {
+                result.back().slow = i;
+            }
+            else
+            {
+                Transition transition = { i - 1, i };
+                result.push_back(transition);
+            }
+            plateau = inBandwidth[i];
+        }
+        plateau = std::max(plateau, inBandwidth[i]);
+    }
+    return result;
+}
+
+
+void PrintSummary(std::ostream & os, const Bench::Runner & runner, const Settings & settings, const std::vector<std::size_t> & sizes)
+{
+    std::map<std::string, double> gbps;
+    for (const Bench::Result & result : runner.results())
+    {
+        gbps[result.name] = result.throughput() / 1e9;
+    }
+
+    std::size_t kernel_count;
+    const Copy::Entry * kernels = Copy::Kernels(kernel_count);
+
+    std::vector<CacheLevel> caches = GetCaches();
+    os << std::endl << "Caches of cpu0:";
+    for (const CacheLevel & cache : caches)
+    {
+        os << " " << cache.name << "=" << FormatSize(cache.size);
+        if (cache.sharing > 1)
+        {
+            os << " (" << cache.sharing << " CPUs)";
+        }
+    }
+    os << std::endl;
+
+    for (unsigned threads : settings.threads)
+    {
+        os << std::endl << "GB/s of " << threads << " thread(s) together, by copy size per thread" << std::endl << std::setw(10) << "size";
+        for (std::size_t k = 0; k != kernel_count; ++k)
+        {
+            if (settings.selected(kernels[k].name) && kernels[k].supported())
+            {
+                os << std::setw(11) << kernels[k].name;
+            }
+        }
+        os << std::endl;
+
+        std::vector<std::size_t> measured_sizes;
+        std::vector<double> memcpy_bandwidth;
+        for (std::size_t size : sizes)
+        {
+            std::ostringstream row;
+            row << std::setw(10) << FormatSize(size) << std::fixed << std::setprecision(2);
+            bool measured = false;
+            for (std::size_t k = 0; k != kernel_count; ++k)
+            {
+                if (settings.selected(kernels[k].name) && kernels[k].supported())
+                {
+                    auto it = gbps.find(Name(kernels[k].name, size, threads));
+                    measured = measured || it != gbps.end();
+                    if (it != gbps.end())
+                    {
+                        row << std::setw(11) << it->second;
+                    }
+                    else
+                    {
+                        row << std::setw(11) << "-";
+                    }
+                }
+            }
+            if (!measured)
+            {
+                continue;
+            }
+            os << row.str() << std::endl;
+
+            auto it = gbps.find(Name("memcpy", size, threads));
+            if (it != gbps.end())
+            {
+                measured_sizes.push_back(size);
+                memcpy_bandwidth.push_back(it->second);
+            }
+        }
+
+        if (memcpy_bandwidth.size() < 2)
+        {
+            continue;
+        }
+
+        // The working set of a thread is its source plus its destination. A
+        // cache shared by several CPUs holds the working sets of as many of
+        // the threads, assuming that they run on CPUs that share it.
+        for (const Transition & t : FindTransitions(memcpy_bandwidth))
+        {
+            std::size_t working_set = 2 * measured_sizes[t.fast];
+            std::string level = "DRAM";
+            for (const CacheLevel & cache : caches)
+            {
+                if (working_set * std::min(threads, cache.sharing) <= cache.size)
+                {
+                    level = cache.name;
+                    break;
+                }
+            }
+            os << "memcpy drops from " << memcpy_bandwidth[t.fast] << " GB/s at " << FormatSize(measured_sizes[t.fast])
+               << " to " << memcpy_bandwidth[t.slow] << " GB/s at " << FormatSize(measured_sizes[t.slow])
+               << " per thread: working set leaves " << level << " after " << FormatSize(working_set) << " per thread";
+            if (threads > 1)
+            {
+                os << ", " << FormatSize(working_set * threads) << " in total";
+            }
+            os << std::endl;
+        }
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
+    Settings settings;
+    settings.parse(runner.options().arguments);
+
+    std::vector<std::size_t> sizes;
+    for (std::size_t size = cMinSize; size <= settings.max_size; size *= 2)
+    {
+        sizes.push_back(size);
+    }
+
+    RunSuite(runner, settings, sizes);
+
+    // Keep JSON and CSV on stdout parseable.
+    bool text = runner.options().format == Bench::Options::cText || !runner.options().out.empty();
+    PrintSummary(text ? std::cout : std::cerr, runner, settings, sizes);
+}
@@ -1,16 +1,9 @@
+#include "Benchmark.h"
 #include <string.h>
-#include <iostream>
-#include <chrono>
 #include <vector>
-#include <thread>
-
-
-using namespace std::chrono;
-typedef std::chrono::high_resolution_clock Clock;
 
 
 long size = 1500;
-long iterations = 20 * 1000 * 1000;
 long cache_size  = 100;
 
 
@@ -26,7 +19,7 @@ static std::vector<void*> buf = []() -> std::vector<void*> {
 }();
 
 
-void* get(long size)
+void* get(long)
 {
 	static unsigned i = 0;
 	return buf[i++ % buf.size()];
@@ -41,20 +34,13 @@ void* src(long size) { return get(size); }
 
 
 
-int main()
+int main(int argc, char** argv)
 {
-    
-    auto start = Clock::now();
+    Bench::Runner runner(argc, argv);
 
-    for (long i = 0; i != iterations; ++i)
+    runner.run("memcpy/" + std::to_string(size), [&]
     {
 		memcpy(dst(size), src(size), size);
-    }
-
-    auto us = duration_cast<microseconds>(Clock::now() - start).count();
-
-
-    auto mbps = 8.0 * iterations * size / us;
-    auto gbps = static_cast<int>(0.5 + mbps / 10.0) / 100.0;
-    std::cout << gbps << "Gbps" << std::endl;
+        Bench::ClobberMemory();
+    }, size);
 }
@@ -1,63 +1,56 @@
+#include "Benchmark.h"
 #include <string.h>
 #include <stdexcept>
 #include <future>
-#include <iostream>
-#include <chrono>
 #include <vector>
 #include <thread>
 
 
-using namespace std::chrono;
-using Clock = std::chrono::high_resolution_clock;
-
-
 
 int main(int argc, char** argv)
 {
-	if (argc != 2)
+    Bench::Runner runner(argc, argv);
+	if (runner.options().arguments.size() != 1)
     {
         throw std::runtime_error("Invalid argument count.");
     }
 
-	int thread_count = atoi(argv[1]);
+	int thread_count = atoi(runner.options().arguments[0].c_str());
 
-	if (thread_count < 1 && thread_count > 20)
+	if (thread_count < 1 || thread_count > 20)
     {
-        throw std::runtime_error(std::string("Invalid thread count: ") + argv[1]);
+        throw std::runtime_error("Invalid thread count: " + runner.options().arguments[0]);
     }
 
 
-	std::cout << "Number of threads: " << thread_count << ' ' << std::flush;
     long size = 2048;
-    long iterations = 10 * 1000 * 1000;
+    long iterations = 1000 * 1000;
     
     auto src = malloc(size);
     memset(src, 0, size);
 
 
-    auto test = [&]() -> long
+    auto test = [&]()
     {
         auto dst = malloc(size);
-        auto start = Clock::now();
         for (long i = 0; i != iterations; ++i)
         {
             memcpy(dst, src, size);
+            Bench::ClobberMemory();
         }
-        return duration_cast<microseconds>(Clock::now() - start).count();
+        free(dst);
     };
 
 
-    std::vector<std::future<long>> futures;
-    for (int i = 0; i != thread_count; ++i)
+    // One operation is one memcpy, so the throughput is the total over all threads.
+    runner.run_batch("memcpy/" + std::to_string(size) + "/threads:" + std::to_string(thread_count),
+                     thread_count * iterations, [&]
     {
-        futures.push_back(std::async(std::launch::async, test));
-    }
-
-    long total_time = 0;
-    for (auto& fut : futures) total_time += fut.get();
-
-
-    auto megabyte_per_second = futures.size() * iterations * size / total_time;
-
-    std::cout << megabyte_per_second << "MB/s" << std::endl;
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i != thread_count; ++i)
+        {
+            futures.push_back(std::async(std::launch::async, test));
+        }
+        for (auto& fut : futures) fut.get();
+    }, size);
 }
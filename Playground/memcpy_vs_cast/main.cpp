@@ -1,3 +1,4 @@
+#include "Benchmark.h"
 #include <algorithm>
 #include <cstdlib>
 #include <cstdio>
@@ -9,28 +10,8 @@
 #include <memory>
 #include <stdexcept>
 #include <vector>
-#include <chrono>
 #include <cxxabi.h> // for demangler
 
-class Stopwatch
-{
-public:
-    typedef std::chrono::high_resolution_clock Clock;
-
-    //! Constructor starts the stopwatch
-    Stopwatch() : mStart(Clock::now())
-    {
-    }
-
-    //! Returns elapsed number of seconds in decimal form.
-    double elapsed()
-    {
-        return 1.0 * (Clock::now() - mStart).count() / Clock::period::den;
-    }
-
-    Clock::time_point mStart;
-};
-
 struct test_cast
 {
     int operator()(const char * data) const
@@ -104,48 +85,32 @@ std::string demangle(const char * name)
 
 
 //! Benchmarks the time required to parse the binary data.
-//! Returns time elapsed in milliseconds.
+//! One operation is the parsing of one integer.
 template<typename Function>
-unsigned benchmark(const Function & function, unsigned & counter)
+void benchmark(Bench::Runner & runner, const Function & function)
 {
     std::vector<char> binary_data = get_binary_data();
-    Stopwatch sw;
-    for (unsigned iter = 0; iter != iterations; ++iter)
+    runner.run_batch(demangle(typeid(Function).name()), iterations * container_size, [&]
     {
-        for (unsigned i = 0; i != binary_data.size(); i += 4)
+        unsigned counter = 0;
+        for (unsigned iter = 0; iter != iterations; ++iter)
         {
-            const char * c = reinterpret_cast<const char*>(&binary_data[i]);
-            counter += function(c);
+            for (unsigned i = 0; i != binary_data.size(); i += 4)
+            {
+                const char * c = reinterpret_cast<const char*>(&binary_data[i]);
+                counter += function(c);
+            }
         }
-    }
-    return static_cast<unsigned>(0.5 + 1000.0 * sw.elapsed());
-}
-
-template<typename Function>
-void print_time(const Function & function, unsigned & counter)
-{
-    auto elapsedMs = benchmark(function, counter);
-    auto functionName = demangle(typeid(Function).name());
-    std::cout << functionName << std::setw(18 - functionName.size()) << elapsedMs << " ms" << std::endl;
+        Bench::DoNotOptimize(counter);
+    });
 }
 
-int main()
+int main(int argc, char ** argv)
 {
-    srand(time(0));
-
-    // The counter is introduced to prevent the compiler
-    // from optimizating *everything* away.
-    unsigned counter = 0;
-
-    // Print the times for the different strategies.
-    print_time(test_cast(),     counter);
-    print_time(test_memcpy(),   counter);
-    print_time(test_memmove(),  counter);
-    print_time(test_std_copy(), counter);
-
-    // Printing the counter to stdout prevents the compiler from
-    // optimizing away the inner loop of the benchmark function.
-    std::cout << "(counter:  " << counter << ")" << std::endl << std::endl;
+    Bench::Runner runner(argc, argv);
 
+    benchmark(runner, test_cast());
+    benchmark(runner, test_memcpy());
+    benchmark(runner, test_memmove());
+    benchmark(runner, test_std_copy());
 }
-
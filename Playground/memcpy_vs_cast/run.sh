@@ -1,6 +1,6 @@
 
 for i in `seq 0 3 `; do
-    COMMAND="g++ -o test -std=c++0x -O$i -Wall -Werror -Wextra -pedantic-errors main.cpp"
+    COMMAND="g++ -o test -std=c++0x -O$i -Wall -Werror -Wextra -pedantic-errors -I../Benchmark main.cpp"
     echo $COMMAND
     $COMMAND && ./test
 done
@@ -0,0 +1,328 @@
+#ifndef RUNLENGTH_H_INCLUDED
+#define RUNLENGTH_H_INCLUDED
+
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Run-length coding of arbitrary bytes, in the PackBits format: a stream of
+ * codes, each one control byte c followed by its data.
+ *
+ *   c in [0, 127]:   a literal, the next c + 1 bytes are copied as they are
+ *   c in [128, 255]: a run, the next byte repeated c - 126 times (2 to 129)
+ *
+ * Unlike "3a", this cannot be confused with data, and incompressible input
+ * grows by one byte in 128 only. Runs shorter than three bytes are left in
+ * the literals, where they cost nothing extra.
+ *
+ * The streams are coded in blocks. A run across a block boundary becomes
+ * two runs, which the decoder does not need to know about.
+ */
+namespace RunLength {
+
+
+enum { cBlockSize = 1 << 20 };
+
+
+namespace Detail {
+
+
+enum { cMaxLiteral = 128, cMaxRun = 129 };
+
+
+#if defined(__AVX2__)
+enum { cVectorSize = 32 };
+
+// Bit k is set if a[k] == b[k], for k in [0, cVectorSize).
+inline uint32_t equal_mask(const uint8_t * a, const uint8_t * b)
+{
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+}
+#elif defined(__SSE2__)
+enum { cVectorSize = 16 };
+
+inline uint32_t equal_mask(const uint8_t * a, const uint8_t * b)
+{
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+}
+#else
+enum { cVectorSize = 8 };
+
+inline uint32_t equal_mask(const uint8_t * a, const uint8_t * b)
+{
+    uint32_t result = 0;
+    for (unsigned k = 0; k != cVectorSize; ++k)
+    {
+        result |= uint32_t(a[k] == b[k]) << k;
+    }
+    return result;
+}
+#endif
+
+const uint32_t cFullMask = cVectorSize == 32 ? ~uint32_t(0) : (uint32_t(1) << cVectorSize) - 1;
+
+
+// The first k in [p, end) where three equal bytes start, or end.
+inline const uint8_t * find_run_scalar(const uint8_t * p, const uint8_t * end)
+{
+    for (; end - p >= 3; ++p)
+    {
+        if (p[0] == p[1] && p[1] == p[2])
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+
+// One past the run of p[0] that starts at p.
+inline const uint8_t * run_end_scalar(const uint8_t * p, const uint8_t * end)
+{
+    const uint8_t * q = p + 1;
+    while (q != end && *q == *p)
+    {
+        ++q;
+    }
+    return q;
+}
+
+
+// The block compared with itself shifted by one byte: the bits of
+// equal_mask(p, p + 1) mark where a byte equals its successor.
+inline const uint8_t * find_run(const uint8_t * p, const uint8_t * end)
+{
+    for (; end - p >= cVectorSize + 2; p += cVectorSize)
+    {
+        uint32_t starts = equal_mask(p, p + 1) & equal_mask(p + 1, p + 2);
+        if (starts != 0)
+        {
+            return p + __builtin_ctz(starts);
+        }
+    }
+    return find_run_scalar(p, end);
+}
+
+
+inline const uint8_t * run_end(const uint8_t * p, const uint8_t * end)
+{
+    const uint8_t * q = p;
+    for (; end - q >= cVectorSize + 1; q += cVectorSize)
+    {
+        uint32_t equal = equal_mask(q, q + 1);
+        if (equal != cFullMask)
+        {
+            return q + __builtin_ctz(~equal) + 1;
+        }
+    }
+    return run_end_scalar(q, end);
+}
+
+
+inline void put_literal(const uint8_t * p, const uint8_t * end, std::vector<uint8_t> & ioOutput)
+{
+    while (p != end)
+    {
+        size_t length = std::min<size_t>(end - p, cMaxLiteral);
+        ioOutput.push_back(static_cast<uint8_t>(length - 1));
+        ioOutput.insert(ioOutput.end(), p, p + length);
+        p += length;
+    }
+}
+
+
+inline void put_run(uint8_t inByte, size_t inLength, std::vector<uint8_t> & ioOutput)
+{
+    while (inLength >= 2)
+    {
+        size_t length = std::min<size_t>(inLength, cMaxRun);
+        ioOutput.push_back(static_cast<uint8_t>(length + 126));
+        ioOutput.push_back(inByte);
+        inLength -= length;
+    }
+    if (inLength == 1)
+    {
+        ioOutput.push_back(0);
+        ioOutput.push_back(inByte);
+    }
+}
+
+
+template<const uint8_t * (*FindRun)(const uint8_t *, const uint8_t *), const uint8_t * (*RunEnd)(const uint8_t *, const uint8_t *)>
+void encode(const uint8_t * inData, size_t inSize, std::vector<uint8_t> & ioOutput)
+{
+    const uint8_t * p = inData;
+    const uint8_t * end = inData + inSize;
+    ioOutput.reserve(ioOutput.size() + inSize + inSize / cMaxLiteral + 2);
+    while (p != end)
+    {
+        const uint8_t * run = FindRun(p, end);
+        put_literal(p, run, ioOutput);
+        if (run == end)
+        {
+            break;
+        }
+        p = RunEnd(run, end);
+        put_run(*run, p - run, ioOutput);
+    }
+}
+
+
+} // namespace Detail
+
+
+//! Appends the codes for inData to ioOutput.
+inline void encode(const uint8_t * inData, size_t inSize, std::vector<uint8_t> & ioOutput)
+{
+    Detail::encode<Detail::find_run, Detail::run_end>(inData, inSize, ioOutput);
+}
+
+
+//! encode() one byte at a time, for comparison.
+inline void encode_scalar(const uint8_t * inData, size_t inSize, std::vector<uint8_t> & ioOutput)
+{
+    Detail::encode<Detail::find_run_scalar, Detail::run_end_scalar>(inData, inSize, ioOutput);
+}
+
+
+/**
+ * Decodes a stream that arrives in pieces of any size: a code may be split
+ * across calls to decode().
+ */
+class Decoder
+{
+public:
+    Decoder() : mLiteral(0), mRun(0) {}
+
+    //! Appends the bytes decoded from inCodes to ioOutput.
+    void decode(const uint8_t * inCodes, size_t inSize, std::vector<uint8_t> & ioOutput)
+    {
+        const uint8_t * p = inCodes;
+        const uint8_t * end = inCodes + inSize;
+        while (p != end)
+        {
+            if (mLiteral != 0)
+            {
+                size_t length = std::min<size_t>(mLiteral, end - p);
+                ioOutput.insert(ioOutput.end(), p, p + length);
+                p += length;
+                mLiteral -= static_cast<unsigned>(length);
+            }
+            else if (mRun != 0)
+            {
+                ioOutput.insert(ioOutput.end(), mRun, *p++);
+                mRun = 0;
+            }
+            else
+            {
+                uint8_t code = *p++;
+                if (code < Detail::cMaxLiteral)
+                {
+                    mLiteral = code + 1u;
+                }
+                else
+                {
+                    mRun = code - 126u;
+                }
+            }
+        }
+    }
+
+    //! Throws std::runtime_error if the input ended inside a code.
+    void finish() const
+    {
+        if (mLiteral != 0 || mRun != 0)
+        {
+            throw std::runtime_error("RunLength: truncated input");
+        }
+    }
+
+private:
+    unsigned mLiteral; // literal bytes still to come
+    unsigned mRun;     // length of the run whose byte comes next
+};
+
+
+//! The number of bytes that a complete stream decodes to, from its control bytes alone.
+inline size_t decoded_size(const uint8_t * inCodes, size_t inSize)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < inSize; )
+    {
+        uint8_t code = inCodes[i];
+        if (code < Detail::cMaxLiteral)
+        {
+            result += code + 1u;
+            i += code + 2u;
+        }
+        else
+        {
+            result += code - 126u;
+            i += 2;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Decodes a complete stream. The output is reserved up front: growing it
+ * as it goes made decoding two to three times slower.
+ */
+inline void decode(const uint8_t * inCodes, size_t inSize, std::vector<uint8_t> & ioOutput)
+{
+    ioOutput.reserve(ioOutput.size() + decoded_size(inCodes, inSize));
+    Decoder decoder;
+    decoder.decode(inCodes, inSize, ioOutput);
+    decoder.finish();
+}
+
+
+//! Encodes inInput to outOutput, one block at a time.
+inline void encode(std::istream & inInput, std::ostream & outOutput)
+{
+    std::vector<uint8_t> block(cBlockSize);
+    std::vector<uint8_t> codes;
+    while (inInput.read(reinterpret_cast<char*>(block.data()), block.size()) || inInput.gcount() != 0)
+    {
+        codes.clear();
+        encode(block.data(), static_cast<size_t>(inInput.gcount()), codes);
+        outOutput.write(reinterpret_cast<const char*>(codes.data()), codes.size());
+    }
+}
+
+
+//! Decodes inInput to outOutput, one block at a time.
+inline void decode(std::istream & inInput, std::ostream & outOutput)
+{
+    std::vector<uint8_t> block(cBlockSize);
+    std::vector<uint8_t> bytes;
+    Decoder decoder;
+    while (inInput.read(reinterpret_cast<char*>(block.data()), block.size()) || inInput.gcount() != 0)
+    {
+        bytes.clear();
+        decoder.decode(block.data(), static_cast<size_t>(inInput.gcount()), bytes);
+        outOutput.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    decoder.finish();
+}
+
+
+} // namespace RunLength
+
+
+#endif // RUNLENGTH_H_INCLUDED
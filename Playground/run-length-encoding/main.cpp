@@ -1,23 +1,29 @@
+#include "RunLength.h"
 #include <iostream>
-#include <stdint.h>
+#include <string>
 
-int main()
+
+// Run-length codes stdin to stdout, see RunLength.h.
+//
+//   rle        encode
+//   rle -d     decode
+int main(int argc, char ** argv)
 {
-    char c, next;
-    int count = 1;
-    std::cin.read(&c, 1);
-    while (std::cin.read(&next, 1))
+    std::ios::sync_with_stdio(false);
+    try
     {
-        if (next == c)
+        if (argc > 1 && std::string(argv[1]) == "-d")
         {
-            count++;
+            RunLength::decode(std::cin, std::cout);
         }
         else
         {
-            std::cout << count << c;
-            c = next;
-            count = 1;
+            RunLength::encode(std::cin, std::cout);
         }
     }
-    std::cout << next;
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 }
@@ -0,0 +1,377 @@
+#ifndef SEGMENTER_H_INCLUDED
+#define SEGMENTER_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Splits concatenated words, like hostnames and hashtags, into dictionary
+ * words: "stackoverflow" becomes "stack overflow".
+ *
+ * The dictionary is compiled into a double-array trie. Every state is one
+ * cell, and the transition on character code c from state s goes to cell
+ * base(s) + c, which belongs to s if its check is s. So a step is an
+ * addition and a comparison in one small array, with no pointers to chase.
+ *
+ * The segmentation is the cheapest one (Viterbi): a word costs -log of its
+ * frequency, and a character that starts no word is skipped as a word of
+ * its own at a high cost. Without counts in the word list, all words are
+ * equally likely and the fewest words win.
+ */
+namespace WordSplitting {
+
+
+class Segmenter
+{
+public:
+    //! Scratch space for segment(), to be reused between calls on one thread.
+    struct Workspace
+    {
+        std::vector<float> cost;
+        std::vector<uint32_t> start;
+    };
+
+    /**
+     * Reads a word list with one word per line, optionally followed by its
+     * count. Upper and lower case are the same.
+     */
+    explicit Segmenter(std::istream & inWords)
+    {
+        std::map<std::string, double> counts;
+        double total = 0;
+        std::string line;
+        while (std::getline(inWords, line))
+        {
+            std::istringstream fields(line);
+            std::string word;
+            double count = 1;
+            if (!(fields >> word))
+            {
+                continue;
+            }
+            fields >> count;
+            for (char & c : word)
+            {
+                c = fold(c);
+            }
+            counts[word] += count;
+            total += count;
+        }
+        if (counts.empty())
+        {
+            throw std::runtime_error("Segmenter: empty word list");
+        }
+        build(counts, total);
+    }
+
+    /**
+     * Stores in outEnds where the words of [inText, inText + inSize) end,
+     * the last one at inSize.
+     */
+    void segment(const char * inText, size_t inSize, Workspace & ioWorkspace, std::vector<uint32_t> & outEnds) const
+    {
+        std::vector<float> & cost = ioWorkspace.cost;
+        std::vector<uint32_t> & start = ioWorkspace.start;
+        cost.assign(inSize + 1, std::numeric_limits<float>::infinity());
+        start.resize(inSize + 1);
+        cost[0] = 0;
+
+        const Cell * cells = mCells.data();
+        const uint32_t cell_count = static_cast<uint32_t>(mCells.size());
+        for (size_t j = 0; j != inSize; ++j)
+        {
+            const float before = cost[j];
+            relax(cost, start, j + 1, before + mUnknownCost, j);
+
+            int32_t state = 0;
+            for (size_t i = j; i != inSize; ++i)
+            {
+                uint8_t code = mCodes[static_cast<uint8_t>(inText[i])];
+                uint32_t next = static_cast<uint32_t>(cells[state].base + code);
+                if (code == 0 || next >= cell_count || cells[next].check != state)
+                {
+                    break;
+                }
+                state = static_cast<int32_t>(next);
+                relax(cost, start, i + 1, before + cells[state].cost, j);
+            }
+        }
+
+        outEnds.clear();
+        for (size_t i = inSize; i != 0; i = start[i])
+        {
+            outEnds.push_back(static_cast<uint32_t>(i));
+        }
+        std::reverse(outEnds.begin(), outEnds.end());
+    }
+
+    //! inText with a space between the words.
+    std::string segment(const std::string & inText, Workspace & ioWorkspace) const
+    {
+        std::vector<uint32_t> ends;
+        segment(inText.data(), inText.size(), ioWorkspace, ends);
+        return join(inText, ends);
+    }
+
+    std::string segment(const std::string & inText) const
+    {
+        Workspace workspace;
+        return segment(inText, workspace);
+    }
+
+    /**
+     * segment() for every text, on inThreadCount threads. The threads claim
+     * the texts in chunks from a shared counter, and each has a workspace of
+     * its own.
+     */
+    std::vector<std::string> segment(const std::vector<std::string> & inTexts, unsigned inThreadCount = std::thread::hardware_concurrency()) const
+    {
+        const size_t cChunkSize = 256;
+        std::vector<std::string> result(inTexts.size());
+        std::atomic<size_t> next(0);
+        auto worker = [&]
+        {
+            Workspace workspace;
+            std::vector<uint32_t> ends;
+            for (size_t begin; (begin = next.fetch_add(cChunkSize, std::memory_order_relaxed)) < inTexts.size(); )
+            {
+                for (size_t i = begin, end = std::min(begin + cChunkSize, inTexts.size()); i != end; ++i)
+                {
+                    segment(inTexts[i].data(), inTexts[i].size(), workspace, ends);
+                    result[i] = join(inTexts[i], ends);
+                }
+            }
+        };
+
+        const size_t chunk_count = (inTexts.size() + cChunkSize - 1) / cChunkSize;
+        const unsigned thread_count = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(inThreadCount, chunk_count)));
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < thread_count; ++t)
+        {
+            threads.push_back(std::thread(worker));
+        }
+        worker();
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+        return result;
+    }
+
+    size_t word_count() const { return mWordCount; }
+
+    //! The number of cells in the double array, used or not.
+    size_t cell_count() const { return mCells.size(); }
+
+private:
+    struct Cell
+    {
+        int32_t base;  // the children of this state are at base + code
+        int32_t check; // the parent state, or -1 for a free cell
+        float cost;    // of the word that ends here, infinity if none does
+    };
+
+    // A node of the trie that the double array is built from.
+    struct Node
+    {
+        std::vector<std::pair<uint8_t, uint32_t> > children; // code, node
+        float cost;
+    };
+
+    static char fold(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static void relax(std::vector<float> & ioCost, std::vector<uint32_t> & ioStart, size_t inEnd, float inCost, size_t inStart)
+    {
+        if (inCost < ioCost[inEnd])
+        {
+            ioCost[inEnd] = inCost;
+            ioStart[inEnd] = static_cast<uint32_t>(inStart);
+        }
+    }
+
+    static std::string join(const std::string & inText, const std::vector<uint32_t> & inEnds)
+    {
+        std::string result;
+        result.reserve(inText.size() + inEnds.size());
+        uint32_t begin = 0;
+        for (uint32_t end : inEnds)
+        {
+            if (begin != 0)
+            {
+                result += ' ';
+            }
+            result.append(inText.data() + begin, end - begin);
+            begin = end;
+        }
+        return result;
+    }
+
+    void build(const std::map<std::string, double> & inCounts, double inTotal)
+    {
+        // Codes from 1 up for the characters that occur, in both cases.
+        std::fill(mCodes, mCodes + 256, 0);
+        uint8_t code_count = 0;
+        for (const auto & entry : inCounts)
+        {
+            for (char c : entry.first)
+            {
+                uint8_t & code = mCodes[static_cast<uint8_t>(c)];
+                if (code == 0)
+                {
+                    if (code_count == 255)
+                    {
+                        throw std::runtime_error("Segmenter: too many distinct characters");
+                    }
+                    code = ++code_count;
+                }
+            }
+        }
+        for (char c = 'A'; c <= 'Z'; ++c)
+        {
+            mCodes[static_cast<uint8_t>(c)] = mCodes[static_cast<uint8_t>(fold(c))];
+        }
+
+        // The trie, with the children in code order.
+        const float cNone = std::numeric_limits<float>::infinity();
+        std::vector<Node> nodes(1);
+        nodes[0].cost = cNone;
+        float max_cost = 0;
+        for (const auto & entry : inCounts)
+        {
+            uint32_t node = 0;
+            for (char c : entry.first)
+            {
+                uint8_t code = mCodes[static_cast<uint8_t>(c)];
+                auto & children = nodes[node].children;
+                auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(code, uint32_t(0)));
+                if (it != children.end() && it->first == code)
+                {
+                    node = it->second;
+                    continue;
+                }
+                // The new node goes last, after which children may be gone.
+                node = static_cast<uint32_t>(nodes.size());
+                children.insert(it, std::make_pair(code, node));
+                Node child;
+                child.cost = cNone;
+                nodes.push_back(child);
+            }
+            nodes[node].cost = static_cast<float>(std::log(inTotal / entry.second));
+            max_cost = std::max(max_cost, nodes[node].cost);
+        }
+        mWordCount = inCounts.size();
+        mUnknownCost = 2 * max_cost + 1;
+
+        // Breadth first, every node gets the first base from the first free
+        // cell on where all its children fit. next_free[i] leads to the first
+        // free cell from i on, with the paths shortened as they are followed,
+        // so the search skips the filled part of the array.
+        Cell free_cell = { 0, -1, cNone };
+        std::vector<uint32_t> next_free;
+        auto grow = [&](size_t inSize)
+        {
+            while (mCells.size() < inSize)
+            {
+                next_free.push_back(static_cast<uint32_t>(mCells.size()));
+                mCells.push_back(free_cell);
+            }
+        };
+        auto find_free = [&](uint32_t i)
+        {
+            grow(i + 1);
+            uint32_t root = i;
+            while (next_free[root] != root)
+            {
+                root = next_free[root];
+                grow(root + 1);
+            }
+            while (next_free[i] != root)
+            {
+                uint32_t next = next_free[i];
+                next_free[i] = root;
+                i = next;
+            }
+            return root;
+        };
+        auto fits = [&](int32_t inBase, const std::vector<std::pair<uint8_t, uint32_t> > & inChildren)
+        {
+            grow(inBase + 256);
+            for (const auto & child : inChildren)
+            {
+                if (mCells[inBase + child.first].check != -1)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        grow(256);
+        mCells[0].check = 0;
+        mCells[0].cost = nodes[0].cost;
+        next_free[0] = 1;
+        std::vector<std::pair<uint32_t, int32_t> > queue(1, std::make_pair(0u, 0)); // node, cell
+        for (size_t q = 0; q != queue.size(); ++q)
+        {
+            const Node & node = nodes[queue[q].first];
+            const int32_t cell = queue[q].second;
+            if (node.children.empty())
+            {
+                continue;
+            }
+
+            const uint8_t first_code = node.children[0].first;
+            int32_t base = 0;
+            for (uint32_t pos = find_free(first_code + 1); ; pos = find_free(pos + 1))
+            {
+                base = static_cast<int32_t>(pos) - first_code;
+                if (fits(base, node.children))
+                {
+                    break;
+                }
+            }
+
+            mCells[cell].base = base;
+            for (const auto & child : node.children)
+            {
+                const int32_t target = base + child.first;
+                mCells[target].check = cell;
+                mCells[target].cost = nodes[child.second].cost;
+                next_free[target] = target + 1;
+                queue.push_back(std::make_pair(child.second, target));
+            }
+        }
+        while (!mCells.empty() && mCells.back().check == -1)
+        {
+            mCells.pop_back();
+        }
+    }
+
+    uint8_t mCodes[256]; // 0 for characters that occur in no word
+    std::vector<Cell> mCells;
+    size_t mWordCount;
+    float mUnknownCost;
+};
+
+
+} // namespace WordSplitting
+
+
+#endif // SEGMENTER_H_INCLUDED
@@ -0,0 +1,212 @@
+#include "Benchmark.h"
+#include "Segmenter.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+// Segmentation throughput: the same cheapest segmentation with a hash
+// lookup of every substring, against the double-array trie of Segmenter.h
+// on one and more threads. One operation is one text.
+//
+//   benchmark [count]     (default 100000)
+//
+// The texts are two to four random words from words.txt run together, one
+// in eight followed by digits. Every result must match the baseline.
+
+
+namespace Baseline {
+
+
+class Segmenter
+{
+public:
+    explicit Segmenter(std::istream & inWords) : mMaxLength(0)
+    {
+        std::vector<std::string> words;
+        std::string line;
+        while (std::getline(inWords, line))
+        {
+            std::istringstream fields(line);
+            std::string word;
+            if (fields >> word)
+            {
+                words.push_back(word);
+            }
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        const float cost = static_cast<float>(std::log(double(words.size())));
+        for (const std::string & word : words)
+        {
+            mCosts[word] = cost;
+            mMaxLength = std::max(mMaxLength, word.size());
+        }
+        mUnknownCost = 2 * cost + 1;
+    }
+
+    std::string segment(const std::string & inText) const
+    {
+        std::string text = inText;
+        std::transform(text.begin(), text.end(), text.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; });
+
+        const size_t n = text.size();
+        std::vector<float> cost(n + 1, std::numeric_limits<float>::infinity());
+        std::vector<size_t> start(n + 1);
+        cost[0] = 0;
+        for (size_t j = 0; j != n; ++j)
+        {
+            relax(cost, start, j + 1, cost[j] + mUnknownCost, j);
+            for (size_t length = 1; length <= std::min(mMaxLength, n - j); ++length)
+            {
+                auto it = mCosts.find(text.substr(j, length));
+                if (it != mCosts.end())
+                {
+                    relax(cost, start, j + length, cost[j] + it->second, j);
+                }
+            }
+        }
+
+        std::vector<size_t> ends;
+        for (size_t i = n; i != 0; i = start[i])
+        {
+            ends.push_back(i);
+        }
+        std::string result;
+        size_t begin = 0;
+        for (auto it = ends.rbegin(); it != ends.rend(); ++it)
+        {
+            if (begin != 0)
+            {
+                result += ' ';
+            }
+            result += inText.substr(begin, *it - begin);
+            begin = *it;
+        }
+        return result;
+    }
+
+private:
+    static void relax(std::vector<float> & ioCost, std::vector<size_t> & ioStart, size_t inEnd, float inCost, size_t inStart)
+    {
+        if (inCost < ioCost[inEnd])
+        {
+            ioCost[inEnd] = inCost;
+            ioStart[inEnd] = inStart;
+        }
+    }
+
+    std::unordered_map<std::string, float> mCosts;
+    size_t mMaxLength;
+    float mUnknownCost;
+};
+
+
+} // namespace Baseline
+
+
+namespace {
+
+
+std::vector<std::string> generate(const std::string & inWordsFile, size_t inCount)
+{
+    std::ifstream file(inWordsFile);
+    std::vector<std::string> words;
+    for (std::string word; file >> word; )
+    {
+        words.push_back(word);
+    }
+
+    std::mt19937 random(7);
+    std::vector<std::string> result;
+    for (size_t i = 0; i != inCount; ++i)
+    {
+        std::string text;
+        for (unsigned n = 2 + random() % 3; n != 0; --n)
+        {
+            text += words[random() % words.size()];
+        }
+        if (random() % 8 == 0)
+        {
+            text += std::to_string(random() % 10000);
+        }
+        result.push_back(text);
+    }
+    return result;
+}
+
+
+void check(const std::string & inName, const std::vector<std::string> & inValue, const std::vector<std::string> & inExpected)
+{
+    if (inValue != inExpected)
+    {
+        throw std::runtime_error(inName + ": segmentation differs from the baseline");
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
+    size_t count = 100000;
+    if (!runner.options().arguments.empty())
+    {
+        count = std::strtoul(runner.options().arguments[0].c_str(), 0, 10);
+    }
+
+    std::ifstream words("words.txt");
+    if (!words)
+    {
+        throw std::runtime_error("Cannot open words.txt");
+    }
+    const WordSplitting::Segmenter segmenter(words);
+    words.clear();
+    words.seekg(0);
+    const Baseline::Segmenter baseline(words);
+
+    const std::vector<std::string> texts = generate("words.txt", count);
+    std::vector<std::string> expected;
+    double bytes = 0;
+    for (const std::string & text : texts)
+    {
+        expected.push_back(baseline.segment(text));
+        bytes += text.size();
+    }
+    const double bytes_per_text = bytes / std::max<size_t>(1, texts.size());
+
+    runner.run_batch("baseline", texts.size(), [&]
+    {
+        std::vector<std::string> result;
+        result.reserve(texts.size());
+        for (const std::string & text : texts)
+        {
+            result.push_back(baseline.segment(text));
+        }
+        check("baseline", result, expected);
+    }, bytes_per_text);
+
+    const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const std::string name = "segment/threads=" + std::to_string(threads);
+        runner.run_batch(name, texts.size(), [&]
+        {
+            check(name, segmenter.segment(texts, threads), expected);
+        }, bytes_per_text);
+    }
+}
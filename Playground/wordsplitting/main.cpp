@@ -1,19 +1,34 @@
-#include <bitset>
+#include "Segmenter.h"
+#include <fstream>
 #include <iostream>
+#include <string>
 
 
-#define TRACE std::cout << __PRETTY_FUNCTION__ << std::endl;
-
-enum
+// Splits every argument, or every word on stdin without any, into the
+// words of words.txt. Prints one result per line.
+int main(int argc, char ** argv)
 {
-    fin = (1 << 1),
-    syn = (1 << 2),
-    ack = (1 << 3)
-};
+    std::ifstream words("words.txt");
+    if (!words)
+    {
+        std::cerr << "Cannot open words.txt" << std::endl;
+        return 1;
+    }
+    WordSplitting::Segmenter segmenter(words);
 
+    WordSplitting::Segmenter::Workspace workspace;
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::cout << segmenter.segment(argv[i], workspace) << std::endl;
+        }
+        return 0;
+    }
 
-int main()
-{
-	std::cout << std::bitset<8>(fin).to_string() << std::endl;
-	std::cout << std::bitset<8>(~fin).to_string() << std::endl;
+    std::string token;
+    while (std::cin >> token)
+    {
+        std::cout << segmenter.segment(token, workspace) << "\n";
+    }
 }
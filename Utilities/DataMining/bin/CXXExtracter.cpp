@@ -1,37 +1,45 @@
+#include "URLExtracter.h"
+#include <exception>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
-char gDelimiter = '\"';
-static std::string gHTTP = "http";
 
-int main()
+// Prints the distinct URLs in the files on the command line, or on stdin
+// without any, one per line in the order they first appear. Files are
+// mapped and scanned in parallel.
+int main(int argc, char ** argv)
 {
-    std::string word;
-    while (std::cin >> word)
+    try
     {
-        auto start = word.find(gHTTP);
-        if (start == std::string::npos)
+        std::vector<char> input;
+        std::vector<std::unique_ptr<Extracter::MappedFile>> files;
+        std::vector<Extracter::Document> documents;
+        if (argc < 2)
         {
-            continue;
+            input = Extracter::read_all(0);
+            Extracter::Document document = { input.data(), input.data() + input.size() };
+            documents.push_back(document);
         }
-
-        if (start == word.size())
+        for (int i = 1; i < argc; ++i)
         {
-            continue;
+            files.push_back(std::unique_ptr<Extracter::MappedFile>(new Extracter::MappedFile(argv[i])));
+            Extracter::Document document = { files.back()->begin(), files.back()->end() };
+            documents.push_back(document);
         }
 
-        //char next = word[start + gHTTP.size()];
-        //if (next != 's' && next != '/')
-        //{
-            //continue;
-        //}
-        
-        auto end = word.find(gDelimiter, start + gHTTP.size());
-        if (end == std::string::npos)
+        std::string output;
+        for (const Extracter::View & url : Extracter::extract_urls(documents))
         {
-            continue;
+            output.append(url.data, url.size);
+            output += '\n';
         }
-        
-        std::cout << word.substr(start, end - start) << std::endl;
+        std::cout.write(output.data(), output.size());
+    }
+    catch (const std::exception & exc)
+    {
+        std::cerr << exc.what() << std::endl;
+        return 1;
     }
 }
@@ -0,0 +1,363 @@
+#ifndef URLEXTRACTER_H_INCLUDED
+#define URLEXTRACTER_H_INCLUDED
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Finds the http:// and https:// URLs in a buffer, wherever they are: in
+ * attributes with either quote, in text, several in one line.
+ *
+ * A URL runs until the first byte that cannot be part of one (RFC 3986),
+ * quotes included. The URLs are reported as views into the buffer, so
+ * nothing is allocated per URL.
+ */
+namespace Extracter {
+
+
+struct View
+{
+    const char * data;
+    size_t size;
+
+    std::string str() const { return std::string(data, size); }
+
+    bool operator==(const View & inOther) const
+    {
+        return size == inOther.size && std::memcmp(data, inOther.data, size) == 0;
+    }
+};
+
+
+//! FNV-1a.
+struct ViewHash
+{
+    size_t operator()(const View & inView) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i != inView.size; ++i)
+        {
+            hash = (hash ^ static_cast<uint8_t>(inView.data[i])) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+
+//! The distinct views, in the order they were first inserted.
+class URLSet
+{
+public:
+    //! False if an equal view was inserted before.
+    bool insert(const View & inView)
+    {
+        if (!mSet.insert(inView).second)
+        {
+            return false;
+        }
+        mOrder.push_back(inView);
+        return true;
+    }
+
+    const std::vector<View> & urls() const { return mOrder; }
+
+private:
+    std::unordered_set<View, ViewHash> mSet;
+    std::vector<View> mOrder;
+};
+
+
+namespace Detail {
+
+
+struct URLTable
+{
+    URLTable()
+    {
+        std::fill(allowed, allowed + 256, false);
+        const char * chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~:/?#[]@!$&()*+,;=%";
+        for (; *chars != 0; ++chars)
+        {
+            allowed[static_cast<uint8_t>(*chars)] = true;
+        }
+    }
+
+    bool allowed[256];
+};
+
+
+inline const URLTable & url_table()
+{
+    static const URLTable result;
+    return result;
+}
+
+
+// The length of the scheme if a URL starts at p, else 0.
+inline size_t scheme_length(const char * p, const char * inEnd)
+{
+    size_t available = inEnd - p;
+    if (available > 7 && std::memcmp(p, "http://", 7) == 0)
+    {
+        return 7;
+    }
+    if (available > 8 && std::memcmp(p, "https://", 8) == 0)
+    {
+        return 8;
+    }
+    return 0;
+}
+
+
+// The next "http" at or after p, or inEnd; memchr for the 'h' and a
+// comparison for the rest.
+inline const char * find_http_memchr(const char * p, const char * inEnd)
+{
+    while (inEnd - p >= 4)
+    {
+        const char * h = static_cast<const char*>(std::memchr(p, 'h', (inEnd - p) - 3));
+        if (h == 0)
+        {
+            break;
+        }
+        if (std::memcmp(h, "http", 4) == 0)
+        {
+            return h;
+        }
+        p = h + 1;
+    }
+    return inEnd;
+}
+
+
+#ifdef __AVX2__
+// Like find_http_memchr(), but compares 32 positions at once with both the
+// 'h' and, three bytes on, the 'p' of "http". Few positions pass both, and
+// only those are compared in full.
+inline const char * find_http_avx2(const char * p, const char * inEnd)
+{
+    const __m256i h = _mm256_set1_epi8('h');
+    const __m256i last = _mm256_set1_epi8('p');
+    for (; inEnd - p >= 32 + 3; p += 32)
+    {
+        __m256i first_bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i last_bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+        __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(first_bytes, h), _mm256_cmpeq_epi8(last_bytes, last));
+        for (uint32_t candidates = static_cast<uint32_t>(_mm256_movemask_epi8(both)); candidates != 0; candidates &= candidates - 1)
+        {
+            const char * candidate = p + __builtin_ctz(candidates);
+            if (candidate[1] == 't' && candidate[2] == 't')
+            {
+                return candidate;
+            }
+        }
+    }
+    return find_http_memchr(p, inEnd);
+}
+#endif
+
+
+template<const char * (*FindHTTP)(const char *, const char *), class F>
+void find_urls(const char * inBegin, const char * inEnd, F inFound)
+{
+    const bool * allowed = url_table().allowed;
+    for (const char * p = inBegin; (p = FindHTTP(p, inEnd)) != inEnd; )
+    {
+        size_t scheme = scheme_length(p, inEnd);
+        if (scheme == 0)
+        {
+            p += 4;
+            continue;
+        }
+        const char * end = p + scheme;
+        while (end != inEnd && allowed[static_cast<uint8_t>(*end)])
+        {
+            ++end;
+        }
+        if (end != p + scheme)
+        {
+            View url = { p, static_cast<size_t>(end - p) };
+            inFound(url);
+        }
+        p = end;
+    }
+}
+
+
+} // namespace Detail
+
+
+//! Calls inFound(View) for every URL in [inBegin, inEnd), in order.
+template<class F>
+void find_urls(const char * inBegin, const char * inEnd, F inFound)
+{
+#ifdef __AVX2__
+    Detail::find_urls<Detail::find_http_avx2>(inBegin, inEnd, inFound);
+#else
+    Detail::find_urls<Detail::find_http_memchr>(inBegin, inEnd, inFound);
+#endif
+}
+
+
+//! find_urls() searching with memchr only, for comparison.
+template<class F>
+void find_urls_memchr(const char * inBegin, const char * inEnd, F inFound)
+{
+    Detail::find_urls<Detail::find_http_memchr>(inBegin, inEnd, inFound);
+}
+
+
+//! A file mapped read-only into memory, for as long as the object lives.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string & inPath) :
+        mData(0),
+        mSize(0)
+    {
+        int fd = ::open(inPath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + inPath);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + inPath);
+        }
+        mSize = static_cast<size_t>(info.st_size);
+        if (mSize != 0)
+        {
+            void * data = ::mmap(0, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + inPath);
+            }
+            ::madvise(data, mSize, MADV_SEQUENTIAL);
+            mData = static_cast<const char*>(data);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (mData != 0)
+        {
+            ::munmap(const_cast<char*>(mData), mSize);
+        }
+    }
+
+    const char * begin() const { return mData; }
+    const char * end() const { return mData + mSize; }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+
+    const char * mData;
+    size_t mSize;
+};
+
+
+//! Reads all of inFile (a descriptor, such as stdin) in blocks.
+inline std::vector<char> read_all(int inFile)
+{
+    std::vector<char> result;
+    const size_t cBlockSize = 1 << 20;
+    for (;;)
+    {
+        size_t size = result.size();
+        result.resize(size + cBlockSize);
+        ssize_t count = ::read(inFile, &result[size], cBlockSize);
+        if (count < 0)
+        {
+            throw std::runtime_error("Read failed");
+        }
+        result.resize(size + count);
+        if (count == 0)
+        {
+            return result;
+        }
+    }
+}
+
+
+struct Document
+{
+    const char * begin;
+    const char * end;
+};
+
+
+/**
+ * The distinct URLs of all documents, in the order they first appear.
+ *
+ * The documents are scanned on inThreadCount threads, which take them one
+ * by one from a shared counter. Each keeps the distinct URLs per document;
+ * they are merged in document order at the end. The views point into the
+ * documents.
+ */
+inline std::vector<View> extract_urls(const std::vector<Document> & inDocuments, unsigned inThreadCount = std::thread::hardware_concurrency())
+{
+    std::vector<URLSet> per_document(inDocuments.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]
+    {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < inDocuments.size(); )
+        {
+            URLSet & urls = per_document[i];
+            find_urls(inDocuments[i].begin, inDocuments[i].end, [&](const View & inURL) { urls.insert(inURL); });
+        }
+    };
+
+    const unsigned thread_count = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(inThreadCount, inDocuments.size())));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < thread_count; ++t)
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    if (per_document.size() == 1)
+    {
+        return per_document[0].urls();
+    }
+    URLSet result;
+    for (const URLSet & urls : per_document)
+    {
+        for (const View & url : urls.urls())
+        {
+            result.insert(url);
+        }
+    }
+    return result.urls();
+}
+
+
+} // namespace Extracter
+
+
+#endif // URLEXTRACTER_H_INCLUDED
@@ -0,0 +1,128 @@
+#include "Benchmark.h"
+#include "URLExtracter.h"
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// URL extraction from the test page: the word by word scan of the old
+// CXXExtracter against URLExtracter.h, with memchr and with the vector
+// search, and the parallel extraction of distinct URLs. One operation is
+// one input byte.
+//
+//   benchmark [file] [copies]   (default ../testdata/stackoverflow_295135.html, 64)
+//
+// The copies of the file count as separate documents.
+
+
+namespace Original {
+
+
+// CXXExtracter before URLExtracter.h, collecting instead of printing.
+std::vector<std::string> extract(std::istream & inInput)
+{
+    std::vector<std::string> result;
+    std::string word;
+    while (inInput >> word)
+    {
+        auto start = word.find("http");
+        if (start == std::string::npos)
+        {
+            continue;
+        }
+        auto end = word.find('\"', start + 4);
+        if (end == std::string::npos)
+        {
+            continue;
+        }
+        result.push_back(word.substr(start, end - start));
+    }
+    return result;
+}
+
+
+} // namespace Original
+
+
+namespace {
+
+
+void check(const std::string & inName, size_t inValue, size_t inExpected)
+{
+    if (inValue != inExpected)
+    {
+        throw std::runtime_error(inName + ": got " + std::to_string(inValue) + ", expected " + std::to_string(inExpected));
+    }
+}
+
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    Bench::Options defaults;
+    defaults.repetitions = 5;
+    Bench::Runner runner(argc, argv, defaults);
+
+    const std::vector<std::string> & arguments = runner.options().arguments;
+    const std::string path = arguments.size() > 0 ? arguments[0] : "../testdata/stackoverflow_295135.html";
+    const size_t copies = arguments.size() > 1 ? std::stoul(arguments[1]) : 64;
+
+    Extracter::MappedFile file(path);
+    const std::string page(file.begin(), file.end());
+    const std::vector<Extracter::Document> documents(copies, Extracter::Document{ page.data(), page.data() + page.size() });
+    const size_t bytes = page.size() * copies;
+
+    size_t url_count = 0;
+    std::set<std::string> distinct;
+    Extracter::find_urls_memchr(page.data(), page.data() + page.size(), [&](const Extracter::View & inURL)
+    {
+        url_count++;
+        distinct.insert(inURL.str());
+    });
+
+    runner.run_batch("original", bytes, [&]
+    {
+        size_t count = 0;
+        for (size_t i = 0; i != copies; ++i)
+        {
+            std::istringstream input(page);
+            count += Original::extract(input).size();
+        }
+        Bench::DoNotOptimize(count);
+    }, 1);
+
+    runner.run_batch("find_urls_memchr", bytes, [&]
+    {
+        size_t count = 0;
+        for (const Extracter::Document & document : documents)
+        {
+            Extracter::find_urls_memchr(document.begin, document.end, [&](const Extracter::View &) { count++; });
+        }
+        check("find_urls_memchr", count, url_count * copies);
+    }, 1);
+
+    runner.run_batch("find_urls", bytes, [&]
+    {
+        size_t count = 0;
+        for (const Extracter::Document & document : documents)
+        {
+            Extracter::find_urls(document.begin, document.end, [&](const Extracter::View &) { count++; });
+        }
+        check("find_urls", count, url_count * copies);
+    }, 1);
+
+    const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const std::string name = "extract_urls/threads=" + std::to_string(threads);
+        runner.run_batch(name, bytes, [&]
+        {
+            check(name, Extracter::extract_urls(documents, threads).size(), distinct.size());
+        }, 1);
+    }
+}